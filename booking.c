@@ -1,35 +1,130 @@
+#define _GNU_SOURCE // For F_OFD_SETLKW
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
 #include <ctype.h>
 #include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <ftw.h>
+#ifdef __linux__
+#include <sys/ptrace.h>
+#include <linux/io_uring.h>
+#endif
 
 #define MAX_NAME_LENGTH 50
 #define MAX_COMMENT_LENGTH 200
 #define MAX_DESTINATION_LENGTH 50
-#define MAX_SEATS 50
-#define MAX_ROUTES 100
+#define MAX_TRAVELERS 50
+#define MAX_SEAT_RUNS 8          // Separate blocks of adjacent seats one booking may hold
+#define MAX_ROUTES 65536         // Route table reservation, pages are only touched as routes are added
+#define MAX_ROUTE_SEATS 4096     // Largest vehicle
+#define DEFAULT_ROUTE_SEATS 50   // Bus size of routes missing from ROUTE_CAPACITY_FILENAME
+#define SEAT_WORD_BITS 64
+#define MAX_ROUTE_SEAT_WORDS ((MAX_ROUTE_SEATS + SEAT_WORD_BITS - 1) / SEAT_WORD_BITS)
+#define SEAT_ARENA_WORDS (1 << 18) // Seat bitset words shared out to routes, 16M seats in all
+#define ROUTE_CAPACITY_FILENAME "route_capacities.txt"
+#define MAX_TRAINS 16384         // Train routes with a coach inventory
+#define TRAIN_CLASSES 4          // Rows of coachClasses
+#define MAX_TRAIN_COACHES 32     // Coaches in one train, at most 64 per class
 #define FILENAME "bookings.dat"
-#define PARTIAL_BOOKING_FILENAME "partial_booking.dat"
-#define PROGRESS_FILENAME "booking.det"
+#define POINTS_FILENAME "reedem_points.dat"
+#define FEEDBACK_FILENAME "feedbacks.dat"
+#define WAITLIST_FILENAME "waitlist.dat"
+#define SESSION_JOURNAL_FILENAME "booking_sessions.jnl"
+#define DATA_FILE_MAGIC 0x46444b42u // "BKDF", starts bookings.dat, reedem_points.dat and feedbacks.dat
+#define BOOKINGS_LAYOUT 4 // Record layout versions, see migrateDataFiles()
+#define POINTS_LAYOUT 2
+#define FEEDBACK_LAYOUT 2
+#define SESSION_TTL_SECONDS (24 * 60 * 60) // Open sessions idle this long are abandoned
+#define JOURNAL_COMPACT_MIN_ENTRIES 1024
 #define POINTS_PER_BOOKING 100
 #define POINT_VALUE 100 
 #define MIN_BOOKING_PRICE 1800
+#define SEAT_HOLD_TTL_SECONDS 600 // Seats picked in addBooking are held this long before release
+#define TIMER_WHEEL_BITS 6        // 64 slots per wheel level
+#define TIMER_WHEEL_LEVELS 3      // 1s, 64s and 4096s granularity
+#define SCAN_CHUNK_RECORDS 4096 // Records handed to a worker at a time during parallel scans
+#define MAX_SCAN_THREADS 64
+#define IO_BACKEND_ENV "BOOKING_IO" // "sync" (default), "batched" or "ring"
+#define MAX_IO_FILES 8
+#define IO_RING_ENTRIES 64 // Writes submitted to io_uring per io_uring_enter() call
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS) // Headers new enough for IORING_OP_WRITE
+#define IO_RING_SUPPORTED 1
+#else
+#define IO_RING_SUPPORTED 0
+#endif
+#define BOOKING_ENGINE_ENV "BOOKING_ENGINE" // "file" (default) or "lsm"
+#define LSM_DIRECTORY "bookings.lsm"
+#define LSM_MEMTABLE_RECORDS 4096 // Memtable size that triggers a flush to a level-0 run
+#define LSM_LEVEL0_RUNS 4         // Level-0 runs merged into level 1 at this count
+#define LSM_LEVEL_RATIO 10        // Each level below 1 may hold this many times the one above
+#define LSM_MAX_LEVELS 8
+#define LSM_MAX_RUNS 32
+#define LSM_BLOOM_BITS_PER_KEY 10 // About 1% false positives
+#define LSM_BLOOM_HASHES 7
+#define IO_BATCH_BYTES (64 * 1024)
+#define SEAT_MAP_ENV "BOOKING_SEAT_MAP" // "shared" (default) or "private"
+#define SEAT_MAP_MAGIC 0x50414d53u     // "SMAP"
+#define SEAT_MAP_VERSION 5
+#define MAX_CATALOG_ENTRIES 4096 // Per catalog kind
+#define CATALOG_HASH_SLOTS 8192  // Must be a power of two larger than MAX_CATALOG_ENTRIES
+#define MODE_BUS 0
+#define MODE_TRAIN 1
+#define MAX_MENU_COMMANDS 32
+#define HLL_PRECISION 10 // 2^10 registers per HyperLogLog
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define SKETCH_ROUTE_SLOTS 200 // Route and mode pairs with their own customer counts
+#define CMS_DEPTH 4
+#define CMS_WIDTH 2048
+#define TOP_K 10
+#define TDIGEST_COMPRESSION 100
+#define TDIGEST_CENTROIDS 256
+#define TDIGEST_BUFFER 256
+#define FUZZY_MAX_EDITS 2 // Typos tolerated by the trigram filter in fuzzy name search
+#define FUZZY_MATCHES 10
+#define JOURNEY_MAX_LEGS 3
+#define JOURNEY_ITINERARIES 5 // Kept per category, origin and destination
+
+// A block of count adjacent seats starting at first. A count of 0 ends the
+// list.
+struct SeatRun
+{
+    unsigned short first;
+    unsigned short count;
+};
 
+// A booking as stored in bookings.dat. New fields must also be copied in
+// sealBooking(), and a layout change needs a new BOOKINGS_LAYOUT and a
+// converter in legacyBookingLayouts, see migrateDataFile().
 struct Booking
 {
     int ticketID;
     char name[MAX_NAME_LENGTH];
-    char currentLocation[MAX_DESTINATION_LENGTH];
-    char destination[MAX_DESTINATION_LENGTH];
+    short currentCityID; // Catalog IDs, see cityName()
+    short destinationCityID;
     int price;
-    char category[MAX_NAME_LENGTH];
-    int seats[MAX_SEATS];
+    unsigned char categoryID;
+    unsigned char modeID;
+    struct SeatRun seatRuns[MAX_SEAT_RUNS]; // Seats in traveller order, see setBookingSeats()
     int bookedSeat;
     bool returnTicket;
-    char mode[MAX_NAME_LENGTH];
     int numTravelers;
+    long long createdAt;  // Seconds since the epoch
+    long long travelDate; // Midnight UTC of the travel day, in seconds since the epoch
+    unsigned int checksum; // CRC32C of the other bytes, see sealBooking()
+    unsigned int version;  // Bumped on every in-place change, see commitBookingChange(). Fills what was tail padding
 };
 
 struct PartialBooking
@@ -41,16 +136,15 @@ struct PartialBooking
 
 struct Routs
 {
-    char currentLocation[MAX_DESTINATION_LENGTH];
-    char destination[MAX_DESTINATION_LENGTH];
-    bool seatAvailability[MAX_SEATS]; // Array to track availability for this specific route
-};
-
-struct RouteSeatAvailability
-{
-    char currentLocation[MAX_DESTINATION_LENGTH];
-    char destination[MAX_DESTINATION_LENGTH];
-    bool seatAvailability[MAX_SEATS]; // Array to track availability for this specific route
+    short currentCityID;
+    short destinationCityID;
+    unsigned char modeID; // Buses and trains between two cities are separate routes
+    int train;            // Index into seatMap->trains, or -1 for a bus
+    int capacity;      // Seats on the vehicle, numbered from 1
+    int freeCount;     // Set bits in the route's seat words
+    int firstWord;     // Bit j of seatWords[firstWord...] is set when seat j + 1 is free
+    int freeCountNext; // Route index + 1, or 0 at the end of a bucket
+    int freeCountPrev;
 };
 
 struct Feedback {
@@ -58,6 +152,7 @@ struct Feedback {
     char name[MAX_NAME_LENGTH];
     int rating; // Rating out of 5
     char comments[200];
+    unsigned int checksum;
 };
 
 struct PromoCode
@@ -69,27 +164,32 @@ struct PromoCode
 struct User {
     char name[MAX_NAME_LENGTH];
     int points; 
+    unsigned int checksum;
 };
 
 struct Calendar {
     char date[11];
-    char currentLocation[MAX_NAME_LENGTH];
-    char destination[MAX_NAME_LENGTH];
+    short currentCityID;
+    short destinationCityID;
     int standardPrice;
     int vipPrice;
     bool available;
 };
 
-const char *indianCities[] = {
-    "Mumbai", "Delhi", "Bangalore", "Hyderabad", "Chennai",
-    "Kolkata", "Jaipur", "Ahmedabad", "Pune", "Lucknow"};
+const char *ticketCategories[] = {"Standard", "VIP"}; // Ticket categories
 
-// int ticketPrices[] = {1500, 1300, 1200, 1100, 1150, 1250, 1400, 1350, 1600, 900};
+// Generated by `booking --generate-cities cities.csv`; edit cities.csv and
+// regenerate instead of changing these tables. cities.csv has one "City,
+// train standard,train VIP,bus standard,bus VIP" line per city, and the order
+// of the lines gives the city IDs that bookings store, so new cities go at
+// the end. cityHashSeeds and cityHashSlots form a minimal perfect hash over
+// the names, see findCityID().
+const char *indianCities[] = {
+    "Mumbai", "Delhi", "Bangalore", "Hyderabad", "Chennai", "Kolkata", "Jaipur",
+    "Ahmedabad", "Pune", "Lucknow"};
 
-const char *ticketCategories[] = {"Standard", "VIP"}; // Ticket categories
 int ticketPrices[][2] = {
-    // Prices for each category
-    {1500, 2500}, // Standard and VIP prices for Mumbai
+    {1500, 2500}, // Mumbai
     {1300, 2300}, // Delhi
     {1200, 2200}, // Bangalore
     {1100, 2100}, // Hyderabad
@@ -98,22 +198,27 @@ int ticketPrices[][2] = {
     {1400, 2400}, // Jaipur
     {1350, 2350}, // Ahmedabad
     {1600, 2600}, // Pune
-    {900, 1900}   // Lucknow
+    {900, 1900}  // Lucknow
 };
 
 int busPrices[][2] = {
-    {800, 1500},
-    {700, 1200},
-    {600, 1100},
-    {550, 1000},
-    {600, 1100},
-    {650, 1200},
-    {700, 1300},
-    {650, 1250},
-    {800, 1400},
-    {500, 1000}
+    {800, 1500}, // Mumbai
+    {700, 1200}, // Delhi
+    {600, 1100}, // Bangalore
+    {550, 1000}, // Hyderabad
+    {600, 1100}, // Chennai
+    {650, 1200}, // Kolkata
+    {700, 1300}, // Jaipur
+    {650, 1250}, // Ahmedabad
+    {800, 1400}, // Pune
+    {500, 1000}  // Lucknow
 };
 
+const unsigned int cityHashSeeds[] = {
+    1, 5, 2, 0, 7};
+const short cityHashSlots[] = {
+    7, 8, 1, 9, 5, 6, 0, 3, 4, 2};
+
 int Transport_Choice;
 
 void clearInputBuffer()
@@ -121,8 +226,43 @@ void clearInputBuffer()
     int c;
     while ((c = getchar()) != '\n' && c != EOF);
 }
+
+#define REPLAY_CLOCK 1767225600 // 2026-01-01 00:00:00 UTC
+
+bool replayClock = false; // Set for --replay
+
+// Seconds since the epoch. A replay runs on a fixed clock instead, so ticket
+// IDs and timestamps, and with them the data files, repeat from run to run.
+time_t currentTime()
+{
+    return replayClock ? REPLAY_CLOCK : time(NULL);
+}
+
+// Ends the session once the console input is exhausted, as at the end of a
+// replayed trace. Called where a prompt failed to read an answer, which
+// would otherwise ask again forever.
+void stopAtEndOfInput()
+{
+    if (feof(stdin) || ferror(stdin))
+    {
+        exit(0); // Queued writes are flushed and a replay is reported at exit
+    }
+}
 void handleInput();
+void advanceSeatHolds();
 void recordFeedback(int ticketID, const char* name);
+int unique_id();
+void promoteWaitlist(int routeIndex);
+void journeyRouteChanged(const struct Routs *route);
+void recountTrainInventory(const struct Routs *route);
+int freeSeatsOnRoute(int currentCityID, int destinationCityID, int modeID);
+int addRoute(int currentCityID, int destinationCityID, int modeID);
+bool insertBooking(struct Booking *booking);
+bool prepareBookingsView();
+void prepareBookingsScan();
+bool searchBookingsIndexed(int searchChoice);
+bool lsmUpgrade();
+int earnBookingPoints(const char* userName, int bookingPrice, bool* created);
 
 void TransportMode(struct PartialBooking* partial) {
     while(1){
@@ -133,12 +273,13 @@ void TransportMode(struct PartialBooking* partial) {
         printf("Enter your choice: ");
 
         if (scanf("%d", &Transport_Choice) != 1 || (Transport_Choice < 1 || Transport_Choice > 2)) {
+            stopAtEndOfInput();
             printf("Invalid choice. Please choose 1 for Bus or 2 for Train.\n");
             clearInputBuffer();
             continue;
         }
         clearInputBuffer();
-        strcpy(partial->booking.mode, (Transport_Choice == 1) ? "Bus" : "Train");
+        partial->booking.modeID = (Transport_Choice == 1) ? MODE_BUS : MODE_TRAIN;
         printf("You selected: %s\n", Transport_Choice == 1 ? "Bus" : "Train");
         break;
     }
@@ -147,1722 +288,11571 @@ void TransportMode(struct PartialBooking* partial) {
 void showMenu();
 void handleInput();
 const int numCities = sizeof(indianCities) / sizeof(indianCities[0]);
-struct Routs routeSeatAvailability[MAX_ROUTES];
-int routeCount = 0; // Keep track of unique routes
+const int numCityHashBuckets = sizeof(cityHashSeeds) / sizeof(cityHashSeeds[0]);
+_Static_assert(sizeof(ticketPrices) / sizeof(ticketPrices[0]) == sizeof(indianCities) / sizeof(indianCities[0]),
+               "ticketPrices needs one row per city; regenerate the tables from cities.csv");
+_Static_assert(sizeof(busPrices) / sizeof(busPrices[0]) == sizeof(indianCities) / sizeof(indianCities[0]),
+               "busPrices needs one row per city; regenerate the tables from cities.csv");
+_Static_assert(sizeof(cityHashSlots) / sizeof(cityHashSlots[0]) == sizeof(indianCities) / sizeof(indianCities[0]),
+               "cityHashSlots needs one slot per city; regenerate the tables from cities.csv");
+
+// Route seat maps, shared by every booking process on the same data
+// directory through a POSIX shared-memory segment (see attachSeatMap()).
+// The header records the layout the segment was created with, so a build
+// with a different layout or version refuses to attach instead of
+// misreading it, and later versions can append fields behind size. It also
+// records which bookings.dat the routes were loaded from, so a file
+// replaced behind the counters' backs (a repair, a restored backup) makes
+// the next process rebuild the map instead of trusting it. Seat
+// bits only change with atomic and/or, so exactly one process wins a seat;
+// route creation and the free-count buckets are guarded by a robust,
+// process-shared mutex.
+//   The route table and the seat arena are reserved at their largest and
+// never move, so every process can keep one mapping while routes are added.
+// Pages are only backed once touched: a route takes the seat words its
+// vehicle needs from the arena, and memory grows with the seats in use.
+struct FileIdentity
+{
+    dev_t device;
+    ino_t inode;
+    unsigned int generation; // From the data file header
+};
 
-void printCentered(const char *str, int width)
+struct SeatMapHeader
 {
-    int len = strlen(str);
-    int spaces = (width - len) / 2;
-    if (spaces < 0)
-        spaces = 0;                     // In case the string is longer than width
-    printf("%*s%s\n", spaces, "", str); // Print spaces and the string
-}
+    unsigned int magic; // Stored last, once the segment is initialized
+    unsigned int version;
+    unsigned int size; // Bytes in the segment
+    int routeCapacity;
+    int seatArenaWords;
+    int ready;   // Set once the routes were loaded from bookings.dat
+    int retired; // Set once the segment was unlinked to be rebuilt
+    struct FileIdentity source; // bookings.dat the routes match
+    pthread_mutex_t lock;
+};
 
+// Trains are sold as coach -> berth. Each coach keeps its free berths per
+// berth type, and each class keeps one bitmap word per berth type over its
+// coaches, so full coaches are skipped without being looked at.
+enum BerthType
+{
+    BERTH_LOWER,
+    BERTH_MIDDLE,
+    BERTH_UPPER,
+    BERTH_SIDE_LOWER,
+    BERTH_SIDE_UPPER,
+    BERTH_TYPES,
+    BERTH_ANY = BERTH_TYPES
+};
 
-struct Calendar tickets[MAX_ROUTES];
+struct CoachInventory
+{
+    unsigned short freeCount;
+    unsigned short freeBerths[BERTH_TYPES];
+};
 
-void Initilize_Calendar() {
-    int dayCount = 30;
-   for (int i = 0; i < dayCount; i++) {
-        snprintf(tickets[i].date, sizeof(tickets[i].date), "2024-10-%02d", i + 1); // Dates from Oct 01 to Oct 30
-        strcpy(tickets[i].currentLocation, indianCities[i % (sizeof(indianCities) / sizeof(indianCities[0]))]);
-        strcpy(tickets[i].destination, indianCities[(i + 1) % (sizeof(indianCities) / sizeof(indianCities[0]))]);
-        tickets[i].standardPrice = ticketPrices[i % (sizeof(ticketPrices) / sizeof(ticketPrices[0]))][0];
-        tickets[i].vipPrice = ticketPrices[i % (sizeof(ticketPrices) / sizeof(ticketPrices[0]))][1];
-        tickets[i].available = (i % 2 == 0); // Alternate availability for demonstration
+struct TrainInventory
+{
+    unsigned long long openCoaches[TRAIN_CLASSES][BERTH_TYPES + 1]; // Bit i: coach i of the class has a free berth of the type
+    struct CoachInventory coaches[MAX_TRAIN_COACHES];
+};
+
+struct SeatMap
+{
+    struct SeatMapHeader header;
+    int routeCount;    // Keep track of unique routes
+    int seatWordCount; // Arena words handed out to routes
+    int trainCount;    // Inventories handed out to train routes
+    unsigned int nextHoldDeadline; // No hold runs out before this second, see expireSharedHolds()
+    int freeCountBuckets[MAX_ROUTE_SEATS + 1]; // First route index + 1, or 0 for an empty bucket
+    struct Routs routes[MAX_ROUTES];
+    struct TrainInventory trains[MAX_TRAINS];
+    unsigned long long seatWords[SEAT_ARENA_WORDS];
+    unsigned long long holders[SEAT_ARENA_WORDS * SEAT_WORD_BITS]; // Hold on each seat, see seatHolderWord(); 0 once booked or free
+};
+
+struct SeatMap *seatMap = NULL; // Mapped by initializeSeats()
+bool seatMapShared = false;
+bool seatMapPrivate = false; // Set for replays, which must not see other processes' seats
+
+// String catalogs. Cities, transport modes and ticket categories are interned
+// once to small integer IDs; bookings, routes and the calendar store only the
+// IDs, so every internal comparison is an integer compare. The catalogs are
+// seeded from indianCities, the mode names and ticketCategories in order, so
+// an ID is also the row to use in ticketPrices and busPrices.
+enum CatalogKind
+{
+    CATALOG_CITY,
+    CATALOG_MODE,
+    CATALOG_CATEGORY,
+    CATALOG_KINDS
+};
+
+struct Catalog
+{
+    const char *names[MAX_CATALOG_ENTRIES];
+    int count;
+    short slots[CATALOG_HASH_SLOTS]; // ID + 1, or 0 for an empty slot
+};
+
+struct Catalog catalogs[CATALOG_KINDS];
+
+unsigned int hashCatalogName(const char *name)
+{
+    unsigned int h = 2166136261u; // FNV-1a over the lower-cased name
+    for (const char *p = name; *p; p++)
+    {
+        h = (h ^ (unsigned char)tolower((unsigned char)*p)) * 16777619u;
     }
+    return h;
 }
 
+unsigned int mixCityHash(unsigned int hash, unsigned int seed)
+{
+    unsigned int x = hash + seed * 0x9e3779b9u;
+    x ^= x >> 16;
+    x *= 0x85ebca6bu;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35u;
+    x ^= x >> 16;
+    return x;
+}
 
-void initializeSeats()
+// Returns the ID of a built-in city (case-insensitive), or -1. The generated
+// seeds send every built-in city to a slot of its own, so a lookup is one
+// hash of the name, two table reads and a single compare that rejects names
+// outside the catalog.
+int findCityID(const char *name)
 {
-    for (int i = 0; i < MAX_ROUTES; i++)
+    unsigned int hash = hashCatalogName(name);
+    int id = cityHashSlots[mixCityHash(hash, cityHashSeeds[hash % numCityHashBuckets]) % numCities];
+    return strcasecmp(indianCities[id], name) == 0 ? id : -1;
+}
+
+// Returns the ID of name (case-insensitive), or -1 if it was never interned.
+int lookupName(int kind, const char *name)
+{
+    struct Catalog *catalog = &catalogs[kind];
+    int id = kind == CATALOG_CITY ? findCityID(name) : -1;
+    if (id >= 0)
     {
-        for (int j = 0; j < MAX_SEATS; j++)
-        {
-            routeSeatAvailability[i].seatAvailability[j] = true; // Initialize all seats to available
-        }
+        return id;
     }
-    struct Booking booking;
-    FILE *file = fopen(FILENAME, "rb");
-
-    if (file != NULL)
+    for (unsigned int i = hashCatalogName(name) & (CATALOG_HASH_SLOTS - 1);
+         catalog->slots[i] != 0;
+         i = (i + 1) & (CATALOG_HASH_SLOTS - 1))
     {
-        while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+        if (strcasecmp(catalog->names[catalog->slots[i] - 1], name) == 0)
         {
-            for (int j = 0; j < MAX_SEATS && booking.seats[j] != 0; j++)
-            {
-                // Find the route and mark the seat as booked
-                for (int r = 0; r < routeCount; r++)
-                {
-                    if (strcmp(routeSeatAvailability[r].currentLocation, booking.currentLocation) == 0 &&
-                        strcmp(routeSeatAvailability[r].destination, booking.destination) == 0)
-                    {
-                        routeSeatAvailability[r].seatAvailability[booking.seats[j] - 1] = false;
-                        break; // Break to prevent unnecessary looping
-                    }
-                }
-            }
+            return catalog->slots[i] - 1;
         }
-        fclose(file);
     }
+    return -1;
 }
 
-void addRoute(const char *currentLocation, const char *destination)
+// Returns the ID of name, adding it to the catalog if needed. Returns -1 if
+// the catalog is full.
+int internName(int kind, const char *name)
 {
-    // Initialize a new route if it doesn't exist
-    for (int i = 0; i < routeCount; i++)
+    int id = lookupName(kind, name);
+    struct Catalog *catalog = &catalogs[kind];
+    if (id >= 0 || catalog->count == MAX_CATALOG_ENTRIES)
     {
-        if (strcmp(routeSeatAvailability[i].currentLocation, currentLocation) == 0 &&
-            strcmp(routeSeatAvailability[i].destination, destination) == 0)
-        {
-            return; // Route already exists
-        }
+        return id;
     }
-    // If route does not exist, initialize it
-    strcpy(routeSeatAvailability[routeCount].currentLocation, currentLocation);
-    strcpy(routeSeatAvailability[routeCount].destination, destination);
-    for (int i = 0; i < MAX_SEATS; i++)
+    char *copy = strdup(name);
+    if (copy == NULL)
     {
-        routeSeatAvailability[routeCount].seatAvailability[i] = true; // Set all seats to available
+        return -1;
     }
-    routeCount++;
-}
-
-bool isSeatAvailableForRoute(const char *currentCity, const char *destinationCity, int seatNum)
-{
-    for (int i = 0; i < routeCount; i++)
+    unsigned int i = hashCatalogName(name) & (CATALOG_HASH_SLOTS - 1);
+    while (catalog->slots[i] != 0)
     {
-        if (strcmp(routeSeatAvailability[i].currentLocation, currentCity) == 0 &&
-            strcmp(routeSeatAvailability[i].destination, destinationCity) == 0)
-        {
-            return routeSeatAvailability[i].seatAvailability[seatNum - 1]; // Checking availability for specific route
-        }
+        i = (i + 1) & (CATALOG_HASH_SLOTS - 1);
     }
-    return false; // If route is not found, return false
+    id = catalog->count++;
+    catalog->names[id] = copy;
+    catalog->slots[i] = id + 1;
+    return id;
 }
 
-void bookSeatRoute(const char *currentCity, const char *destinationCity, int seatNum)
+const char *catalogName(int kind, int id)
 {
-    for (int i = 0; i < routeCount; i++)
-    {
-        if (strcmp(routeSeatAvailability[i].currentLocation, currentCity) == 0 &&
-            strcmp(routeSeatAvailability[i].destination, destinationCity) == 0)
-        {
-            routeSeatAvailability[i].seatAvailability[seatNum - 1] = false; // Mark the seat as booked
-            return;                                                         // Break once you've found the route
-        }
-    }
+    return id >= 0 && id < catalogs[kind].count ? catalogs[kind].names[id] : "";
 }
 
-void freeSeatRoute(const char *currentCity, const char *destinationCity, int seatNum)
+const char *cityName(int id)
 {
-    for (int i = 0; i < routeCount; i++)
-    {
-        if (strcmp(routeSeatAvailability[i].currentLocation, currentCity) == 0 &&
-            strcmp(routeSeatAvailability[i].destination, destinationCity) == 0)
-        {
-            routeSeatAvailability[i].seatAvailability[seatNum - 1] = true; // Mark the seat as available again
-            return;                                                        // Exit once you've freed the seat
-        }
-    }
+    return catalogName(CATALOG_CITY, id);
 }
 
-void displayAvailableSeats(const char *currentCity, const char *destinationCity)
+const char *modeName(int id)
 {
-    printf("\n +-------------------------------------------------------------------------------------------------------------------+\n");
-    printf(" |    Available Seats for %s to %s:  | \n", currentCity, destinationCity);
-    printf(" +-------------------------------------------------------------------------------------------------------------------+\n");
+    return catalogName(CATALOG_MODE, id);
+}
 
-    for (int i = 0; i < routeCount; i++)
-    {
-        if (strcmp(routeSeatAvailability[i].currentLocation, currentCity) == 0 &&
-            strcmp(routeSeatAvailability[i].destination, destinationCity) == 0)
-        {
-            printf(" | ");
-            bool foundSeat = false;
-            for (int j = 0; j < MAX_SEATS; j++)
-            {
-                if (routeSeatAvailability[i].seatAvailability[j])
-                {
-                    printf("%d ", (j + 1)); // 1-indexed seat numbers
-                    foundSeat = true;
-                }
-            }
-            if (!foundSeat)
-            {
-                printf("No available seats.");
-            }
-            printf("\n +-------------------------------------------------------------------------------------------------------------------+\n");
-            break; // Break once you've found the relevant route
-        }
-    }
+const char *categoryName(int id)
+{
+    return catalogName(CATALOG_CATEGORY, id);
 }
 
-bool isValidName(const char *name)
+void initializeCatalogs()
 {
-    if (isspace(name[0]))
-    {
-        return false;
-    }
-    for (const char *p = name; *p; p++)
+    // Built-in cities are found through findCityID(), so only cities interned
+    // later go into the probing table
+    for (int i = 0; i < numCities; i++)
     {
-        if (*p != ' ' && !isalpha(*p))
-        {
-            return false;
-        }
+        catalogs[CATALOG_CITY].names[i] = indianCities[i];
     }
-    // Check if name contains at least one non-space character
-    for (const char *p = name; *p; p++)
+    catalogs[CATALOG_CITY].count = numCities;
+    internName(CATALOG_MODE, "Bus");   // MODE_BUS
+    internName(CATALOG_MODE, "Train"); // MODE_TRAIN
+    for (size_t i = 0; i < sizeof(ticketCategories) / sizeof(ticketCategories[0]); i++)
     {
-        if (*p != ' ')
-        {
-            return true;
-        }
+        internName(CATALOG_CATEGORY, ticketCategories[i]);
     }
-    return false;
 }
 
-void savePartialBooking(struct PartialBooking *partial)
+// Per-record CRC32C. Every record in bookings.dat, reedem_points.dat and
+// feedbacks.dat carries a checksum over all of its other bytes, so a torn or
+// shifted record can be told apart from a good one. The SSE4.2 crc32
+// instruction is used when the CPU has it, a lookup table otherwise.
+unsigned int crc32cTable[256];
+bool crc32cHardware = false;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("sse4.2"))) unsigned int crc32cUpdateHardware(unsigned int crc, const unsigned char *data, size_t size)
 {
-    FILE *file = fopen(PARTIAL_BOOKING_FILENAME, "wb");
-    if (file == NULL)
+    unsigned long long crc64 = crc;
+    while (size >= 8)
     {
-        printf("Error: Unable to save partial booking. Please try again.\n");
-        return;
+        unsigned long long word;
+        memcpy(&word, data, 8);
+        crc64 = __builtin_ia32_crc32di(crc64, word);
+        data += 8;
+        size -= 8;
     }
-    if (fwrite(partial, sizeof(struct PartialBooking), 1, file) != 1)
+    crc = (unsigned int)crc64;
+    while (size-- > 0)
     {
-        printf("Error: Failed to write partial booking data. Please try again.\n");
+        crc = __builtin_ia32_crc32qi(crc, *data++);
     }
-    fclose(file);
+    return crc;
 }
+#endif
 
-bool loadPartialBooking(struct PartialBooking *partial)
+unsigned int crc32cUpdateTable(unsigned int crc, const unsigned char *data, size_t size)
 {
-    FILE *file = fopen(PARTIAL_BOOKING_FILENAME, "rb");
-    if (file == NULL)
+    while (size-- > 0)
     {
-        return false;
+        crc = crc32cTable[(crc ^ *data++) & 0xff] ^ (crc >> 8);
     }
-    bool success = (fread(partial, sizeof(struct PartialBooking), 1, file) == 1);
-    fclose(file);
-    return success;
+    return crc;
 }
 
-void saveBookingProgress(struct PartialBooking *partial)
+unsigned int crc32cUpdate(unsigned int crc, const void *data, size_t size)
 {
-    FILE *file = fopen(PROGRESS_FILENAME, "wb");
-    if (file == NULL)
-    {
-        printf("Error: Unable to save booking progress. Please try again.\n");
-        return;
-    }
-    if (fwrite(partial, sizeof(struct PartialBooking), 1, file) != 1)
-    {
-        printf("Error: Failed to write booking progress data. Please try again.\n");
-    }
-    else
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (crc32cHardware)
     {
-        printf("Booking progress saved successfully.\n");
+        return crc32cUpdateHardware(crc, data, size);
     }
-    fclose(file);
+#endif
+    return crc32cUpdateTable(crc, data, size);
 }
 
-bool loadBookingProgress(struct PartialBooking *partial)
+void initializeChecksums()
 {
-    FILE *file = fopen(PROGRESS_FILENAME, "rb");
-    if (file == NULL)
+    for (unsigned int i = 0; i < 256; i++)
     {
-        return false;
+        unsigned int crc = i;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0x82F63B78 & -(crc & 1)); // Reflected Castagnoli polynomial
+        }
+        crc32cTable[i] = crc;
     }
-    bool success = (fread(partial, sizeof(struct PartialBooking), 1, file) == 1);
-    fclose(file);
-    return success;
+#if defined(__x86_64__) && defined(__GNUC__)
+    crc32cHardware = __builtin_cpu_supports("sse4.2");
+#endif
 }
 
-void generateReferenceNumber(char *refNumber, int ticketID)
+// CRC32C of a record, skipping its own checksum field.
+unsigned int recordChecksum(const void *record, size_t size, size_t checksumOffset)
 {
-    time_t t;
-    srand((unsigned)time(&t));
-    int random = rand() % 1000;
-    sprintf(refNumber, "REF-%d-%03d", ticketID, random);
+    const unsigned char *bytes = record;
+    size_t rest = checksumOffset + sizeof(unsigned int);
+    unsigned int crc = crc32cUpdate(~0U, bytes, checksumOffset);
+    return ~crc32cUpdate(crc, bytes + rest, size - rest);
 }
 
-int unique_id()
-{ // Automatically Generate Unique, Non-Repeating Ticket IDs #16 by Vasu
-    static int counter = 0;
-    time_t now = time(NULL);
-    return ((int)(now % 1234) | counter++);
+bool recordIntact(const void *record, size_t size, size_t checksumOffset)
+{
+    unsigned int stored;
+    memcpy(&stored, (const unsigned char *)record + checksumOffset, sizeof(stored));
+    return stored == recordChecksum(record, size, checksumOffset);
 }
 
-void printBookingSummary(const struct PartialBooking *partial, int n)
+// The seal functions copy a record field by field into a zeroed one before
+// summing it, so the padding between fields is always zero on disk and the
+// checksum depends on the fields alone.
+void sealBooking(struct Booking *booking)
 {
-    printf("\n +--------------------------------------------------+\n");
-    printf(" |                 Booking Summary                  |\n");
-    printf(" +--------------------------------------------------+\n");
-    printf(" | Ticket ID: %-35d |\n", partial->booking.ticketID);
-    printf(" | Name: %-42s |\n", partial->booking.name);
-    printf(" | Current Location: %-30s |\n", partial->booking.currentLocation);
-    printf(" | Destination: %-34s |\n", partial->booking.destination);
-    printf(" | Mode: %-36s |\n", partial->booking.mode);
-    printf(" | Number of Travelers: %-27d |\n", n);
-    printf(" | Category: %-36s |\n", partial->booking.category);
+    struct Booking sealed;
+    memset(&sealed, 0, sizeof(sealed));
+    sealed.ticketID = booking->ticketID;
+    memcpy(sealed.name, booking->name, sizeof(sealed.name));
+    sealed.currentCityID = booking->currentCityID;
+    sealed.destinationCityID = booking->destinationCityID;
+    sealed.price = booking->price;
+    sealed.categoryID = booking->categoryID;
+    sealed.modeID = booking->modeID;
+    memcpy(sealed.seatRuns, booking->seatRuns, sizeof(sealed.seatRuns));
+    sealed.bookedSeat = booking->bookedSeat;
+    sealed.returnTicket = booking->returnTicket;
+    sealed.numTravelers = booking->numTravelers;
+    sealed.createdAt = booking->createdAt;
+    sealed.travelDate = booking->travelDate;
+    sealed.version = booking->version;
+    sealed.checksum = recordChecksum(&sealed, sizeof(sealed), offsetof(struct Booking, checksum));
+    memcpy(booking, &sealed, sizeof(sealed));
+}
 
-    printf(" | Seats Booked: ");
-    for (int j = 0; j < n; j++)
-    {
-        printf("%d ", partial->booking.seats[j]);
-    }
-    printf("%*s|\n", 39 - (2 * n), ""); // Adjust spacing based on seat numbers
+void sealUser(struct User *user)
+{
+    struct User sealed;
+    memset(&sealed, 0, sizeof(sealed));
+    memcpy(sealed.name, user->name, sizeof(sealed.name));
+    sealed.points = user->points;
+    sealed.checksum = recordChecksum(&sealed, sizeof(sealed), offsetof(struct User, checksum));
+    memcpy(user, &sealed, sizeof(sealed));
+}
 
-    printf(" | Price: Rs.%-35d |\n", partial->booking.price);
-    printf(" +--------------------------------------------------+\n");
+void sealFeedback(struct Feedback *feedback)
+{
+    struct Feedback sealed;
+    memset(&sealed, 0, sizeof(sealed));
+    sealed.ticketID = feedback->ticketID;
+    memcpy(sealed.name, feedback->name, sizeof(sealed.name));
+    sealed.rating = feedback->rating;
+    memcpy(sealed.comments, feedback->comments, sizeof(sealed.comments));
+    sealed.checksum = recordChecksum(&sealed, sizeof(sealed), offsetof(struct Feedback, checksum));
+    memcpy(feedback, &sealed, sizeof(sealed));
 }
 
-void addBooking()
+bool bookingIntact(const struct Booking *booking)
 {
-    struct PartialBooking partial;
-    bool resuming = false;
-    char bookingReference[20]; // To store the generated booking reference number
+    return recordIntact(booking, sizeof(*booking), offsetof(struct Booking, checksum));
+}
 
-    char userName[MAX_NAME_LENGTH];
-    strcpy(userName, partial.booking.name);
-    
-    TransportMode(&partial);
-    if (loadPartialBooking(&partial) && partial.inProgress)
+bool damagedRecordsReported = false;
+
+// All-zero records are regions reserved by appendLocked() whose data has not
+// landed yet.
+bool recordBlank(const void *record, size_t size)
+{
+    const unsigned char *bytes = record;
+    return bytes[0] == 0 && memcmp(bytes, bytes + 1, size - 1) == 0;
+}
+
+// Reads the next intact record from file, skipping damaged ones. Returns
+// false at end of file.
+bool readRecord(FILE *file, void *record, size_t size, size_t checksumOffset, const char *path)
+{
+    while (fread(record, size, 1, file) == 1)
     {
-        printf("You have a partially completed booking. Do you want to resume? (1: Yes, 0: No): ");
-        int choice;
-        if (scanf("%d", &choice) != 1)
+        if (recordIntact(record, size, checksumOffset))
         {
-            printf("Error: Invalid input. Starting a new booking.\n");
-            clearInputBuffer();
-            partial.inProgress = false;
-            partial.stage = 0;
+            return true;
         }
-        else if (choice == 1)
+        if (recordBlank(record, size))
         {
-            resuming = true;
+            continue; // Reserved by an append that is still being written
         }
-        else
+        if (!damagedRecordsReported)
         {
-            partial.inProgress = false;
-            partial.stage = 0;
+            printf("Warning: %s has damaged records, they are skipped. Run with --verify --repair to fix it.\n", path);
+            damagedRecordsReported = true;
         }
-        clearInputBuffer();
     }
-    else
+    return false;
+}
+
+bool readBooking(FILE *file, struct Booking *booking)
+{
+    return readRecord(file, booking, sizeof(*booking), offsetof(struct Booking, checksum), FILENAME);
+}
+
+bool readUser(FILE *file, struct User *user)
+{
+    return readRecord(file, user, sizeof(*user), offsetof(struct User, checksum), POINTS_FILENAME);
+}
+
+bool readFeedback(FILE *file, struct Feedback *feedback)
+{
+    return readRecord(file, feedback, sizeof(*feedback), offsetof(struct Feedback, checksum), FEEDBACK_FILENAME);
+}
+
+// Each data file starts with a header naming the layout of its records, so
+// records of another layout are never mistaken for damaged ones. Files from
+// before the header are converted by migrateDataFiles() at startup.
+struct DataFileHeader
+{
+    unsigned int magic; // DATA_FILE_MAGIC
+    unsigned int layout;
+    unsigned int recordSize;
+    unsigned int generation; // One more than the file this one replaced, see readFileIdentity()
+};
+
+#define DATA_HEADER_SIZE ((off_t)sizeof(struct DataFileHeader))
+
+struct DataFile
+{
+    const char *path;
+    unsigned int layout;
+    size_t recordSize;
+    size_t checksumOffset;
+};
+
+const struct DataFile dataFiles[] = {
+    {FILENAME, BOOKINGS_LAYOUT, sizeof(struct Booking), offsetof(struct Booking, checksum)},
+    {POINTS_FILENAME, POINTS_LAYOUT, sizeof(struct User), offsetof(struct User, checksum)},
+    {FEEDBACK_FILENAME, FEEDBACK_LAYOUT, sizeof(struct Feedback), offsetof(struct Feedback, checksum)},
+    {SESSION_JOURNAL_FILENAME, BOOKINGS_LAYOUT, sizeof(struct Booking), offsetof(struct Booking, checksum)}, // Snapshot payloads
+};
+
+const int numDataFiles = sizeof(dataFiles) / sizeof(dataFiles[0]);
+
+const struct DataFile *dataFileFor(const char *path)
+{
+    for (int i = 0; i < numDataFiles; i++)
     {
-        partial.inProgress = true;
-        partial.stage = 0;
+        if (strcmp(dataFiles[i].path, path) == 0)
+        {
+            return &dataFiles[i];
+        }
     }
+    return NULL;
+}
 
-    if (!resuming || partial.stage == 0)
+void dataFileHeader(const struct DataFile *file, struct DataFileHeader *header)
+{
+    memset(header, 0, sizeof(*header));
+    header->magic = DATA_FILE_MAGIC;
+    header->layout = file->layout;
+    header->recordSize = file->recordSize;
+}
+
+// True if fd starts with the header of the layout this build reads.
+bool dataHeaderCurrent(int fd, const char *path)
+{
+    struct DataFileHeader header, expected;
+    dataFileHeader(dataFileFor(path), &expected);
+    return pread(fd, &header, sizeof(header), 0) == sizeof(header) && header.magic == expected.magic &&
+           header.layout == expected.layout && header.recordSize == expected.recordSize;
+}
+
+// The file now at path, down to its contents: every append or in-place
+// write, by any process, changes its size or modification time.
+struct FileVersion
+{
+    struct FileIdentity identity;
+    off_t size;
+    struct timespec modified;
+};
+
+// Reads the version of the file now at path. All zero if it is missing.
+void readFileVersion(const char *path, struct FileVersion *version)
+{
+    memset(version, 0, sizeof(*version));
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    struct DataFileHeader header;
+    if (fd < 0)
     {
-        partial.booking.ticketID = unique_id();
-        partial.stage = 1;
+        return;
     }
-
-    if (!resuming || partial.stage <= 1)
+    if (fstat(fd, &st) == 0)
     {
-        printf("\n");
-        // Get Name
-        do
-        {
-            printf("Enter Name (alphabets and spaces only, or 'pause' to pause): ");
+        version->identity.device = st.st_dev;
+        version->identity.inode = st.st_ino;
+        version->size = st.st_size;
+        version->modified = st.st_mtim;
+    }
+    if (pread(fd, &header, sizeof(header), 0) == sizeof(header) && header.magic == DATA_FILE_MAGIC)
+    {
+        version->identity.generation = header.generation;
+    }
+    close(fd);
+}
+
+// Identifies the file now at path: its inode, plus the generation from its
+// header, since a replaced file's inode number can be reused by the next
+// one. All zero if the file is missing.
+void readFileIdentity(const char *path, struct FileIdentity *identity)
+{
+    struct FileVersion version;
+    readFileVersion(path, &version);
+    *identity = version.identity;
+}
+
+bool sameFileIdentity(const struct FileIdentity *a, const struct FileIdentity *b)
+{
+    return a->device == b->device && a->inode == b->inode && a->generation == b->generation;
+}
+
+bool sameFileVersion(const struct FileVersion *a, const struct FileVersion *b)
+{
+    return sameFileIdentity(&a->identity, &b->identity) && a->size == b->size &&
+           a->modified.tv_sec == b->modified.tv_sec && a->modified.tv_nsec == b->modified.tv_nsec;
+}
+
+// Writes the header for a file that will replace path, or be created there.
+bool writeDataHeader(FILE *file, const char *path)
+{
+    struct DataFileHeader header;
+    struct FileIdentity replaced;
+    dataFileHeader(dataFileFor(path), &header);
+    readFileIdentity(path, &replaced);
+    header.generation = replaced.generation + 1;
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+// Offset of record index in a data file of size-byte records.
+off_t recordOffset(long long index, size_t size)
+{
+    return DATA_HEADER_SIZE + index * (off_t)size;
+}
+
+// Whole records in a data file of fileSize bytes.
+long long recordCount(off_t fileSize, size_t size)
+{
+    return fileSize > DATA_HEADER_SIZE ? (fileSize - DATA_HEADER_SIZE) / (off_t)size : 0;
+}
+
+// Opens a data file for reading, positioned at its first record. Returns
+// NULL if the file is missing or holds another layout.
+FILE *openDataFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    if (!dataHeaderCurrent(fileno(file), path) || fseeko(file, DATA_HEADER_SIZE, SEEK_SET) != 0)
+    {
+        printf("Error: %s is not in the layout this version reads. Restart the program to convert it.\n", path);
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+// Creates path holding just a header unless it exists. The header is written
+// to a private file that is then linked into place, so appends from other
+// processes can never land in front of it.
+bool createDataFile(const char *path)
+{
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.new-%ld", path, (long)getpid());
+    FILE *file = fopen(tempPath, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool written = writeDataHeader(file, path);
+    written = fclose(file) == 0 && written;
+    bool created = written && (link(tempPath, path) == 0 || errno == EEXIST);
+    unlink(tempPath);
+    return created;
+}
+
+void printCentered(const char *str, int width)
+{
+    int len = strlen(str);
+    int spaces = (width - len) / 2;
+    if (spaces < 0)
+        spaces = 0;                     // In case the string is longer than width
+    printf("%*s%s\n", spaces, "", str); // Print spaces and the string
+}
+
+
+struct Calendar tickets[30];
+
+void Initilize_Calendar() {
+    int dayCount = 30;
+   for (int i = 0; i < dayCount; i++) {
+        snprintf(tickets[i].date, sizeof(tickets[i].date), "2024-10-%02d", i + 1); // Dates from Oct 01 to Oct 30
+        tickets[i].currentCityID = i % numCities;
+        tickets[i].destinationCityID = (i + 1) % numCities;
+        tickets[i].standardPrice = ticketPrices[i % (sizeof(ticketPrices) / sizeof(ticketPrices[0]))][0];
+        tickets[i].vipPrice = ticketPrices[i % (sizeof(ticketPrices) / sizeof(ticketPrices[0]))][1];
+        tickets[i].available = freeSeatsOnRoute(tickets[i].currentCityID, tickets[i].destinationCityID, MODE_TRAIN) > 0;
+    }
+}
+
+
+// Bookings keep their seats as runs of adjacent seats, in traveller order, so
+// a group seated together costs one run whatever its size.
+
+// Number of separate runs the seats, in this order, make up.
+int countSeatRuns(const int *seats, int count)
+{
+    int runs = 0;
+    for (int i = 0; i < count; i++)
+    {
+        runs += i == 0 || seats[i] != seats[i - 1] + 1;
+    }
+    return runs;
+}
+
+// Stores seats in booking. Returns false, leaving booking unchanged, if they
+// do not fit into MAX_SEAT_RUNS runs.
+bool setBookingSeats(struct Booking *booking, const int *seats, int count)
+{
+    if (countSeatRuns(seats, count) > MAX_SEAT_RUNS)
+    {
+        return false;
+    }
+    memset(booking->seatRuns, 0, sizeof(booking->seatRuns));
+    int run = -1;
+    for (int i = 0; i < count; i++)
+    {
+        if (run < 0 || seats[i] != seats[i - 1] + 1)
+        {
+            booking->seatRuns[++run].first = seats[i];
+        }
+        booking->seatRuns[run].count++;
+    }
+    return true;
+}
+
+// Expands the seat runs of booking into seatsOut, which has room for
+// MAX_TRAVELERS seats. Returns the number of seats.
+int bookingSeats(const struct Booking *booking, int *seatsOut)
+{
+    int count = 0;
+    for (int run = 0; run < MAX_SEAT_RUNS && booking->seatRuns[run].count != 0; run++)
+    {
+        for (int i = 0; i < booking->seatRuns[run].count && count < MAX_TRAVELERS; i++)
+        {
+            seatsOut[count++] = booking->seatRuns[run].first + i;
+        }
+    }
+    return count;
+}
+
+int bookingSeatCount(const struct Booking *booking)
+{
+    int seats[MAX_TRAVELERS];
+    return bookingSeats(booking, seats);
+}
+
+// Coach classes of every train, front to back. The bay of a class lists the
+// berth types in numbering order and repeats along the coach: L lower,
+// M middle, U upper, l side lower, u side upper.
+struct CoachClass
+{
+    const char *name;
+    char coachPrefix;
+    int coaches;
+    int berthsPerCoach;
+    const char *bay;
+};
+
+const struct CoachClass coachClasses[TRAIN_CLASSES] = {
+    {"1A", 'H', 1, 24, "LULU"},
+    {"2A", 'A', 2, 48, "LULUlu"},
+    {"3A", 'B', 6, 64, "LMULMUlu"},
+    {"SL", 'S', 10, 72, "LMULMUlu"},
+};
+const char berthLetters[] = "LMUlu"; // Indexed by enum BerthType
+const char *berthCodes[BERTH_TYPES] = {"LB", "MB", "UB", "SL", "SU"};
+const char *berthTypeNames[BERTH_TYPES] = {"Lower", "Middle", "Upper", "Side lower", "Side upper"};
+
+// Where each coach of a train sits among its seat numbers.
+struct CoachLayout
+{
+    int classIndex;
+    int number; // Within its class, from 1; bit number - 1 of the class's openCoaches words
+    int firstSeat;
+    int berths;
+};
+
+struct CoachLayout trainCoaches[MAX_TRAIN_COACHES];
+int trainCoachCount = 0;
+int trainBerthCount = 0; // Seats on every train route
+int classFirstCoach[TRAIN_CLASSES];
+
+void initializeTrainLayout()
+{
+    if (trainCoachCount > 0)
+    {
+        return;
+    }
+    for (int k = 0; k < TRAIN_CLASSES; k++)
+    {
+        classFirstCoach[k] = trainCoachCount;
+        for (int c = 0; c < coachClasses[k].coaches; c++)
+        {
+            struct CoachLayout *coach = &trainCoaches[trainCoachCount++];
+            coach->classIndex = k;
+            coach->number = c + 1;
+            coach->firstSeat = trainBerthCount + 1;
+            coach->berths = coachClasses[k].berthsPerCoach;
+            trainBerthCount += coach->berths;
+        }
+    }
+}
+
+int coachOfSeat(int seatNum)
+{
+    int c = trainCoachCount - 1;
+    while (c > 0 && trainCoaches[c].firstSeat > seatNum)
+    {
+        c--;
+    }
+    return c;
+}
+
+int berthTypeAt(const struct CoachLayout *coach, int seatNum)
+{
+    const char *bay = coachClasses[coach->classIndex].bay;
+    return strchr(berthLetters, bay[(seatNum - coach->firstSeat) % strlen(bay)]) - berthLetters;
+}
+
+// Writes a train seat as coach, berth and berth type, e.g. "B2-17 LB".
+void formatBerth(int seatNum, char *label, size_t size)
+{
+    const struct CoachLayout *coach = &trainCoaches[coachOfSeat(seatNum)];
+    snprintf(label, size, "%c%d-%d %s", coachClasses[coach->classIndex].coachPrefix, coach->number,
+             seatNum - coach->firstSeat + 1, berthCodes[berthTypeAt(coach, seatNum)]);
+}
+
+// Bus sizes per city pair, read once from ROUTE_CAPACITY_FILENAME. Each
+// line reads "From,To,Seats"; pairs that are not listed get
+// DEFAULT_ROUTE_SEATS. Trains all run the coaches in coachClasses. The size
+// is fixed when a route is first created.
+unsigned short *routeCapacities = NULL; // numCities x numCities, 0 for the default
+bool routeCapacitiesLoaded = false;
+
+void loadRouteCapacities()
+{
+    routeCapacitiesLoaded = true;
+    FILE *file = fopen(ROUTE_CAPACITY_FILENAME, "r");
+    if (file == NULL)
+    {
+        return;
+    }
+    routeCapacities = calloc((size_t)numCities * numCities, sizeof(unsigned short));
+    char line[256];
+    int lineNumber = 0;
+    while (routeCapacities != NULL && fgets(line, sizeof(line), file) != NULL)
+    {
+        lineNumber++;
+        char from[MAX_DESTINATION_LENGTH], to[MAX_DESTINATION_LENGTH];
+        int seats;
+        if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#')
+        {
+            continue;
+        }
+        int currentCityID = -1, destinationCityID = -1;
+        if (sscanf(line, " %49[^,],%49[^,],%d", from, to, &seats) == 3)
+        {
+            currentCityID = findCityID(from);
+            destinationCityID = findCityID(to);
+        }
+        if (currentCityID < 0 || destinationCityID < 0 || seats < 1 || seats > MAX_ROUTE_SEATS)
+        {
+            fprintf(stderr, "Warning: %s:%d ignored, expected \"From,To,Seats\" with 1-%d seats.\n",
+                    ROUTE_CAPACITY_FILENAME, lineNumber, MAX_ROUTE_SEATS);
+            continue;
+        }
+        routeCapacities[currentCityID * numCities + destinationCityID] = seats;
+    }
+    fclose(file);
+}
+
+int routeCapacityFor(int currentCityID, int destinationCityID, int modeID)
+{
+    if (modeID == MODE_TRAIN)
+    {
+        return trainBerthCount;
+    }
+    if (!routeCapacitiesLoaded)
+    {
+        loadRouteCapacities();
+    }
+    if (routeCapacities != NULL && currentCityID >= 0 && currentCityID < numCities &&
+        destinationCityID >= 0 && destinationCityID < numCities &&
+        routeCapacities[currentCityID * numCities + destinationCityID] != 0)
+    {
+        return routeCapacities[currentCityID * numCities + destinationCityID];
+    }
+    return DEFAULT_ROUTE_SEATS;
+}
+
+int routeWordCount(const struct Routs *route)
+{
+    return (route->capacity + SEAT_WORD_BITS - 1) / SEAT_WORD_BITS;
+}
+
+unsigned long long *routeSeatWords(const struct Routs *route)
+{
+    return &seatMap->seatWords[route->firstWord];
+}
+
+// Hold on a seat, see holdSeatRoute().
+unsigned long long *seatHolder(int routeIndex, int seatNum)
+{
+    return &seatMap->holders[(long)seatMap->routes[routeIndex].firstWord * SEAT_WORD_BITS + seatNum - 1];
+}
+
+// A held seat records the holding process and the second its hold runs
+// out, in one word so it is set and cleared atomically. Any process can
+// then tell an expired hold from a live one and free the seat.
+unsigned long long seatHolderWord(pid_t pid, long long expiresAt)
+{
+    return ((unsigned long long)(unsigned int)expiresAt << 32) | (unsigned int)pid;
+}
+
+pid_t seatHolderPid(unsigned long long word)
+{
+    return (pid_t)(word & 0xffffffffu);
+}
+
+long long seatHolderDeadline(unsigned long long word)
+{
+    return (long long)(word >> 32);
+}
+
+// Ends the hold on a seat if it is still the one expected. Returns false if
+// it was confirmed, released or expired meanwhile, possibly elsewhere.
+bool clearSeatHolder(int routeIndex, int seatNum, unsigned long long expected)
+{
+    return __atomic_compare_exchange_n(seatHolder(routeIndex, seatNum), &expected, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// Routes bucketed by free-seat count. Each bucket is a doubly linked list
+// threaded through route indices, so sold-out routes or routes with at least
+// N free seats are found without reading any seat map.
+
+void linkFreeCountBucket(int r)
+{
+    struct Routs *route = &seatMap->routes[r];
+    int bucket = route->freeCount;
+    route->freeCountPrev = 0;
+    route->freeCountNext = seatMap->freeCountBuckets[bucket];
+    if (seatMap->freeCountBuckets[bucket] != 0)
+    {
+        seatMap->routes[seatMap->freeCountBuckets[bucket] - 1].freeCountPrev = r + 1;
+    }
+    seatMap->freeCountBuckets[bucket] = r + 1;
+}
+
+void unlinkFreeCountBucket(int r)
+{
+    struct Routs *route = &seatMap->routes[r];
+    if (route->freeCountPrev != 0)
+    {
+        seatMap->routes[route->freeCountPrev - 1].freeCountNext = route->freeCountNext;
+    }
+    else
+    {
+        seatMap->freeCountBuckets[route->freeCount] = route->freeCountNext;
+    }
+    if (route->freeCountNext != 0)
+    {
+        seatMap->routes[route->freeCountNext - 1].freeCountPrev = route->freeCountPrev;
+    }
+}
+
+// Recounts every route from its seat bits and relinks the buckets, after a
+// process died while holding the seat map lock.
+void rebuildFreeCounts()
+{
+    memset(seatMap->freeCountBuckets, 0, sizeof(seatMap->freeCountBuckets));
+    for (int r = 0; r < seatMap->routeCount; r++)
+    {
+        const unsigned long long *words = routeSeatWords(&seatMap->routes[r]);
+        int count = 0;
+        for (int w = 0; w < routeWordCount(&seatMap->routes[r]); w++)
+        {
+            count += __builtin_popcountll(words[w]);
+        }
+        seatMap->routes[r].freeCount = count;
+        linkFreeCountBucket(r);
+        recountTrainInventory(&seatMap->routes[r]);
+    }
+}
+
+void lockSeatMap()
+{
+    if (pthread_mutex_lock(&seatMap->header.lock) == EOWNERDEAD)
+    {
+        rebuildFreeCounts(); // Seat bits are always consistent, the counts may not be
+        pthread_mutex_consistent(&seatMap->header.lock);
+    }
+}
+
+void unlockSeatMap()
+{
+    pthread_mutex_unlock(&seatMap->header.lock);
+}
+
+// Routes join the buckets in addRoute(); slots past routeCount are not
+// linked. Called with the seat map locked.
+void setFreeCount(struct Routs *route, int count)
+{
+    int r = route - seatMap->routes;
+    if (r < seatMap->routeCount)
+    {
+        unlinkFreeCountBucket(r);
+    }
+    __atomic_store_n(&route->freeCount, count, __ATOMIC_RELEASE);
+    if (r < seatMap->routeCount)
+    {
+        linkFreeCountBucket(r);
+    }
+}
+
+// Seat maps are bitsets: one bit per seat, set while the seat is free.
+// Seats outside the vehicle are never free.
+bool seatIsFree(const struct Routs *route, int seatNum)
+{
+    return seatNum >= 1 && seatNum <= route->capacity &&
+           (__atomic_load_n(&routeSeatWords(route)[(seatNum - 1) / SEAT_WORD_BITS], __ATOMIC_ACQUIRE) >> ((seatNum - 1) % SEAT_WORD_BITS)) & 1;
+}
+
+void setCoachBit(unsigned long long *word, int bit, bool open)
+{
+    if (open)
+    {
+        __atomic_fetch_or(word, 1ULL << bit, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        __atomic_fetch_and(word, ~(1ULL << bit), __ATOMIC_RELEASE);
+    }
+}
+
+// Keeps a train's coach counts and summary bits in step with a berth being
+// booked (delta -1) or freed (delta 1). Called with the seat map locked.
+void trainBerthChanged(const struct Routs *route, int seatNum, int delta)
+{
+    if (route->train < 0)
+    {
+        return;
+    }
+    struct TrainInventory *train = &seatMap->trains[route->train];
+    int c = coachOfSeat(seatNum);
+    const struct CoachLayout *layout = &trainCoaches[c];
+    int type = berthTypeAt(layout, seatNum);
+    struct CoachInventory *coach = &train->coaches[c];
+    coach->freeCount += delta;
+    coach->freeBerths[type] += delta;
+    setCoachBit(&train->openCoaches[layout->classIndex][BERTH_ANY], layout->number - 1, coach->freeCount > 0);
+    setCoachBit(&train->openCoaches[layout->classIndex][type], layout->number - 1, coach->freeBerths[type] > 0);
+}
+
+// Rebuilds a train's inventory from its seat bits. Called with the seat map
+// locked.
+void recountTrainInventory(const struct Routs *route)
+{
+    if (route->train < 0)
+    {
+        return;
+    }
+    memset(&seatMap->trains[route->train], 0, sizeof(struct TrainInventory));
+    for (int seat = 1; seat <= route->capacity; seat++)
+    {
+        if (seatIsFree(route, seat))
+        {
+            trainBerthChanged(route, seat, 1);
+        }
+    }
+}
+
+// Claims a seat. Returns false if it was already taken, possibly by another
+// process, or is not on the vehicle.
+bool markSeatBooked(struct Routs *route, int seatNum)
+{
+    if (seatNum < 1 || seatNum > route->capacity)
+    {
+        return false;
+    }
+    unsigned long long bit = 1ULL << ((seatNum - 1) % SEAT_WORD_BITS);
+    lockSeatMap();
+    bool claimed = __atomic_fetch_and(&routeSeatWords(route)[(seatNum - 1) / SEAT_WORD_BITS], ~bit, __ATOMIC_ACQ_REL) & bit;
+    if (claimed)
+    {
+        setFreeCount(route, route->freeCount - 1);
+        trainBerthChanged(route, seatNum, -1);
+    }
+    unlockSeatMap();
+    if (claimed)
+    {
+        journeyRouteChanged(route);
+    }
+    return claimed;
+}
+
+void markSeatFree(struct Routs *route, int seatNum)
+{
+    if (seatNum < 1 || seatNum > route->capacity)
+    {
+        return;
+    }
+    unsigned long long bit = 1ULL << ((seatNum - 1) % SEAT_WORD_BITS);
+    lockSeatMap();
+    bool released = !(__atomic_fetch_or(&routeSeatWords(route)[(seatNum - 1) / SEAT_WORD_BITS], bit, __ATOMIC_ACQ_REL) & bit);
+    if (released)
+    {
+        setFreeCount(route, route->freeCount + 1);
+        trainBerthChanged(route, seatNum, 1);
+    }
+    unlockSeatMap();
+    if (released)
+    {
+        journeyRouteChanged(route);
+    }
+}
+
+// Called with the seat map locked.
+void markAllSeatsFree(struct Routs *route)
+{
+    unsigned long long *words = routeSeatWords(route);
+    for (int w = 0; w < routeWordCount(route); w++)
+    {
+        int bits = route->capacity - w * SEAT_WORD_BITS;
+        __atomic_store_n(&words[w], bits >= SEAT_WORD_BITS ? ~0ULL : (1ULL << bits) - 1, __ATOMIC_RELEASE);
+    }
+    setFreeCount(route, route->capacity);
+    recountTrainInventory(route);
+}
+
+int findRouteIndex(int currentCityID, int destinationCityID, int modeID)
+{
+    int count = __atomic_load_n(&seatMap->routeCount, __ATOMIC_ACQUIRE); // Routes are published by addRoute()
+    for (int i = 0; i < count; i++)
+    {
+        if (seatMap->routes[i].currentCityID == currentCityID &&
+            seatMap->routes[i].destinationCityID == destinationCityID &&
+            seatMap->routes[i].modeID == modeID)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// The segment name is derived from the data directory, so counters working
+// on the same files share one seat map and other directories get their own.
+void seatMapName(char *name, size_t size)
+{
+    char cwd[4096];
+    unsigned int h = 2166136261u;
+    if (getcwd(cwd, sizeof(cwd)) != NULL)
+    {
+        for (const char *p = cwd; *p; p++)
+        {
+            h = (h ^ (unsigned char)*p) * 16777619u;
+        }
+    }
+    snprintf(name, size, "/booking-seats-%08x", h);
+}
+
+void initializeSeatMapLock(struct SeatMap *map, bool shared)
+{
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE); // Loading calls addRoute() under the lock
+    if (shared)
+    {
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    }
+    pthread_mutex_init(&map->header.lock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+}
+
+// Maps the shared seat map, creating it if this is the first process.
+// Returns false if it cannot be used; the caller then keeps a private map.
+bool attachSeatMap()
+{
+    char name[64];
+    seatMapName(name, sizeof(name));
+    bool created = true;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST)
+    {
+        created = false;
+        fd = shm_open(name, O_RDWR, 0600);
+    }
+    if (fd < 0 || (created && ftruncate(fd, sizeof(struct SeatMap)) != 0))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            shm_unlink(name);
+        }
+        return false;
+    }
+
+    struct stat info;
+    struct SeatMap *map = MAP_FAILED;
+    // A segment being created may not have its final size yet
+    for (int waited = 0; waited < 200 && (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(struct SeatMapHeader)); waited++)
+    {
+        usleep(10000);
+    }
+    if (info.st_size >= (off_t)sizeof(struct SeatMapHeader))
+    {
+        map = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    if (created)
+    {
+        initializeSeatMapLock(map, true);
+        map->header.version = SEAT_MAP_VERSION;
+        map->header.size = sizeof(struct SeatMap);
+        map->header.routeCapacity = MAX_ROUTES;
+        map->header.seatArenaWords = SEAT_ARENA_WORDS;
+        __atomic_store_n(&map->header.magic, SEAT_MAP_MAGIC, __ATOMIC_RELEASE);
+    }
+    for (int waited = 0; waited < 200 && __atomic_load_n(&map->header.magic, __ATOMIC_ACQUIRE) != SEAT_MAP_MAGIC; waited++)
+    {
+        usleep(10000);
+    }
+    if (map->header.magic != SEAT_MAP_MAGIC || map->header.version != SEAT_MAP_VERSION ||
+        map->header.size != sizeof(struct SeatMap) || info.st_size < (off_t)sizeof(struct SeatMap) ||
+        map->header.routeCapacity != MAX_ROUTES || map->header.seatArenaWords != SEAT_ARENA_WORDS)
+    {
+        fprintf(stderr, "Warning: Shared seat map %s has a different layout, seats are tracked per process.\n", name);
+        munmap(map, info.st_size);
+        return false;
+    }
+    seatMap = map;
+    seatMapShared = true;
+    return true;
+}
+
+// Removes the shared seat map so the next process rebuilds it from
+// bookings.dat. Processes already attached keep their mapping.
+void resetSharedSeatMap()
+{
+    char name[64];
+    seatMapName(name, sizeof(name));
+    shm_unlink(name);
+}
+
+// Detaches from a shared seat map that no longer matches bookings.dat,
+// unlinking it unless another process already has. Called with the seat
+// map locked; leaves no map behind.
+void retireSharedSeatMap()
+{
+    if (!seatMap->header.retired)
+    {
+        seatMap->header.retired = 1;
+        resetSharedSeatMap();
+    }
+    unlockSeatMap();
+    munmap(seatMap, sizeof(struct SeatMap));
+    seatMap = NULL;
+    seatMapShared = false;
+}
+
+// Records the bookings.dat now in place as the one the seat map matches.
+// For rewrites made by this process, which kept the seats in step.
+void recordSeatMapSource()
+{
+    if (seatMap == NULL)
+    {
+        return;
+    }
+    lockSeatMap();
+    readFileIdentity(FILENAME, &seatMap->header.source);
+    unlockSeatMap();
+}
+
+// Frees seats held by counters that exited without booking or releasing
+// them, which would otherwise stay taken in the shared map.
+void releaseOrphanedHolds()
+{
+    lockSeatMap();
+    for (int r = 0; r < seatMap->routeCount; r++)
+    {
+        for (int seat = 1; seat <= seatMap->routes[r].capacity; seat++)
+        {
+            unsigned long long holder = __atomic_load_n(seatHolder(r, seat), __ATOMIC_ACQUIRE);
+            pid_t pid = seatHolderPid(holder);
+            if (holder != 0 && pid != getpid() && kill(pid, 0) != 0 && errno == ESRCH && clearSeatHolder(r, seat, holder))
+            {
+                markSeatFree(&seatMap->routes[r], seat);
+            }
+        }
+    }
+    unlockSeatMap();
+}
+
+// Maps a seat map for this process alone. Like the shared one it is
+// reserved at full size and only backed as routes are added.
+bool mapPrivateSeatMap()
+{
+    struct SeatMap *map = mmap(NULL, sizeof(struct SeatMap), PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+    initializeSeatMapLock(map, false);
+    seatMap = map;
+    return true;
+}
+
+// Attaches to the live seat map if another process already built it from
+// the bookings.dat now in place, or builds it from bookings.dat otherwise.
+void initializeSeats()
+{
+    const char *choice = getenv(SEAT_MAP_ENV);
+    bool wantShared = (choice == NULL || strcmp(choice, "private") != 0) && !seatMapPrivate;
+    initializeTrainLayout();
+    for (int attempt = 0;; attempt++)
+    {
+        if ((!wantShared || !attachSeatMap()) && !mapPrivateSeatMap())
+        {
+            fprintf(stderr, "Error: Unable to map the seat map.\n");
+            exit(1);
+        }
+        lockSeatMap();
+        if (!seatMap->header.ready)
+        {
+            break;
+        }
+        struct FileIdentity current;
+        readFileIdentity(FILENAME, &current);
+        if (!seatMap->header.retired && sameFileIdentity(&current, &seatMap->header.source))
+        {
+            unlockSeatMap();
+            releaseOrphanedHolds();
+            return;
+        }
+        if (attempt == 2) // The file keeps changing; reload this map rather than chase it
+        {
+            break;
+        }
+        retireSharedSeatMap();
+    }
+    seatMap->routeCount = 0; // Routes reset their seat words and holders as they are added again
+    seatMap->seatWordCount = 0;
+    seatMap->trainCount = 0;
+    memset(seatMap->freeCountBuckets, 0, sizeof(seatMap->freeCountBuckets));
+    struct Booking booking;
+    prepareBookingsView(); // Startup; the travel index is only built on first use
+    readFileIdentity(FILENAME, &seatMap->header.source); // Before reading, so a file replaced meanwhile is caught by the next process
+    FILE *file = openDataFile(FILENAME);
+
+    if (file != NULL)
+    {
+        while (readBooking(file, &booking))
+        {
+            // Find the route and mark its seats as booked
+            int r = addRoute(booking.currentCityID, booking.destinationCityID, booking.modeID);
+            int seats[MAX_TRAVELERS];
+            int seatCount = bookingSeats(&booking, seats);
+            for (int j = 0; r >= 0 && j < seatCount; j++)
+            {
+                markSeatBooked(&seatMap->routes[r], seats[j]);
+            }
+        }
+        fclose(file);
+    }
+    seatMap->header.ready = 1;
+    unlockSeatMap();
+}
+
+// Returns the index of the route between two cities by one mode, creating
+// it with seats for its vehicle if needed, or -1 once the route table, the
+// seat arena or the train inventories are full.
+int addRoute(int currentCityID, int destinationCityID, int modeID)
+{
+    lockSeatMap(); // Another process may be adding the same route
+    int r = findRouteIndex(currentCityID, destinationCityID, modeID);
+    if (r >= 0)
+    {
+        unlockSeatMap();
+        return r; // Route already exists
+    }
+    r = seatMap->routeCount;
+    int capacity = routeCapacityFor(currentCityID, destinationCityID, modeID);
+    int words = (capacity + SEAT_WORD_BITS - 1) / SEAT_WORD_BITS;
+    if (r == MAX_ROUTES || seatMap->seatWordCount + words > SEAT_ARENA_WORDS ||
+        (modeID == MODE_TRAIN && seatMap->trainCount == MAX_TRAINS))
+    {
+        unlockSeatMap();
+        return -1;
+    }
+    // If route does not exist, initialize it
+    struct Routs *route = &seatMap->routes[r];
+    route->currentCityID = currentCityID;
+    route->destinationCityID = destinationCityID;
+    route->modeID = modeID;
+    route->train = modeID == MODE_TRAIN ? seatMap->trainCount++ : -1;
+    route->capacity = capacity;
+    route->firstWord = seatMap->seatWordCount;
+    seatMap->seatWordCount += words;
+    memset(seatHolder(r, 1), 0, (size_t)words * SEAT_WORD_BITS * sizeof(seatMap->holders[0]));
+    markAllSeatsFree(route); // Set all seats to available
+    linkFreeCountBucket(r);
+    __atomic_store_n(&seatMap->routeCount, r + 1, __ATOMIC_RELEASE);
+    unlockSeatMap();
+    return r;
+}
+
+bool isSeatAvailableForRoute(int currentCityID, int destinationCityID, int modeID, int seatNum)
+{
+    advanceSeatHolds();
+    int r = findRouteIndex(currentCityID, destinationCityID, modeID);
+    return r >= 0 && seatIsFree(&seatMap->routes[r], seatNum); // If route is not found, return false
+}
+
+void bookSeatRoute(int currentCityID, int destinationCityID, int modeID, int seatNum)
+{
+    int r = findRouteIndex(currentCityID, destinationCityID, modeID);
+    if (r >= 0)
+    {
+        markSeatBooked(&seatMap->routes[r], seatNum); // Mark the seat as booked
+    }
+}
+
+void freeSeatRoute(int currentCityID, int destinationCityID, int modeID, int seatNum)
+{
+    int r = findRouteIndex(currentCityID, destinationCityID, modeID);
+    if (r >= 0)
+    {
+        markSeatFree(&seatMap->routes[r], seatNum); // Mark the seat as available again
+    }
+}
+
+// dst = src >> shift across a seat bitset of words words (bit i of dst is bit
+// i + shift of src)
+void shiftSeatBitsDown(unsigned long long *dst, const unsigned long long *src, int words, int shift)
+{
+    int wordShift = shift / SEAT_WORD_BITS;
+    int bitShift = shift % SEAT_WORD_BITS;
+    for (int w = 0; w < words; w++)
+    {
+        unsigned long long low = w + wordShift < words ? src[w + wordShift] : 0;
+        unsigned long long high = w + wordShift + 1 < words ? src[w + wordShift + 1] : 0;
+        dst[w] = bitShift == 0 ? low : (low >> bitShift) | (high << (SEAT_WORD_BITS - bitShift));
+    }
+}
+
+// Index of the lowest set bit at or above from, or -1 if there is none.
+int nextSetSeatBit(const unsigned long long *bits, int words, int from)
+{
+    for (int w = from / SEAT_WORD_BITS; w < words; w++)
+    {
+        unsigned long long word = bits[w];
+        if (w == from / SEAT_WORD_BITS)
+        {
+            word &= ~0ULL << (from % SEAT_WORD_BITS);
+        }
+        if (word != 0)
+        {
+            return w * SEAT_WORD_BITS + __builtin_ctzll(word);
+        }
+    }
+    return -1;
+}
+
+int countFreeSeats(const struct Routs *route)
+{
+    return __atomic_load_n(&route->freeCount, __ATOMIC_ACQUIRE);
+}
+
+// Free seats between two cities by one mode. Routes nobody has booked yet
+// are empty.
+int freeSeatsOnRoute(int currentCityID, int destinationCityID, int modeID)
+{
+    int r = findRouteIndex(currentCityID, destinationCityID, modeID);
+    return r < 0 ? routeCapacityFor(currentCityID, destinationCityID, modeID) : countFreeSeats(&seatMap->routes[r]);
+}
+
+// Total seats on all routes, for occupancy figures.
+long long totalRouteSeats()
+{
+    long long seats = 0;
+    int count = __atomic_load_n(&seatMap->routeCount, __ATOMIC_ACQUIRE);
+    for (int r = 0; r < count; r++)
+    {
+        seats += seatMap->routes[r].capacity;
+    }
+    return seats;
+}
+
+// Returns the routes leaving currentCityID (any city when -1) that have
+// between minFree and maxFree free seats, most free first, in a malloc'd
+// array through routesOut. Returns how many were found, or -1 if out of
+// memory.
+int findRoutesByFreeSeats(int currentCityID, int minFree, int maxFree, int **routesOut)
+{
+    int found = 0;
+    lockSeatMap();
+    *routesOut = malloc((seatMap->routeCount + 1) * sizeof(int));
+    if (*routesOut == NULL)
+    {
+        unlockSeatMap();
+        return -1;
+    }
+    for (int bucket = maxFree < MAX_ROUTE_SEATS ? maxFree : MAX_ROUTE_SEATS; bucket >= minFree && bucket >= 0; bucket--)
+    {
+        for (int r = seatMap->freeCountBuckets[bucket] - 1; r >= 0; r = seatMap->routes[r].freeCountNext - 1)
+        {
+            if (currentCityID < 0 || seatMap->routes[r].currentCityID == currentCityID)
+            {
+                (*routesOut)[found++] = r;
+            }
+        }
+    }
+    unlockSeatMap();
+    return found;
+}
+
+// Picks count free seats on a route for a group, without booking them.
+// A single contiguous block is preferred; otherwise seats are taken from the
+// largest free runs first so the group is split into as few fragments as
+// possible. Returns the number of fragments, or -1 if too few seats are free
+// or they are spread over more than MAX_SEAT_RUNS runs.
+int autoAssignSeats(int routeIndex, int count, int *seatsOut)
+{
+    const struct Routs *route = &seatMap->routes[routeIndex];
+    const unsigned long long *freeSeats = routeSeatWords(route);
+    int words = routeWordCount(route);
+    if (count <= 0 || count > countFreeSeats(route))
+    {
+        return -1;
+    }
+
+    // Fold the map onto itself so bit i survives only if seats i..i+count-1
+    // are all free, doubling the covered run length on every pass.
+    unsigned long long runs[MAX_ROUTE_SEAT_WORDS], shifted[MAX_ROUTE_SEAT_WORDS];
+    memcpy(runs, freeSeats, words * sizeof(unsigned long long));
+    for (int covered = 1; covered < count;)
+    {
+        int step = covered < count - covered ? covered : count - covered;
+        shiftSeatBitsDown(shifted, runs, words, step);
+        for (int w = 0; w < words; w++)
+        {
+            runs[w] &= shifted[w];
+        }
+        covered += step;
+    }
+    int start = nextSetSeatBit(runs, words, 0);
+    if (start >= 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            seatsOut[i] = start + i + 1;
+        }
+        return 1;
+    }
+
+    // Split the map into free runs: a run starts at a free seat whose lower
+    // neighbour is booked and ends at a free seat whose upper neighbour is.
+    unsigned long long starts[MAX_ROUTE_SEAT_WORDS], ends[MAX_ROUTE_SEAT_WORDS];
+    shiftSeatBitsDown(shifted, freeSeats, words, 1);
+    for (int w = 0; w < words; w++)
+    {
+        unsigned long long below = (freeSeats[w] << 1) | (w > 0 ? freeSeats[w - 1] >> (SEAT_WORD_BITS - 1) : 0);
+        starts[w] = freeSeats[w] & ~below;
+        ends[w] = freeSeats[w] & ~shifted[w];
+    }
+    int runStart[MAX_ROUTE_SEATS / 2 + 1], runLength[MAX_ROUTE_SEATS / 2 + 1], runCount = 0;
+    for (int first = nextSetSeatBit(starts, words, 0); first >= 0; first = nextSetSeatBit(starts, words, first + 1))
+    {
+        int end = nextSetSeatBit(ends, words, first);
+        if (end < 0)
+        {
+            break; // Another process booked the rest of the run meanwhile
+        }
+        runStart[runCount] = first;
+        runLength[runCount] = end - first + 1;
+        runCount++;
+    }
+
+    int assigned = 0, fragments = 0;
+    while (assigned < count)
+    {
+        int best = 0;
+        for (int r = 1; r < runCount; r++)
+        {
+            if (runLength[r] > runLength[best])
+            {
+                best = r;
+            }
+        }
+        if (runCount == 0 || runLength[best] == 0 || fragments == MAX_SEAT_RUNS)
+        {
+            return -1;
+        }
+        for (int i = 0; i < runLength[best] && assigned < count; i++)
+        {
+            seatsOut[assigned++] = runStart[best] + i + 1;
+        }
+        runLength[best] = 0;
+        fragments++;
+    }
+    return fragments;
+}
+
+// Adds up to count free berths of berthType (or BERTH_ANY) in one coach to
+// seatsOut. Returns how many were added.
+int pickCoachBerths(const struct Routs *route, int coach, int berthType, int count, int *seatsOut)
+{
+    const struct CoachLayout *layout = &trainCoaches[coach];
+    int picked = 0;
+    for (int seat = layout->firstSeat; seat < layout->firstSeat + layout->berths && picked < count; seat++)
+    {
+        if ((berthType == BERTH_ANY || berthTypeAt(layout, seat) == berthType) && seatIsFree(route, seat))
+        {
+            seatsOut[picked++] = seat;
+        }
+    }
+    return picked;
+}
+
+// Picks count free berths of berthType (or BERTH_ANY) in one class of a
+// train, without booking them. Only coaches whose summary bit is set are
+// visited. The group is kept in one coach when one has room, otherwise it
+// is spread over as few coaches as possible in train order. Returns the
+// number of coaches used, or -1 if too few such berths are free or they are
+// spread over more than MAX_SEAT_RUNS runs. Berths of one type are never
+// side by side, so a group of one type is refused above MAX_SEAT_RUNS.
+int autoAssignBerths(int routeIndex, int classIndex, int berthType, int count, int *seatsOut)
+{
+    const struct Routs *route = &seatMap->routes[routeIndex];
+    if (route->train < 0 || count <= 0 || (berthType != BERTH_ANY && count > MAX_SEAT_RUNS))
+    {
+        return -1;
+    }
+    const struct TrainInventory *train = &seatMap->trains[route->train];
+    unsigned long long open = __atomic_load_n(&train->openCoaches[classIndex][berthType], __ATOMIC_ACQUIRE);
+
+    for (unsigned long long coaches = open; coaches != 0; coaches &= coaches - 1)
+    {
+        int coach = classFirstCoach[classIndex] + __builtin_ctzll(coaches);
+        const struct CoachInventory *inventory = &train->coaches[coach];
+        int available = berthType == BERTH_ANY ? inventory->freeCount : inventory->freeBerths[berthType];
+        if (available >= count && pickCoachBerths(route, coach, berthType, count, seatsOut) == count)
+        {
+            return countSeatRuns(seatsOut, count) <= MAX_SEAT_RUNS ? 1 : -1;
+        }
+    }
+
+    int assigned = 0, used = 0;
+    for (unsigned long long coaches = open; coaches != 0 && assigned < count; coaches &= coaches - 1)
+    {
+        int coach = classFirstCoach[classIndex] + __builtin_ctzll(coaches);
+        int picked = pickCoachBerths(route, coach, berthType, count - assigned, seatsOut + assigned);
+        assigned += picked;
+        used += picked > 0;
+    }
+    if (assigned < count || countSeatRuns(seatsOut, count) > MAX_SEAT_RUNS)
+    {
+        return -1;
+    }
+    return used;
+}
+
+// Books all count seats or, if another process got to one first, none.
+bool claimSeats(int routeIndex, const int *seats, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (!markSeatBooked(&seatMap->routes[routeIndex], seats[i]))
+        {
+            while (i-- > 0)
+            {
+                markSeatFree(&seatMap->routes[routeIndex], seats[i]);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// Provisional seat holds. A held seat is unavailable to everyone else until
+// the hold is confirmed (the seat stays booked) or released. Unconfirmed
+// holds expire after their TTL. Expiry is driven by a hierarchical timer
+// wheel: each level has 64 slots, a hold sits in the coarsest slot that
+// covers its deadline and cascades down as the wheel turns, so each tick
+// only touches the holds that are due. The wheel only turns while its
+// process runs, so the deadline is also kept with the seat in the shared
+// map, where any other process expires it, see expireSharedHolds().
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define SEAT_HOLD_INDEX_BITS 20
+
+struct SeatHold
+{
+    int routeIndex;
+    int seatNum;
+    long long expiresAt;
+    unsigned long long holderWord; // As stored in the seat map
+    unsigned int generation; // Bumped on reuse so stale handles are rejected
+    bool active;
+    int prev;
+    int next;
+    int level;
+    int slot;
+};
+
+struct TimerWheel
+{
+    struct SeatHold *holds;
+    int capacity;
+    int freeList;
+    int slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]; // Heads of per-slot hold lists
+    long long currentTick;
+    bool started;
+};
+
+struct TimerWheel seatHoldWheel = {0};
+bool seatsReleased[MAX_ROUTES]; // Routes that had holds expire during the current advance
+
+void timerWheelLink(int index)
+{
+    struct SeatHold *hold = &seatHoldWheel.holds[index];
+    // Anything already due fires on the next tick
+    long long due = hold->expiresAt <= seatHoldWheel.currentTick ? seatHoldWheel.currentTick + 1 : hold->expiresAt;
+    long long delta = due - seatHoldWheel.currentTick;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1LL << (TIMER_WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+    int slot = (int)((due >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+
+    hold->level = level;
+    hold->slot = slot;
+    hold->prev = -1;
+    hold->next = seatHoldWheel.slots[level][slot];
+    if (hold->next >= 0)
+    {
+        seatHoldWheel.holds[hold->next].prev = index;
+    }
+    seatHoldWheel.slots[level][slot] = index;
+}
+
+void timerWheelUnlink(int index)
+{
+    struct SeatHold *hold = &seatHoldWheel.holds[index];
+    if (hold->prev >= 0)
+    {
+        seatHoldWheel.holds[hold->prev].next = hold->next;
+    }
+    else
+    {
+        seatHoldWheel.slots[hold->level][hold->slot] = hold->next;
+    }
+    if (hold->next >= 0)
+    {
+        seatHoldWheel.holds[hold->next].prev = hold->prev;
+    }
+}
+
+void startTimerWheel()
+{
+    if (seatHoldWheel.started)
+    {
+        return;
+    }
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+        {
+            seatHoldWheel.slots[level][slot] = -1;
+        }
+    }
+    seatHoldWheel.freeList = -1;
+    seatHoldWheel.currentTick = currentTime();
+    seatHoldWheel.started = true;
+}
+
+void releaseHoldSlot(int index)
+{
+    struct SeatHold *hold = &seatHoldWheel.holds[index];
+    hold->active = false;
+    hold->generation++;
+    hold->next = seatHoldWheel.freeList;
+    seatHoldWheel.freeList = index;
+}
+
+void expireSeatHold(int index)
+{
+    struct SeatHold *hold = &seatHoldWheel.holds[index];
+    if (hold->routeIndex < seatMap->routeCount && clearSeatHolder(hold->routeIndex, hold->seatNum, hold->holderWord))
+    {
+        markSeatFree(&seatMap->routes[hold->routeIndex], hold->seatNum);
+        seatsReleased[hold->routeIndex] = true;
+    }
+    releaseHoldSlot(index);
+}
+
+// Moves every hold in a coarse slot down to the level that now covers it.
+void cascadeTimerSlot(int level, int slot)
+{
+    int index = seatHoldWheel.slots[level][slot];
+    seatHoldWheel.slots[level][slot] = -1;
+    while (index >= 0)
+    {
+        int next = seatHoldWheel.holds[index].next;
+        timerWheelLink(index);
+        index = next;
+    }
+}
+
+// Lowers the shared earliest hold deadline to deadline if it is earlier.
+void lowerHoldDeadline(unsigned int deadline)
+{
+    unsigned int current = __atomic_load_n(&seatMap->nextHoldDeadline, __ATOMIC_ACQUIRE);
+    while (deadline < current &&
+           !__atomic_compare_exchange_n(&seatMap->nextHoldDeadline, &current, deadline, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+    }
+}
+
+// Frees every seat whose hold ran out, whichever process placed it: one
+// left idle at a prompt would otherwise keep its seats until it next ran.
+// Nothing is scanned until the earliest deadline recorded has passed. The
+// deadline is reset before the scan, so a hold placed during it lowers it
+// again or is seen by the scan.
+void expireSharedHolds(long long now)
+{
+    if (now < __atomic_load_n(&seatMap->nextHoldDeadline, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    __atomic_store_n(&seatMap->nextHoldDeadline, UINT_MAX, __ATOMIC_RELEASE);
+    unsigned int next = UINT_MAX;
+    int routeCount = __atomic_load_n(&seatMap->routeCount, __ATOMIC_ACQUIRE);
+    for (int r = 0; r < routeCount; r++)
+    {
+        for (int seat = 1; seat <= seatMap->routes[r].capacity; seat++)
+        {
+            unsigned long long holder = __atomic_load_n(seatHolder(r, seat), __ATOMIC_ACQUIRE);
+            if (holder == 0)
+            {
+                continue;
+            }
+            if (seatHolderDeadline(holder) > now)
+            {
+                next = seatHolderDeadline(holder) < next ? seatHolderDeadline(holder) : next;
+            }
+            else if (clearSeatHolder(r, seat, holder))
+            {
+                markSeatFree(&seatMap->routes[r], seat);
+                seatsReleased[r] = true;
+            }
+        }
+    }
+    lowerHoldDeadline(next);
+}
+
+// Advances the wheel to tick now, releasing every hold that expired.
+void advanceSeatHoldsTo(long long now)
+{
+    startTimerWheel();
+    while (seatHoldWheel.currentTick < now)
+    {
+        seatHoldWheel.currentTick++;
+        long long tick = seatHoldWheel.currentTick;
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            if ((tick & ((1LL << (TIMER_WHEEL_BITS * level)) - 1)) != 0)
+            {
+                break;
+            }
+            cascadeTimerSlot(level, (int)((tick >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)));
+        }
+
+        int slot = (int)(tick & (TIMER_WHEEL_SLOTS - 1));
+        int index = seatHoldWheel.slots[0][slot];
+        seatHoldWheel.slots[0][slot] = -1;
+        while (index >= 0)
+        {
+            int next = seatHoldWheel.holds[index].next;
+            if (seatHoldWheel.holds[index].expiresAt <= tick)
+            {
+                expireSeatHold(index);
+            }
+            else
+            {
+                timerWheelLink(index);
+            }
+            index = next;
+        }
+    }
+
+    expireSharedHolds(now);
+
+    // Seats released by expired holds go to the waitlist first
+    for (int r = 0; r < seatMap->routeCount; r++)
+    {
+        if (seatsReleased[r])
+        {
+            seatsReleased[r] = false;
+            promoteWaitlist(r);
+        }
+    }
+}
+
+void advanceSeatHolds()
+{
+    advanceSeatHoldsTo(currentTime());
+}
+
+struct SeatHold *seatHoldFor(int handle)
+{
+    int index = handle & ((1 << SEAT_HOLD_INDEX_BITS) - 1);
+    unsigned int generation = (unsigned int)handle >> SEAT_HOLD_INDEX_BITS;
+    if (handle < 0 || index >= seatHoldWheel.capacity)
+    {
+        return NULL;
+    }
+    struct SeatHold *hold = &seatHoldWheel.holds[index];
+    if (!hold->active || (hold->generation & ((1u << (31 - SEAT_HOLD_INDEX_BITS)) - 1)) != generation)
+    {
+        return NULL;
+    }
+    return hold;
+}
+
+// Holds a free seat for ttlSeconds. Returns a hold handle, or -1 if the seat
+// is not available.
+int holdSeatRoute(int currentCityID, int destinationCityID, int modeID, int seatNum, int ttlSeconds)
+{
+    advanceSeatHolds();
+    int routeIndex = findRouteIndex(currentCityID, destinationCityID, modeID);
+    // Claim the seat first: another process may be taking it right now
+    if (routeIndex < 0 || !markSeatBooked(&seatMap->routes[routeIndex], seatNum))
+    {
+        return -1;
+    }
+
+    if (seatHoldWheel.freeList < 0)
+    {
+        int capacity = seatHoldWheel.capacity ? seatHoldWheel.capacity * 2 : 64;
+        struct SeatHold *holds = capacity > (1 << SEAT_HOLD_INDEX_BITS) ? NULL : realloc(seatHoldWheel.holds, capacity * sizeof(struct SeatHold));
+        if (holds == NULL)
+        {
+            markSeatFree(&seatMap->routes[routeIndex], seatNum);
+            return -1;
+        }
+        seatHoldWheel.holds = holds;
+        for (int i = capacity - 1; i >= seatHoldWheel.capacity; i--)
+        {
+            holds[i].generation = 0;
+            holds[i].active = false;
+            holds[i].next = seatHoldWheel.freeList;
+            seatHoldWheel.freeList = i;
+        }
+        seatHoldWheel.capacity = capacity;
+    }
+
+    int index = seatHoldWheel.freeList;
+    struct SeatHold *hold = &seatHoldWheel.holds[index];
+    seatHoldWheel.freeList = hold->next;
+    hold->routeIndex = routeIndex;
+    hold->seatNum = seatNum;
+    hold->expiresAt = seatHoldWheel.currentTick + ttlSeconds;
+    hold->holderWord = seatHolderWord(getpid(), hold->expiresAt);
+    hold->active = true;
+    timerWheelLink(index);
+    __atomic_store_n(seatHolder(routeIndex, seatNum), hold->holderWord, __ATOMIC_RELEASE);
+    lowerHoldDeadline(hold->expiresAt); // After the store, so a concurrent expireSharedHolds() cannot miss it
+
+    unsigned int generation = hold->generation & ((1u << (31 - SEAT_HOLD_INDEX_BITS)) - 1);
+    return (int)((generation << SEAT_HOLD_INDEX_BITS) | index);
+}
+
+// Turns a hold into a booking. Returns false if the hold already expired,
+// here or in another process.
+bool confirmSeatHold(int handle)
+{
+    advanceSeatHolds();
+    struct SeatHold *hold = seatHoldFor(handle);
+    if (hold == NULL)
+    {
+        return false;
+    }
+    int index = hold - seatHoldWheel.holds;
+    bool confirmed = clearSeatHolder(hold->routeIndex, hold->seatNum, hold->holderWord);
+    timerWheelUnlink(index);
+    releaseHoldSlot(index);
+    return confirmed;
+}
+
+void releaseSeatHold(int handle)
+{
+    advanceSeatHolds();
+    struct SeatHold *hold = seatHoldFor(handle);
+    if (hold != NULL)
+    {
+        int index = hold - seatHoldWheel.holds;
+        timerWheelUnlink(index);
+        expireSeatHold(index);
+    }
+}
+
+// Lists the free berths of a train coach by coach, class by class. Full
+// coaches are skipped through the class summary bits.
+void displayAvailableBerths(const struct Routs *route)
+{
+    const struct TrainInventory *train = &seatMap->trains[route->train];
+    for (int k = 0; k < TRAIN_CLASSES; k++)
+    {
+        unsigned long long open = __atomic_load_n(&train->openCoaches[k][BERTH_ANY], __ATOMIC_ACQUIRE);
+        printf(" | %s: %d of %d coaches have free berths\n", coachClasses[k].name, __builtin_popcountll(open), coachClasses[k].coaches);
+        for (; open != 0; open &= open - 1)
+        {
+            int coach = classFirstCoach[k] + __builtin_ctzll(open);
+            const struct CoachLayout *layout = &trainCoaches[coach];
+            const struct CoachInventory *inventory = &train->coaches[coach];
+            printf(" |   %c%d (seats %d-%d): %d free -", coachClasses[k].coachPrefix, layout->number,
+                   layout->firstSeat, layout->firstSeat + layout->berths - 1, inventory->freeCount);
+            for (int type = 0; type < BERTH_TYPES; type++)
+            {
+                if (inventory->freeBerths[type] > 0)
+                {
+                    printf(" %s %d", berthCodes[type], inventory->freeBerths[type]);
+                }
+            }
+            printf("\n |     ");
+            for (int seat = layout->firstSeat; seat < layout->firstSeat + layout->berths; seat++)
+            {
+                if (seatIsFree(route, seat))
+                {
+                    printf("%d ", seat);
+                }
+            }
+            printf("\n");
+        }
+    }
+}
+
+void displayAvailableSeats(int currentCityID, int destinationCityID, int modeID)
+{
+    printf("\n +-------------------------------------------------------------------------------------------------------------------+\n");
+    printf(" |    Available %s for %s to %s:  | \n", modeID == MODE_TRAIN ? "Berths" : "Seats", cityName(currentCityID), cityName(destinationCityID));
+    printf(" +-------------------------------------------------------------------------------------------------------------------+\n");
+
+    for (int i = 0; i < seatMap->routeCount; i++)
+    {
+        if (seatMap->routes[i].currentCityID == currentCityID &&
+            seatMap->routes[i].destinationCityID == destinationCityID &&
+            seatMap->routes[i].modeID == modeID)
+        {
+            if (seatMap->routes[i].train >= 0)
+            {
+                displayAvailableBerths(&seatMap->routes[i]);
+                printf(" +-------------------------------------------------------------------------------------------------------------------+\n");
+                break;
+            }
+            printf(" | ");
+            bool foundSeat = false;
+            for (int j = 0; j < seatMap->routes[i].capacity; j++)
+            {
+                if (seatIsFree(&seatMap->routes[i], j + 1))
+                {
+                    printf("%d ", (j + 1)); // 1-indexed seat numbers
+                    foundSeat = true;
+                }
+            }
+            if (!foundSeat)
+            {
+                printf("No available seats.");
+            }
+            printf("\n +-------------------------------------------------------------------------------------------------------------------+\n");
+            break; // Break once you've found the relevant route
+        }
+    }
+}
+
+bool isValidName(const char *name)
+{
+    if (isspace(name[0]))
+    {
+        return false;
+    }
+    for (const char *p = name; *p; p++)
+    {
+        if (*p != ' ' && !isalpha(*p))
+        {
+            return false;
+        }
+    }
+    // Check if name contains at least one non-space character
+    for (const char *p = name; *p; p++)
+    {
+        if (*p != ' ')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Storage locks. Processes share bookings.dat, reedem_points.dat and
+// feedbacks.dat through fcntl byte-range locks on open file descriptions,
+// so a lock belongs to the descriptor that took it and closing an unrelated
+// descriptor of the same file cannot drop it.
+//   Appenders briefly lock APPEND_LOCK_OFFSET to reserve a region at the end
+//   of the file, then write it under a lock on just that region, so appends
+//   from many processes only serialize on the reservation.
+//   Updaters lock the one record they rewrite.
+//   Compaction locks the whole file exclusively while it writes path.tmp and
+//   renames it over path. Anyone who was waiting on the old file notices it
+//   was replaced and reopens it.
+#ifdef F_OFD_SETLKW
+#define RANGE_LOCK_COMMAND F_OFD_SETLKW
+#define RANGE_TRY_LOCK_COMMAND F_OFD_SETLK
+#define RANGE_LOCKS_PER_DESCRIPTION true
+#else
+#define RANGE_LOCK_COMMAND F_SETLKW // Per-process locks where OFD locks are unavailable
+#define RANGE_TRY_LOCK_COMMAND F_SETLK
+#define RANGE_LOCKS_PER_DESCRIPTION false // Two descriptors in one process never exclude each other
+#endif
+#define APPEND_LOCK_OFFSET (1LL << 62) // Past any real data
+
+bool lockRange(int fd, short type, off_t start, off_t length)
+{
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock)); // OFD locks require l_pid == 0
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = start;
+    lock.l_len = length; // 0 reaches past the end of the file
+    while (fcntl(fd, RANGE_LOCK_COMMAND, &lock) != 0)
+    {
+        if (errno != EINTR)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Like lockRange() but fails at once if another description holds the range.
+bool tryLockRange(int fd, short type, off_t start, off_t length)
+{
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = start;
+    lock.l_len = length;
+    return fcntl(fd, RANGE_TRY_LOCK_COMMAND, &lock) == 0;
+}
+
+void unlockRange(int fd, off_t start, off_t length)
+{
+    lockRange(fd, F_UNLCK, start, length);
+}
+
+// Locks a range of path through *fd. If a compaction replaced the file while
+// we waited, *fd is reopened on the new file with flags and the lock retried.
+bool lockCurrentFile(int *fd, const char *path, int flags, short type, off_t start, off_t length)
+{
+    while (1)
+    {
+        if (*fd < 0 || !lockRange(*fd, type, start, length))
+        {
+            return false;
+        }
+        struct stat opened, current;
+        if (fstat(*fd, &opened) == 0 && stat(path, &current) == 0 &&
+            opened.st_dev == current.st_dev && opened.st_ino == current.st_ino)
+        {
+            return true;
+        }
+        close(*fd);
+        *fd = open(path, flags, 0644);
+    }
+}
+
+// Opens path and locks a range of it. Returns the descriptor, which releases
+// the lock when closed, or -1.
+int openLocked(const char *path, int flags, short type, off_t start, off_t length)
+{
+    int fd = open(path, flags, 0644);
+    if (!lockCurrentFile(&fd, path, flags, type, start, length))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+bool pwriteAll(int fd, const void *data, size_t size, off_t offset)
+{
+    size_t written = 0;
+    while (written < size)
+    {
+        ssize_t n = pwrite(fd, (const char *)data + written, size - written, offset + written);
+        if (n <= 0)
+        {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+// Reserves size bytes at the end of path through *fd (opened O_RDWR) and
+// leaves just that region locked. Returns the region's offset, or -1.
+off_t reserveAppend(int *fd, const char *path, size_t size)
+{
+    if (!lockCurrentFile(fd, path, O_RDWR | O_CREAT, F_WRLCK, APPEND_LOCK_OFFSET, 1))
+    {
+        return -1;
+    }
+    struct stat st;
+    off_t end = fstat(*fd, &st) == 0 ? st.st_size : -1;
+    bool reserved = end >= 0 && ftruncate(*fd, end + size) == 0 && lockRange(*fd, F_WRLCK, end, size);
+    unlockRange(*fd, APPEND_LOCK_OFFSET, 1);
+    return reserved ? end : -1;
+}
+
+// Appends size bytes to path through *fd (opened O_RDWR). Readers may see
+// the reserved region as zeros until the write lands; readRecord() skips
+// such records without reporting them as damaged.
+bool appendLocked(int *fd, const char *path, const void *data, size_t size)
+{
+    off_t end = reserveAppend(fd, path, size);
+    if (end < 0)
+    {
+        return false;
+    }
+    bool written = pwriteAll(*fd, data, size, end);
+    unlockRange(*fd, end, size);
+    return written;
+}
+
+// Overwrites one record of path in place under a lock on just that record.
+bool writeRecordLocked(int *fd, const char *path, long offset, const void *data, size_t size)
+{
+    if (!lockCurrentFile(fd, path, O_RDWR, F_WRLCK, offset, size))
+    {
+        return false;
+    }
+    bool written = pwriteAll(*fd, data, size, offset);
+    unlockRange(*fd, offset, size);
+    return written;
+}
+
+// Storage I/O backends. The sync backend opens, writes and closes the file on
+// every call. The batched backend keeps descriptors open and queues appends
+// and record updates per file, so a whole booking (record, feedback, points)
+// goes out in one write() per file when the transaction is flushed. The ring
+// backend queues the same way but hands the writes of all files to io_uring
+// and waits for them with a single io_uring_enter() call. It uses the raw
+// system calls, so it needs no liburing, and runs as the batched backend
+// where the kernel has no io_uring.
+struct IOBackend
+{
+    const char *name;
+    bool (*append)(const char *path, const void *data, size_t size);
+    bool (*writeAt)(const char *path, long offset, const void *data, size_t size);
+    // Locks the record of size bytes at offset, reads it, lets apply() change
+    // it and writes it back. apply() returns false, having changed nothing,
+    // to leave the record alone. A queued write keeps the record locked until
+    // it is flushed, so no other counter reads the old value meanwhile.
+    bool (*update)(const char *path, long offset, size_t size, bool (*apply)(void *record, void *context), void *context);
+    void (*prepareRead)(const char *path); // Make queued writes visible to readers
+    void (*flush)(void);
+    void (*fileReplaced)(const char *path); // path was renamed over; drop anything open on the old file
+};
+
+// Locks the record at offset through *fd, reads it into record and lets
+// apply() change it. The record stays locked when this returns true.
+bool lockAndApply(int *fd, const char *path, long offset, void *record, size_t size,
+                  bool (*apply)(void *record, void *context), void *context)
+{
+    if (!lockCurrentFile(fd, path, O_RDWR, F_WRLCK, offset, size))
+    {
+        return false;
+    }
+    if (pread(*fd, record, size, offset) == (ssize_t)size && apply(record, context))
+    {
+        return true;
+    }
+    unlockRange(*fd, offset, size);
+    return false;
+}
+
+bool syncAppend(const char *path, const void *data, size_t size)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    bool success = appendLocked(&fd, path, data, size);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return success;
+}
+
+bool syncWriteAt(const char *path, long offset, const void *data, size_t size)
+{
+    int fd = open(path, O_RDWR);
+    bool success = writeRecordLocked(&fd, path, offset, data, size);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return success;
+}
+
+bool syncUpdate(const char *path, long offset, size_t size, bool (*apply)(void *record, void *context), void *context)
+{
+    int fd = open(path, O_RDWR);
+    unsigned char *record = malloc(size);
+    bool success = record != NULL && lockAndApply(&fd, path, offset, record, size, apply, context);
+    if (success)
+    {
+        success = pwriteAll(fd, record, size, offset);
+        unlockRange(fd, offset, size);
+    }
+    free(record);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return success;
+}
+
+void syncPrepareRead(const char *path)
+{
+    (void)path;
+}
+
+void syncFlush(void)
+{
+}
+
+void syncFileReplaced(const char *path)
+{
+    (void)path;
+}
+
+// A record rewrite waiting for the next flush. The record stays locked
+// through the file's descriptor until then.
+struct PendingUpdate
+{
+    long offset;
+    size_t size;
+    unsigned char *data;
+};
+
+struct BatchedFile
+{
+    char path[64];
+    int fd;
+    char *pending;
+    size_t used;
+    size_t capacity;
+    struct PendingUpdate *updates;
+    int updateCount;
+    int updateCapacity;
+    size_t updateBytes;
+};
+
+struct BatchedFile batchedFiles[MAX_IO_FILES];
+int batchedFileCount = 0;
+
+struct BatchedFile *batchedFileFor(const char *path)
+{
+    for (int i = 0; i < batchedFileCount; i++)
+    {
+        if (strcmp(batchedFiles[i].path, path) == 0)
+        {
+            return &batchedFiles[i];
+        }
+    }
+    if (batchedFileCount == MAX_IO_FILES)
+    {
+        return NULL;
+    }
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct BatchedFile *bf = &batchedFiles[batchedFileCount++];
+    memset(bf, 0, sizeof(*bf));
+    strncpy(bf->path, path, sizeof(bf->path) - 1);
+    bf->fd = fd;
+    return bf;
+}
+
+// Unlocks and forgets the queued updates of bf once they were written, or
+// could not be.
+void batchedReleaseUpdates(struct BatchedFile *bf)
+{
+    for (int i = 0; i < bf->updateCount; i++)
+    {
+        unlockRange(bf->fd, bf->updates[i].offset, bf->updates[i].size);
+        free(bf->updates[i].data);
+    }
+    bf->updateCount = 0;
+    bf->updateBytes = 0;
+}
+
+bool batchedFlushFile(struct BatchedFile *bf)
+{
+    bool success = true;
+    if (bf->used > 0)
+    {
+        success = appendLocked(&bf->fd, bf->path, bf->pending, bf->used);
+        if (success)
+        {
+            bf->used = 0;
+        }
+    }
+    for (int i = 0; i < bf->updateCount; i++)
+    {
+        success = pwriteAll(bf->fd, bf->updates[i].data, bf->updates[i].size, bf->updates[i].offset) && success;
+    }
+    batchedReleaseUpdates(bf);
+    return success;
+}
+
+bool batchedAppend(const char *path, const void *data, size_t size)
+{
+    struct BatchedFile *bf = batchedFileFor(path);
+    if (bf == NULL)
+    {
+        return syncAppend(path, data, size);
+    }
+    if (bf->used + size > bf->capacity)
+    {
+        if (bf->used + size > IO_BATCH_BYTES && !batchedFlushFile(bf))
+        {
+            return false;
+        }
+        size_t capacity = bf->capacity ? bf->capacity : 4096;
+        while (capacity < bf->used + size)
+        {
+            capacity *= 2;
+        }
+        char *grown = realloc(bf->pending, capacity);
+        if (grown == NULL)
+        {
+            return false;
+        }
+        bf->pending = grown;
+        bf->capacity = capacity;
+    }
+    memcpy(bf->pending + bf->used, data, size);
+    bf->used += size;
+    return true;
+}
+
+bool batchedWriteAt(const char *path, long offset, const void *data, size_t size)
+{
+    struct BatchedFile *bf = batchedFileFor(path);
+    if (bf == NULL)
+    {
+        return syncWriteAt(path, offset, data, size);
+    }
+    // In-place updates may target a record that is still queued
+    if (!batchedFlushFile(bf))
+    {
+        return false;
+    }
+    return writeRecordLocked(&bf->fd, bf->path, offset, data, size);
+}
+
+// Records of one file all have the same size, so a queued update is either
+// the same record or does not overlap it. While updates are queued their
+// locks keep compaction from replacing the file, so bf->fd stays current.
+bool batchedUpdate(const char *path, long offset, size_t size, bool (*apply)(void *record, void *context), void *context)
+{
+    struct BatchedFile *bf = batchedFileFor(path);
+    if (bf == NULL)
+    {
+        return syncUpdate(path, offset, size, apply, context);
+    }
+    for (int i = 0; i < bf->updateCount; i++)
+    {
+        if (bf->updates[i].offset == offset)
+        {
+            return apply(bf->updates[i].data, context); // Still locked, and newer than the file
+        }
+    }
+    if (bf->updateBytes + size > IO_BATCH_BYTES && !batchedFlushFile(bf))
+    {
+        return false;
+    }
+    if (bf->updateCount == bf->updateCapacity)
+    {
+        int capacity = bf->updateCapacity ? bf->updateCapacity * 2 : 8;
+        struct PendingUpdate *grown = realloc(bf->updates, capacity * sizeof(struct PendingUpdate));
+        if (grown == NULL)
+        {
+            return false;
+        }
+        bf->updates = grown;
+        bf->updateCapacity = capacity;
+    }
+    unsigned char *record = malloc(size);
+    if (record == NULL || !lockAndApply(&bf->fd, bf->path, offset, record, size, apply, context))
+    {
+        free(record);
+        return false;
+    }
+    bf->updates[bf->updateCount++] = (struct PendingUpdate){offset, size, record};
+    bf->updateBytes += size;
+    return true;
+}
+
+void batchedPrepareRead(const char *path)
+{
+    for (int i = 0; i < batchedFileCount; i++)
+    {
+        if (strcmp(batchedFiles[i].path, path) == 0)
+        {
+            batchedFlushFile(&batchedFiles[i]);
+            return;
+        }
+    }
+}
+
+void batchedFlush(void)
+{
+    for (int i = 0; i < batchedFileCount; i++)
+    {
+        if (!batchedFlushFile(&batchedFiles[i]))
+        {
+            printf("Error: Failed to write pending data to %s.\n", batchedFiles[i].path);
+        }
+    }
+}
+
+// Rewrites replace a file with remove and rename, which leaves a cached
+// descriptor on the unlinked inode. Reopen it so later appends reach the
+// new file. Callers flush before they read the file they rewrite, so
+// nothing is queued for the old one.
+void batchedFileReplaced(const char *path)
+{
+    for (int i = 0; i < batchedFileCount; i++)
+    {
+        if (strcmp(batchedFiles[i].path, path) == 0)
+        {
+            close(batchedFiles[i].fd);
+            batchedFiles[i].fd = open(path, O_RDWR | O_CREAT, 0644);
+            return;
+        }
+    }
+}
+
+// The ring backend shares the batched backend's queues and only replaces
+// the flush of the whole transaction. Flushes of a single file, before it
+// is read or rewritten in place, still go out with pwrite().
+struct RingWrite
+{
+    int fd;
+    const void *data;
+    size_t size;
+    off_t offset;
+    bool written;
+};
+
+#if IO_RING_SUPPORTED
+struct IORing
+{
+    int fd; // -1 until setupIORing() succeeds
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+};
+
+struct IORing ioRing = {.fd = -1};
+
+bool setupIORing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, IO_RING_ENTRIES, &params);
+    if (fd < 0)
+    {
+        return false;
+    }
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap)
+    {
+        sqSize = cqSize = sqSize > cqSize ? sqSize : cqSize;
+    }
+    unsigned char *sq = mmap(NULL, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    unsigned char *cq = singleMap || sq == MAP_FAILED ? sq : mmap(NULL, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    struct io_uring_sqe *sqes = cq == MAP_FAILED ? MAP_FAILED : mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        close(fd); // Also drops the mappings that did succeed from the ring's point of view
+        return false;
+    }
+    ioRing.fd = fd;
+    ioRing.sqHead = (unsigned *)(sq + params.sq_off.head);
+    ioRing.sqTail = (unsigned *)(sq + params.sq_off.tail);
+    ioRing.sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ioRing.sqArray = (unsigned *)(sq + params.sq_off.array);
+    ioRing.cqHead = (unsigned *)(cq + params.cq_off.head);
+    ioRing.cqTail = (unsigned *)(cq + params.cq_off.tail);
+    ioRing.cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ioRing.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ioRing.sqes = sqes;
+    return true;
+}
+
+// Submits up to IO_RING_ENTRIES writes and waits for them with one
+// io_uring_enter(). Sets written on each write that completed in full; the
+// caller finishes the rest.
+void ringSubmitWrites(struct RingWrite *writes, int count)
+{
+    unsigned head = __atomic_load_n(ioRing.sqHead, __ATOMIC_ACQUIRE);
+    unsigned tail = *ioRing.sqTail; // Only this thread moves the tail
+    for (int i = 0; i < count; i++)
+    {
+        unsigned index = (tail + i) & *ioRing.sqMask;
+        struct io_uring_sqe *sqe = &ioRing.sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = writes[i].fd;
+        sqe->addr = (unsigned long)writes[i].data;
+        sqe->len = writes[i].size;
+        sqe->off = writes[i].offset;
+        sqe->user_data = i;
+        ioRing.sqArray[index] = index;
+    }
+    __atomic_store_n(ioRing.sqTail, tail + count, __ATOMIC_RELEASE);
+    syscall(__NR_io_uring_enter, ioRing.fd, count, count, IORING_ENTER_GETEVENTS, NULL, 0);
+
+    // Take back whatever the kernel did not consume, then collect the rest
+    int taken = __atomic_load_n(ioRing.sqHead, __ATOMIC_ACQUIRE) - head;
+    __atomic_store_n(ioRing.sqTail, tail + taken, __ATOMIC_RELEASE);
+    for (int reaped = 0; reaped < taken;)
+    {
+        unsigned cqHead = *ioRing.cqHead;
+        if (cqHead == __atomic_load_n(ioRing.cqTail, __ATOMIC_ACQUIRE))
+        {
+            syscall(__NR_io_uring_enter, ioRing.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            continue;
+        }
+        const struct io_uring_cqe *cqe = &ioRing.cqes[cqHead & *ioRing.cqMask];
+        if (cqe->user_data < (unsigned long long)count)
+        {
+            writes[cqe->user_data].written = cqe->res == (int)writes[cqe->user_data].size;
+        }
+        __atomic_store_n(ioRing.cqHead, cqHead + 1, __ATOMIC_RELEASE);
+        reaped++;
+    }
+}
+#else
+bool setupIORing()
+{
+    return false;
+}
+
+void ringSubmitWrites(struct RingWrite *writes, int count)
+{
+    (void)writes;
+    (void)count;
+}
+#endif
+
+// Writes all of writes through the ring. Any the kernel refused or cut short
+// (an older kernel without IORING_OP_WRITE, a full disk) are written again
+// with pwrite(), which reports the error if there is one.
+void ringWriteAll(struct RingWrite *writes, int count)
+{
+    for (int first = 0; first < count;)
+    {
+        int batch = count - first < IO_RING_ENTRIES ? count - first : IO_RING_ENTRIES;
+        ringSubmitWrites(writes + first, batch);
+        for (int i = first; i < first + batch; i++)
+        {
+            if (!writes[i].written)
+            {
+                writes[i].written = pwriteAll(writes[i].fd, writes[i].data, writes[i].size, writes[i].offset);
+            }
+        }
+        first += batch;
+    }
+}
+
+void ringFlush(void)
+{
+    int count = 0;
+    for (int i = 0; i < batchedFileCount; i++)
+    {
+        count += (batchedFiles[i].used > 0) + batchedFiles[i].updateCount;
+    }
+    struct RingWrite *writes = count > 0 ? malloc(count * sizeof(struct RingWrite)) : NULL;
+    if (writes == NULL)
+    {
+        batchedFlush();
+        return;
+    }
+
+    // Reserve the end of each file, then send every append and update at once
+    off_t ends[MAX_IO_FILES];
+    int first[MAX_IO_FILES];
+    count = 0;
+    for (int i = 0; i < batchedFileCount; i++)
+    {
+        struct BatchedFile *bf = &batchedFiles[i];
+        first[i] = count;
+        ends[i] = bf->used > 0 ? reserveAppend(&bf->fd, bf->path, bf->used) : -1;
+        if (ends[i] >= 0)
+        {
+            writes[count++] = (struct RingWrite){bf->fd, bf->pending, bf->used, ends[i], false};
+        }
+        for (int j = 0; j < bf->updateCount; j++)
+        {
+            const struct PendingUpdate *update = &bf->updates[j];
+            writes[count++] = (struct RingWrite){bf->fd, update->data, update->size, update->offset, false};
+        }
+    }
+    ringWriteAll(writes, count);
+
+    for (int i = 0; i < batchedFileCount; i++)
+    {
+        struct BatchedFile *bf = &batchedFiles[i];
+        int last = i + 1 < batchedFileCount ? first[i + 1] : count;
+        bool written = bf->used == 0 || ends[i] >= 0;
+        for (int j = first[i]; j < last; j++)
+        {
+            written = written && writes[j].written;
+        }
+        if (ends[i] >= 0)
+        {
+            unlockRange(bf->fd, ends[i], bf->used);
+            bf->used = 0;
+        }
+        batchedReleaseUpdates(bf);
+        if (!written)
+        {
+            printf("Error: Failed to write pending data to %s.\n", bf->path);
+        }
+    }
+    free(writes);
+}
+
+const struct IOBackend syncBackend = {"sync", syncAppend, syncWriteAt, syncUpdate, syncPrepareRead, syncFlush, syncFileReplaced};
+const struct IOBackend batchedBackend = {"batched", batchedAppend, batchedWriteAt, batchedUpdate, batchedPrepareRead, batchedFlush, batchedFileReplaced};
+const struct IOBackend ringBackend = {"ring", batchedAppend, batchedWriteAt, batchedUpdate, batchedPrepareRead, ringFlush, batchedFileReplaced};
+const struct IOBackend *ioBackend = &syncBackend;
+
+void flushIOBackend(void)
+{
+    ioBackend->flush();
+}
+
+// Switches to backend, setting up the ring first if it needs one. Returns
+// false, keeping the current backend, when io_uring is unavailable.
+bool useIOBackend(const struct IOBackend *backend)
+{
+    if (backend == &ringBackend && !setupIORing())
+    {
+        return false;
+    }
+    ioBackend = backend;
+    return true;
+}
+
+void selectIOBackend()
+{
+    const char *choice = getenv(IO_BACKEND_ENV);
+    if (choice != NULL && strcmp(choice, batchedBackend.name) == 0)
+    {
+        useIOBackend(&batchedBackend);
+    }
+    else if (choice != NULL && strcmp(choice, ringBackend.name) == 0 && !useIOBackend(&ringBackend))
+    {
+        fprintf(stderr, "Note: io_uring is unavailable here; using the batched I/O backend.\n");
+        useIOBackend(&batchedBackend);
+    }
+    atexit(flushIOBackend);
+}
+
+// Scrambles the bits of x (splitmix64 finaliser) for hash tables and sketches.
+unsigned long long mixHash(unsigned long long x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Fuzzy name search. Distinct passenger names are kept in a dictionary, each
+// with the ticket IDs booked under it, and an inverted index maps every
+// trigram of a name to the sorted list of names containing it. A query only
+// looks at names sharing enough trigrams with it to be within
+// FUZZY_MAX_EDITS edits, then ranks those by edit distance. The index is
+// built on first use and kept current as bookings are added and removed.
+struct IntList
+{
+    int *items;
+    int count;
+    int capacity;
+};
+
+struct NameEntry
+{
+    char *name; // As first booked
+    int length;
+    struct IntList tickets;
+};
+
+struct TrigramPostings
+{
+    unsigned int trigram; // 0 while the slot is unused
+    struct IntList names; // Name IDs, ascending
+};
+
+struct NameEntry *nameEntries = NULL;
+int nameCount = 0;
+int nameCapacity = 0;
+int *nameSlots = NULL; // Open addressing, name ID + 1
+int nameSlotCount = 0;
+struct TrigramPostings *trigramSlots = NULL;
+int trigramSlotCount = 0;
+int trigramCount = 0;
+bool nameIndexBuilt = false;
+
+int compareInts(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+bool intListAppend(struct IntList *list, int value)
+{
+    if (list->count == list->capacity)
+    {
+        int capacity = list->capacity ? list->capacity * 2 : 4;
+        int *items = realloc(list->items, capacity * sizeof(int));
+        if (items == NULL)
+        {
+            return false;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = value;
+    return true;
+}
+
+unsigned int hashNameKey(const char *name)
+{
+    unsigned int hash = 2166136261u;
+    for (const char *c = name; *c != '\0'; c++)
+    {
+        hash = (hash ^ (unsigned char)tolower((unsigned char)*c)) * 16777619u;
+    }
+    return hash;
+}
+
+// Unique trigrams of a name, lowercased and padded so that the start and
+// end of the name form trigrams of their own. Returns how many were found.
+int nameTrigrams(const char *name, unsigned int *trigrams)
+{
+    unsigned char padded[MAX_NAME_LENGTH + 4];
+    int length = 0;
+    padded[length++] = ' ';
+    padded[length++] = ' ';
+    for (const char *c = name; *c != '\0' && length < MAX_NAME_LENGTH + 2; c++)
+    {
+        padded[length++] = tolower((unsigned char)*c);
+    }
+    padded[length++] = ' ';
+
+    int count = 0;
+    for (int i = 0; i + 2 < length; i++)
+    {
+        unsigned int trigram = (padded[i] << 16) | (padded[i + 1] << 8) | padded[i + 2];
+        bool seen = false;
+        for (int j = 0; j < count && !seen; j++)
+        {
+            seen = trigrams[j] == trigram;
+        }
+        if (!seen)
+        {
+            trigrams[count++] = trigram;
+        }
+    }
+    return count;
+}
+
+struct TrigramPostings *findTrigram(unsigned int trigram, bool create)
+{
+    if (create && (trigramCount + 1) * 2 > trigramSlotCount)
+    {
+        // Grow to keep the table at most half full
+        int oldCount = trigramSlotCount;
+        struct TrigramPostings *old = trigramSlots;
+        trigramSlotCount = oldCount ? oldCount * 2 : 4096;
+        trigramSlots = calloc(trigramSlotCount, sizeof(struct TrigramPostings));
+        for (int i = 0; i < oldCount; i++)
+        {
+            if (old[i].trigram != 0)
+            {
+                unsigned int slot = mixHash(old[i].trigram) & (trigramSlotCount - 1);
+                while (trigramSlots[slot].trigram != 0)
+                {
+                    slot = (slot + 1) & (trigramSlotCount - 1);
+                }
+                trigramSlots[slot] = old[i];
+            }
+        }
+        free(old);
+    }
+    if (trigramSlotCount == 0)
+    {
+        return NULL;
+    }
+    unsigned int slot = mixHash(trigram) & (trigramSlotCount - 1);
+    while (trigramSlots[slot].trigram != 0)
+    {
+        if (trigramSlots[slot].trigram == trigram)
+        {
+            return &trigramSlots[slot];
+        }
+        slot = (slot + 1) & (trigramSlotCount - 1);
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+    trigramSlots[slot].trigram = trigram;
+    trigramCount++;
+    return &trigramSlots[slot];
+}
+
+// Returns the slot holding name, or the empty slot where it belongs.
+int findNameSlot(const char *name)
+{
+    unsigned int slot = hashNameKey(name) & (nameSlotCount - 1);
+    while (nameSlots[slot] != 0 && strcasecmp(nameEntries[nameSlots[slot] - 1].name, name) != 0)
+    {
+        slot = (slot + 1) & (nameSlotCount - 1);
+    }
+    return slot;
+}
+
+int internPassengerName(const char *name)
+{
+    if ((nameCount + 1) * 2 > nameSlotCount)
+    {
+        free(nameSlots);
+        nameSlotCount = nameSlotCount ? nameSlotCount * 2 : 4096;
+        nameSlots = calloc(nameSlotCount, sizeof(int));
+        for (int id = 0; id < nameCount; id++)
+        {
+            nameSlots[findNameSlot(nameEntries[id].name)] = id + 1;
+        }
+    }
+    int slot = findNameSlot(name);
+    if (nameSlots[slot] != 0)
+    {
+        return nameSlots[slot] - 1;
+    }
+
+    if (nameCount == nameCapacity)
+    {
+        nameCapacity = nameCapacity ? nameCapacity * 2 : 1024;
+        nameEntries = realloc(nameEntries, nameCapacity * sizeof(struct NameEntry));
+    }
+    int id = nameCount++;
+    memset(&nameEntries[id], 0, sizeof(struct NameEntry));
+    nameEntries[id].name = strdup(name);
+    nameEntries[id].length = strlen(name);
+    nameSlots[slot] = id + 1;
+
+    // New IDs are the largest so far, so appending keeps postings sorted
+    unsigned int trigrams[MAX_NAME_LENGTH + 2];
+    int count = nameTrigrams(name, trigrams);
+    for (int i = 0; i < count; i++)
+    {
+        intListAppend(&findTrigram(trigrams[i], true)->names, id);
+    }
+    return id;
+}
+
+void nameIndexAdd(const char *name, int ticketID)
+{
+    if (nameIndexBuilt && name[0] != '\0')
+    {
+        int id = internPassengerName(name); // May move nameEntries
+        intListAppend(&nameEntries[id].tickets, ticketID);
+    }
+}
+
+void nameIndexRemove(const char *name, int ticketID)
+{
+    if (!nameIndexBuilt || nameSlotCount == 0)
+    {
+        return;
+    }
+    int slot = findNameSlot(name);
+    if (nameSlots[slot] == 0)
+    {
+        return;
+    }
+    // Names whose last booking goes keep their postings but are skipped by queries
+    struct IntList *tickets = &nameEntries[nameSlots[slot] - 1].tickets;
+    for (int i = 0; i < tickets->count; i++)
+    {
+        if (tickets->items[i] == ticketID)
+        {
+            tickets->items[i] = tickets->items[--tickets->count];
+            break;
+        }
+    }
+}
+
+void buildNameIndex()
+{
+    nameIndexBuilt = true;
+    prepareBookingsScan();
+    FILE *file = openDataFile(FILENAME);
+    if (file == NULL)
+    {
+        return;
+    }
+    struct Booking booking;
+    while (readBooking(file, &booking))
+    {
+        nameIndexAdd(booking.name, booking.ticketID);
+    }
+    fclose(file);
+}
+
+int editDistance(const char *a, const char *b)
+{
+    int lengthB = strlen(b);
+    int previous[MAX_NAME_LENGTH + 1], current[MAX_NAME_LENGTH + 1];
+    for (int j = 0; j <= lengthB; j++)
+    {
+        previous[j] = j;
+    }
+    for (int i = 1; a[i - 1] != '\0'; i++)
+    {
+        current[0] = i;
+        for (int j = 1; j <= lengthB; j++)
+        {
+            int cost = tolower((unsigned char)a[i - 1]) != tolower((unsigned char)b[j - 1]);
+            int best = previous[j - 1] + cost;
+            if (previous[j] + 1 < best)
+            {
+                best = previous[j] + 1;
+            }
+            if (current[j - 1] + 1 < best)
+            {
+                best = current[j - 1] + 1;
+            }
+            current[j] = best;
+        }
+        memcpy(previous, current, (lengthB + 1) * sizeof(int));
+    }
+    return previous[lengthB];
+}
+
+struct NameMatch
+{
+    int nameID;
+    int distance;
+    int sharedTrigrams;
+};
+
+bool nameMatchBefore(const struct NameMatch *a, const struct NameMatch *b)
+{
+    if (a->distance != b->distance)
+    {
+        return a->distance < b->distance;
+    }
+    return a->sharedTrigrams > b->sharedTrigrams;
+}
+
+int comparePostingLengths(const void *a, const void *b)
+{
+    const struct IntList *x = *(struct IntList *const *)a, *y = *(struct IntList *const *)b;
+    return (x ? x->count : 0) - (y ? y->count : 0);
+}
+
+// Moves *at forward to the first item >= value, galloping so that a run of
+// increasing probes costs about log of the distance skipped.
+bool postingAdvanceTo(const struct IntList *list, int *at, int value)
+{
+    if (list == NULL)
+    {
+        return false;
+    }
+    int step = 1, low = *at, high = *at;
+    while (high < list->count && list->items[high] < value)
+    {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    if (high > list->count)
+    {
+        high = list->count;
+    }
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (list->items[mid] < value)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    *at = low;
+    return low < list->count && list->items[low] == value;
+}
+
+// Fills matches with up to maxMatches names closest to query, best first.
+// Returns the number found; *candidates is set to how many names had their
+// edit distance computed.
+int fuzzyFindNames(const char *query, struct NameMatch *matches, int maxMatches, int *candidates)
+{
+    *candidates = 0;
+    if (!nameIndexBuilt)
+    {
+        buildNameIndex();
+    }
+    unsigned int trigrams[MAX_NAME_LENGTH + 2];
+    int trigramTotal = nameTrigrams(query, trigrams);
+    if (trigramTotal == 0)
+    {
+        return 0;
+    }
+
+    // A name within k edits shares at least |Q| - 3k of the query's trigrams,
+    // so it must appear in one of the |Q| - T + 1 shortest posting lists.
+    // Those generate the candidates; the longer lists are only probed.
+    const struct IntList *lists[MAX_NAME_LENGTH + 2];
+    for (int i = 0; i < trigramTotal; i++)
+    {
+        struct TrigramPostings *postings = findTrigram(trigrams[i], false);
+        lists[i] = postings != NULL ? &postings->names : NULL;
+    }
+    qsort(lists, trigramTotal, sizeof(lists[0]), comparePostingLengths);
+    int threshold = trigramTotal - 3 * FUZZY_MAX_EDITS;
+    if (threshold < 1)
+    {
+        threshold = 1;
+    }
+    int generators = trigramTotal - threshold + 1;
+    int queryLength = strlen(query);
+
+    // Walk the generator lists in step, taking the smallest head each time,
+    // so candidates come out in ascending order and the probes into the
+    // long lists only ever move forward. At most 3 * FUZZY_MAX_EDITS + 1
+    // lists generate, so a linear scan for the smallest head is enough.
+    int cursors[MAX_NAME_LENGTH + 2] = {0};
+    int found = 0;
+    while (1)
+    {
+        int nameID = -1;
+        for (int l = 0; l < generators; l++)
+        {
+            if (lists[l] != NULL && cursors[l] < lists[l]->count && (nameID < 0 || lists[l]->items[cursors[l]] < nameID))
+            {
+                nameID = lists[l]->items[cursors[l]];
+            }
+        }
+        if (nameID < 0)
+        {
+            break;
+        }
+        int shared = 0;
+        for (int l = 0; l < generators; l++)
+        {
+            if (lists[l] != NULL && cursors[l] < lists[l]->count && lists[l]->items[cursors[l]] == nameID)
+            {
+                shared++;
+                cursors[l]++;
+            }
+        }
+        if (nameEntries[nameID].tickets.count == 0 || abs(nameEntries[nameID].length - queryLength) > FUZZY_MAX_EDITS)
+        {
+            continue; // Cancelled, or too long or short to be a near miss
+        }
+        for (int l = generators; l < trigramTotal && shared + (trigramTotal - l) >= threshold; l++)
+        {
+            shared += postingAdvanceTo(lists[l], &cursors[l], nameID);
+        }
+        if (shared < threshold)
+        {
+            continue;
+        }
+
+        (*candidates)++;
+        struct NameMatch match = {nameID, editDistance(query, nameEntries[nameID].name), shared};
+        // Insert into the sorted top list
+        int at = found < maxMatches ? found++ : maxMatches;
+        while (at > 0 && nameMatchBefore(&match, &matches[at - 1]))
+        {
+            if (at < maxMatches)
+            {
+                matches[at] = matches[at - 1];
+            }
+            at--;
+        }
+        if (at < maxMatches)
+        {
+            matches[at] = match;
+        }
+    }
+    return found;
+}
+
+// Travel-date index. Every booking records when it was made and the day it
+// travels on. The index keeps (travel day, record number) pairs sorted, so a
+// date window is one contiguous run of entries and a report reads back only
+// the bookings inside it. Days count from 1970-01-01 (UTC). The index is
+// built by the first time-range report and then follows bookings.dat, see
+// refreshTravelIndex().
+#define SECONDS_PER_DAY 86400
+
+struct TravelIndexEntry
+{
+    int day;
+    int record; // Position in bookings.dat
+};
+
+struct TravelIndexEntry *travelIndex = NULL;
+int travelIndexCount = 0;
+int travelIndexCapacity = 0;
+int bookingRecordCount = 0; // Records of bookings.dat indexed so far, including damaged ones
+bool travelIndexBuilt = false; // Built on first use and after every rewrite
+struct FileVersion travelIndexSource; // bookings.dat as last indexed
+
+long long daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    long long era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void civilFromDays(long long days, int *year, int *month, int *day)
+{
+    days += 719468;
+    long long era = (days >= 0 ? days : days - 146096) / 146097;
+    int dayOfEra = days - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int mp = (5 * dayOfYear + 2) / 153;
+    *day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+// Parses YYYY-MM-DD into a day number. Returns false for malformed or
+// impossible dates.
+bool parseDate(const char *text, int *dayNumber)
+{
+    int year, month, day;
+    char extra;
+    if (sscanf(text, "%d-%d-%d%c", &year, &month, &day, &extra) != 3 || year < 1970 || year > 9999 ||
+        month < 1 || month > 12 || day < 1 || day > 31)
+    {
+        return false;
+    }
+    long long days = daysFromCivil(year, month, day);
+    int y, m, d;
+    civilFromDays(days, &y, &m, &d);
+    if (y != year || m != month || d != day)
+    {
+        return false; // e.g. 2024-02-30
+    }
+    *dayNumber = days;
+    return true;
+}
+
+void formatDay(int dayNumber, char *buffer, size_t size)
+{
+    int year, month, day;
+    civilFromDays(dayNumber, &year, &month, &day);
+    snprintf(buffer, size, "%04d-%02d-%02d", year, month, day);
+}
+
+// First index entry whose day is at or after day.
+int travelIndexLowerBound(int day)
+{
+    int low = 0, high = travelIndexCount;
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (travelIndex[mid].day < day)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool reportTotalsStale = true; // Report sketches must be rebuilt before use
+
+// Called after a booking has been appended to bookings.dat. The travel
+// index picks it up, with those of other counters, in refreshTravelIndex().
+void bookingAppended(const struct Booking *booking)
+{
+    nameIndexAdd(booking->name, booking->ticketID);
+}
+
+int compareTravelIndexEntries(const void *a, const void *b)
+{
+    const struct TravelIndexEntry *x = a, *y = b;
+    if (x->day != y->day)
+    {
+        return x->day < y->day ? -1 : 1;
+    }
+    return x->record - y->record;
+}
+
+// Indexes the records of bookings.dat from bookingRecordCount on, merging
+// them into the sorted entries. Returns false if it ran out of memory.
+bool indexBookingRecords(FILE *file)
+{
+    int first = travelIndexCount;
+    struct Booking booking;
+    while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+    {
+        int record = bookingRecordCount++;
+        if (!bookingIntact(&booking))
+        {
+            continue;
+        }
+        if (travelIndexCount == travelIndexCapacity)
+        {
+            int capacity = travelIndexCapacity ? travelIndexCapacity * 2 : 1024;
+            struct TravelIndexEntry *entries = realloc(travelIndex, capacity * sizeof(struct TravelIndexEntry));
+            if (entries == NULL)
+            {
+                return false;
+            }
+            travelIndex = entries;
+            travelIndexCapacity = capacity;
+        }
+        travelIndex[travelIndexCount].day = booking.travelDate / SECONDS_PER_DAY;
+        travelIndex[travelIndexCount].record = record;
+        travelIndexCount++;
+    }
+
+    // Sort the new entries alone, then merge them in from the back: they
+    // are usually a handful of appends to a long index
+    int added = travelIndexCount - first;
+    qsort(travelIndex + first, added, sizeof(struct TravelIndexEntry), compareTravelIndexEntries);
+    struct TravelIndexEntry *tail = malloc((added > 0 ? added : 1) * sizeof(struct TravelIndexEntry));
+    if (tail == NULL)
+    {
+        return false;
+    }
+    memcpy(tail, travelIndex + first, added * sizeof(struct TravelIndexEntry));
+    int i = first - 1, j = added - 1;
+    for (int at = travelIndexCount - 1; j >= 0; at--)
+    {
+        travelIndex[at] = i >= 0 && compareTravelIndexEntries(&travelIndex[i], &tail[j]) > 0 ? travelIndex[i--] : tail[j--];
+    }
+    free(tail);
+    return true;
+}
+
+// Brings the index up to the bookings.dat now in place. Records appended
+// since, by any counter, are indexed from where it left off. A replaced or
+// shortened file is indexed again from the start, since record numbers
+// changed; a modified one needs nothing, as a booking's travel date never
+// changes. Call after prepareBookingsScan().
+void refreshTravelIndex()
+{
+    struct FileVersion current;
+    readFileVersion(FILENAME, &current);
+    if (travelIndexBuilt && sameFileIdentity(&current.identity, &travelIndexSource.identity) &&
+        current.size == travelIndexSource.size)
+    {
+        return;
+    }
+    if (!travelIndexBuilt || !sameFileIdentity(&current.identity, &travelIndexSource.identity) ||
+        current.size < travelIndexSource.size)
+    {
+        travelIndexCount = 0;
+        bookingRecordCount = 0;
+    }
+    travelIndexBuilt = false;
+    FILE *file = openDataFile(FILENAME);
+    if (file == NULL)
+    {
+        return;
+    }
+    // Read from the current position even if the file grew again meanwhile:
+    // bookingRecordCount, not the size, says where the next refresh resumes
+    if (fseeko(file, recordOffset(bookingRecordCount, sizeof(struct Booking)), SEEK_SET) == 0 && indexBookingRecords(file))
+    {
+        travelIndexSource = current;
+        travelIndexBuilt = true;
+    }
+    fclose(file);
+}
+
+// Called after bookings.dat has been rewritten in place of the old file.
+void bookingsFileRewritten()
+{
+    ioBackend->fileReplaced(FILENAME);
+    recordSeatMapSource();
+    travelIndexBuilt = false; // Records were renumbered
+    reportTotalsStale = true;
+}
+
+// Prompts until a valid YYYY-MM-DD date is entered.
+int promptDate(const char *prompt)
+{
+    char text[32];
+    int day;
+    do
+    {
+        printf("%s", prompt);
+        if (fgets(text, sizeof(text), stdin) == NULL)
+        {
+            stopAtEndOfInput();
+            printf("Error: Failed to read input. Please try again.\n");
+            continue;
+        }
+        text[strcspn(text, "\n")] = '\0';
+        if (!parseDate(text, &day))
+        {
+            printf("Error: Invalid date. Please use the format YYYY-MM-DD.\n");
+            continue;
+        }
+        break;
+    } while (1);
+    return day;
+}
+
+// Per-route waitlists. Requests are persisted in waitlist.dat and kept in a
+// binary heap per route ordered by tier (VIP first) and then request time.
+// Whenever seats free up on a route the head of its heap is promoted into a
+// real booking, one O(log n) pop per promoted request.
+//   Other counters append to waitlist.dat and promote from it too, so the
+// in-memory copy is reloaded whenever the file changed, and a request is
+// taken off the file under its record lock before it is booked.
+struct WaitlistEntry
+{
+    int requestID;
+    char name[MAX_NAME_LENGTH];
+    short currentCityID;
+    short destinationCityID;
+    unsigned char modeID;
+    unsigned char categoryID; // Also the priority tier
+    int numTravelers;
+    long long travelDate;
+    long long requestedAt;
+    bool active;
+    bool returnTicket; // Fits in the padding, so older waitlist.dat files read it as false
+    unsigned char coachClass; // Class index + 1, or 0 for any class; also in the padding
+    unsigned char berthType;  // enum BerthType + 1, or 0 for any berth
+};
+
+_Static_assert(sizeof(struct WaitlistEntry) == 88, "New waitlist fields must fit in the padding of waitlist.dat records");
+
+struct WaitlistHeap
+{
+    int *items; // Record numbers in waitlist.dat
+    int count;
+    int capacity;
+};
+
+struct WaitlistEntry *waitlistEntries = NULL; // In-memory copy of waitlist.dat
+int waitlistEntryCount = 0;
+int waitlistEntryCapacity = 0;
+struct WaitlistHeap *waitlists = NULL; // Indexed by route, grown as routes get waitlists
+int waitlistRouteCapacity = 0;
+struct stat waitlistLoaded; // waitlist.dat as of the last load; st_ino 0 if it was missing
+
+// Returns the heap of a route, making room for it if create is set. Returns
+// NULL if the route has no waitlist.
+struct WaitlistHeap *waitlistFor(int routeIndex, bool create)
+{
+    if (routeIndex >= waitlistRouteCapacity && create)
+    {
+        int capacity = waitlistRouteCapacity ? waitlistRouteCapacity : 16;
+        while (capacity <= routeIndex)
+        {
+            capacity *= 2;
+        }
+        struct WaitlistHeap *heaps = realloc(waitlists, capacity * sizeof(struct WaitlistHeap));
+        if (heaps == NULL)
+        {
+            return NULL;
+        }
+        memset(heaps + waitlistRouteCapacity, 0, (capacity - waitlistRouteCapacity) * sizeof(struct WaitlistHeap));
+        waitlists = heaps;
+        waitlistRouteCapacity = capacity;
+    }
+    return routeIndex < waitlistRouteCapacity ? &waitlists[routeIndex] : NULL;
+}
+
+// True when entry a should be promoted before entry b
+bool waitlistBefore(int a, int b)
+{
+    const struct WaitlistEntry *x = &waitlistEntries[a];
+    const struct WaitlistEntry *y = &waitlistEntries[b];
+    if (x->categoryID != y->categoryID)
+    {
+        return x->categoryID > y->categoryID;
+    }
+    if (x->requestedAt != y->requestedAt)
+    {
+        return x->requestedAt < y->requestedAt;
+    }
+    return a < b;
+}
+
+bool waitlistPush(int routeIndex, int entry)
+{
+    struct WaitlistHeap *heap = waitlistFor(routeIndex, true);
+    if (heap == NULL)
+    {
+        return false;
+    }
+    if (heap->count == heap->capacity)
+    {
+        int capacity = heap->capacity ? heap->capacity * 2 : 16;
+        int *items = realloc(heap->items, capacity * sizeof(int));
+        if (items == NULL)
+        {
+            return false;
+        }
+        heap->items = items;
+        heap->capacity = capacity;
+    }
+
+    int i = heap->count++;
+    while (i > 0 && waitlistBefore(entry, heap->items[(i - 1) / 2]))
+    {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i] = entry;
+    return true;
+}
+
+int waitlistPop(int routeIndex)
+{
+    struct WaitlistHeap *heap = waitlistFor(routeIndex, false);
+    int top = heap->items[0];
+    int last = heap->items[--heap->count];
+    int i = 0;
+    while (2 * i + 1 < heap->count)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < heap->count && waitlistBefore(heap->items[child + 1], heap->items[child]))
+        {
+            child++;
+        }
+        if (!waitlistBefore(heap->items[child], last))
+        {
+            break;
+        }
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->count > 0)
+    {
+        heap->items[i] = last;
+    }
+    return top;
+}
+
+int storeWaitlistEntry(const struct WaitlistEntry *entry)
+{
+    if (waitlistEntryCount == waitlistEntryCapacity)
+    {
+        int capacity = waitlistEntryCapacity ? waitlistEntryCapacity * 2 : 64;
+        struct WaitlistEntry *entries = realloc(waitlistEntries, capacity * sizeof(struct WaitlistEntry));
+        if (entries == NULL)
+        {
+            return -1;
+        }
+        waitlistEntries = entries;
+        waitlistEntryCapacity = capacity;
+    }
+    waitlistEntries[waitlistEntryCount] = *entry;
+    return waitlistEntryCount++;
+}
+
+// Reads waitlist.dat into memory, replacing what was loaded before.
+void loadWaitlist()
+{
+    waitlistEntryCount = 0;
+    for (int r = 0; r < waitlistRouteCapacity; r++)
+    {
+        waitlists[r].count = 0;
+    }
+    memset(&waitlistLoaded, 0, sizeof(waitlistLoaded));
+    FILE *file = fopen(WAITLIST_FILENAME, "rb");
+    if (file == NULL)
+    {
+        return;
+    }
+    fstat(fileno(file), &waitlistLoaded);
+
+    struct WaitlistEntry entry;
+    while (fread(&entry, sizeof(entry), 1, file) == 1)
+    {
+        int index = storeWaitlistEntry(&entry);
+        if (index < 0 || !entry.active)
+        {
+            continue;
+        }
+        int routeIndex = addRoute(entry.currentCityID, entry.destinationCityID, entry.modeID);
+        if (routeIndex >= 0)
+        {
+            waitlistPush(routeIndex, index);
+        }
+    }
+    fclose(file);
+}
+
+// Reloads waitlist.dat if another counter, or this one, changed it since it
+// was last loaded. Heap items are record numbers in the file, so appends by
+// others must be picked up before any new entry is indexed.
+void refreshWaitlist()
+{
+    struct stat current;
+    if (stat(WAITLIST_FILENAME, &current) != 0)
+    {
+        memset(&current, 0, sizeof(current));
+    }
+    if (current.st_ino != waitlistLoaded.st_ino || current.st_dev != waitlistLoaded.st_dev ||
+        current.st_size != waitlistLoaded.st_size || current.st_mtim.tv_sec != waitlistLoaded.st_mtim.tv_sec ||
+        current.st_mtim.tv_nsec != waitlistLoaded.st_mtim.tv_nsec)
+    {
+        loadWaitlist();
+    }
+}
+
+// Adds a request to the waitlist of its route. Trains keep the coach class
+// (-1 for any) and berth type (BERTH_ANY for any) the traveller asked for.
+int joinWaitlist(const struct Booking *booking, int numTravelers, int coachClass, int berthType)
+{
+    struct WaitlistEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.requestID = unique_id();
+    snprintf(entry.name, sizeof(entry.name), "%s", booking->name);
+    entry.currentCityID = booking->currentCityID;
+    entry.destinationCityID = booking->destinationCityID;
+    entry.modeID = booking->modeID;
+    entry.categoryID = booking->categoryID;
+    entry.numTravelers = numTravelers;
+    entry.returnTicket = booking->returnTicket;
+    entry.coachClass = coachClass + 1;
+    entry.berthType = berthType == BERTH_ANY ? 0 : berthType + 1;
+    entry.travelDate = booking->travelDate;
+    entry.requestedAt = currentTime();
+    entry.active = true;
+
+    // The reload indexes the entry at the record number the append gave it
+    if (!ioBackend->append(WAITLIST_FILENAME, &entry, sizeof(entry)))
+    {
+        printf("Error: Unable to add you to the waitlist. Please try again.\n");
+        return -1;
+    }
+    flushIOBackend();
+    refreshWaitlist();
+    return entry.requestID;
+}
+
+// Sets a waitlist record's active flag through ioBackend->update(), provided
+// it is still the same request and the flag is not already set that way.
+struct WaitlistChange
+{
+    int requestID;
+    long long requestedAt;
+    bool active;
+};
+
+bool applyWaitlistChange(void *record, void *context)
+{
+    struct WaitlistEntry *entry = record;
+    const struct WaitlistChange *change = context;
+    if (entry->requestID != change->requestID || entry->requestedAt != change->requestedAt || entry->active == change->active)
+    {
+        return false;
+    }
+    entry->active = change->active;
+    return true;
+}
+
+int fareFor(int currentCityID, int modeID, int categoryID)
+{
+    if (currentCityID < 0 || currentCityID >= numCities)
+    {
+        return 0;
+    }
+    return modeID == MODE_BUS ? busPrices[currentCityID][categoryID] : ticketPrices[currentCityID][categoryID];
+}
+
+// Price of a booking: the fare of its route, twice over for a return ticket.
+int bookingFare(const struct Booking *booking)
+{
+    int fare = fareFor(booking->currentCityID, booking->modeID, booking->categoryID);
+    return booking->returnTicket ? fare * 2 : fare;
+}
+
+// Picks seats for a waitlisted request like addBooking() would: berths of
+// its type in its class on a train, trying each class in order when it
+// asked for none.
+int assignWaitlistSeats(int routeIndex, const struct WaitlistEntry *entry, int *seats)
+{
+    if (entry->modeID != MODE_TRAIN)
+    {
+        return autoAssignSeats(routeIndex, entry->numTravelers, seats);
+    }
+    int berthType = entry->berthType > 0 ? entry->berthType - 1 : BERTH_ANY;
+    int fragments = -1;
+    for (int k = 0; k < TRAIN_CLASSES && fragments < 0; k++)
+    {
+        if (entry->coachClass == 0 || entry->coachClass == k + 1)
+        {
+            fragments = autoAssignBerths(routeIndex, k, berthType, entry->numTravelers, seats);
+        }
+    }
+    return fragments;
+}
+
+// Books seats for waitlisted requests on a route while the request at the
+// head of the queue fits into the free seats.
+void promoteWaitlist(int routeIndex)
+{
+    refreshWaitlist();
+    struct WaitlistHeap *heap = waitlistFor(routeIndex, false);
+    while (heap != NULL && heap->count > 0)
+    {
+        int index = heap->items[0];
+        struct WaitlistEntry *entry = &waitlistEntries[index];
+        struct Booking booking;
+        memset(&booking, 0, sizeof(booking));
+        int seats[MAX_TRAVELERS];
+        if (assignWaitlistSeats(routeIndex, entry, seats) < 0)
+        {
+            break; // The head of the queue does not fit yet
+        }
+        if (!claimSeats(routeIndex, seats, entry->numTravelers))
+        {
+            continue; // Another process took one of them, pick again
+        }
+        waitlistPop(routeIndex);
+
+        // Only the counter that clears the request's active flag on disk books it
+        long offset = (long)index * sizeof(struct WaitlistEntry);
+        struct WaitlistChange taken = {entry->requestID, entry->requestedAt, false};
+        if (!ioBackend->update(WAITLIST_FILENAME, offset, sizeof(struct WaitlistEntry), applyWaitlistChange, &taken))
+        {
+            entry->active = false; // Promoted by another counter already
+            for (int i = 0; i < entry->numTravelers; i++)
+            {
+                markSeatFree(&seatMap->routes[routeIndex], seats[i]);
+            }
+            continue;
+        }
+        entry->active = false;
+        setBookingSeats(&booking, seats, entry->numTravelers); // Both assigners keep within MAX_SEAT_RUNS
+
+        booking.ticketID = unique_id();
+        strcpy(booking.name, entry->name);
+        booking.currentCityID = entry->currentCityID;
+        booking.destinationCityID = entry->destinationCityID;
+        booking.modeID = entry->modeID;
+        booking.categoryID = entry->categoryID;
+        booking.returnTicket = entry->returnTicket;
+        booking.price = bookingFare(&booking);
+        booking.numTravelers = entry->numTravelers;
+        booking.bookedSeat = entry->numTravelers;
+        booking.travelDate = entry->travelDate;
+        booking.createdAt = currentTime();
+
+        sealBooking(&booking);
+        if (!insertBooking(&booking))
+        {
+            printf("Error: Failed to promote waitlisted request %d.\n", entry->requestID);
+            struct WaitlistChange restored = {entry->requestID, entry->requestedAt, true};
+            if (ioBackend->update(WAITLIST_FILENAME, offset, sizeof(struct WaitlistEntry), applyWaitlistChange, &restored))
+            {
+                entry->active = true;
+                waitlistPush(routeIndex, index);
+            }
+            for (int i = 0; i < booking.numTravelers; i++)
+            {
+                markSeatFree(&seatMap->routes[routeIndex], seats[i]);
+            }
+            break;
+        }
+        bookingAppended(&booking);
+        printf("Waitlisted request %d for %s promoted: Ticket ID %d.\n", entry->requestID, entry->name, booking.ticketID);
+        bool created;
+        if (earnBookingPoints(booking.name, booking.price, &created) < 0)
+        {
+            printf("Error: Unable to update Reedem points for %s.\n", booking.name);
+        }
+    }
+    flushIOBackend();
+}
+
+// Booking session journal. Every in-progress booking is a session keyed by
+// its ticket ID. Progress is appended to the journal as small entries and an
+// in-memory hash table maps each session to its latest snapshot, so resuming
+// is a single lookup plus one read. Abandoned and finished sessions are
+// dropped when the journal is compacted.
+//   Snapshots are whole bookings, so the journal starts with a data file
+// header naming their layout. A journal of another layout only holds
+// unfinished bookings; it is set aside rather than converted.
+enum JournalEntryType
+{
+    JOURNAL_SNAPSHOT = 1, // Followed by a struct Booking
+    JOURNAL_CLOSE = 2
+};
+
+struct JournalEntry
+{
+    int sessionID;
+    int type;
+    int stage;
+    long long updatedAt;
+};
+
+struct SessionSlot
+{
+    int sessionID;
+    bool used;
+    bool open;
+    int stage;
+    long long updatedAt;
+    long snapshotOffset; // Offset of the booking payload in the journal
+};
+
+struct SessionTable
+{
+    struct SessionSlot *slots;
+    int capacity; // Always a power of two
+    int used;
+    int openCount;
+    long entryCount;
+    long journalSize;
+    bool loaded;
+};
+
+struct SessionTable sessions = {0};
+
+unsigned int hashSessionID(int sessionID)
+{
+    unsigned int h = (unsigned int)sessionID;
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h;
+}
+
+struct SessionSlot *findSessionSlot(int sessionID, bool create)
+{
+    if (create && (sessions.used + 1) * 2 > sessions.capacity)
+    {
+        int capacity = sessions.capacity ? sessions.capacity * 2 : 64;
+        struct SessionSlot *slots = calloc(capacity, sizeof(struct SessionSlot));
+        if (slots == NULL)
+        {
+            return NULL;
+        }
+        for (int i = 0; i < sessions.capacity; i++)
+        {
+            if (sessions.slots[i].used)
+            {
+                unsigned int j = hashSessionID(sessions.slots[i].sessionID) & (capacity - 1);
+                while (slots[j].used)
+                {
+                    j = (j + 1) & (capacity - 1);
+                }
+                slots[j] = sessions.slots[i];
+            }
+        }
+        free(sessions.slots);
+        sessions.slots = slots;
+        sessions.capacity = capacity;
+    }
+    if (sessions.capacity == 0)
+    {
+        return NULL;
+    }
+
+    unsigned int i = hashSessionID(sessionID) & (sessions.capacity - 1);
+    while (sessions.slots[i].used)
+    {
+        if (sessions.slots[i].sessionID == sessionID)
+        {
+            return &sessions.slots[i];
+        }
+        i = (i + 1) & (sessions.capacity - 1);
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+    sessions.slots[i].used = true;
+    sessions.slots[i].sessionID = sessionID;
+    sessions.slots[i].open = false;
+    sessions.used++;
+    return &sessions.slots[i];
+}
+
+void applyJournalEntry(const struct JournalEntry *entry, long payloadOffset)
+{
+    struct SessionSlot *slot = findSessionSlot(entry->sessionID, entry->type == JOURNAL_SNAPSHOT);
+    if (slot == NULL)
+    {
+        return;
+    }
+    if (entry->type == JOURNAL_SNAPSHOT)
+    {
+        if (!slot->open)
+        {
+            sessions.openCount++;
+        }
+        slot->open = true;
+        slot->stage = entry->stage;
+        slot->updatedAt = entry->updatedAt;
+        slot->snapshotOffset = payloadOffset;
+    }
+    else if (entry->type == JOURNAL_CLOSE && slot->open)
+    {
+        slot->open = false;
+        sessions.openCount--;
+    }
+    sessions.entryCount++;
+}
+
+void resetSessionTable()
+{
+    free(sessions.slots);
+    memset(&sessions, 0, sizeof(sessions));
+}
+
+void replaySessionJournal()
+{
+    resetSessionTable();
+    sessions.loaded = true;
+
+    ioBackend->prepareRead(SESSION_JOURNAL_FILENAME);
+    FILE *file = fopen(SESSION_JOURNAL_FILENAME, "rb");
+    if (file == NULL)
+    {
+        return; // Created with its header by the first append
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    if (!dataHeaderCurrent(fileno(file), SESSION_JOURNAL_FILENAME))
+    {
+        fclose(file);
+        if (fileSize > 0 && rename(SESSION_JOURNAL_FILENAME, SESSION_JOURNAL_FILENAME ".old") == 0)
+        {
+            printf("Note: Unfinished bookings saved by an older version were moved to %s.\n", SESSION_JOURNAL_FILENAME ".old");
+        }
+        else
+        {
+            remove(SESSION_JOURNAL_FILENAME);
+        }
+        ioBackend->fileReplaced(SESSION_JOURNAL_FILENAME);
+        return;
+    }
+    fseek(file, DATA_HEADER_SIZE, SEEK_SET);
+
+    struct JournalEntry entry;
+    long offset = DATA_HEADER_SIZE;
+    sessions.journalSize = offset;
+    while (fread(&entry, sizeof(entry), 1, file) == 1)
+    {
+        long payloadOffset = offset + sizeof(entry);
+        offset = payloadOffset + (entry.type == JOURNAL_SNAPSHOT ? sizeof(struct Booking) : 0);
+        if (offset > fileSize || fseek(file, offset, SEEK_SET) != 0)
+        {
+            break; // Torn final entry
+        }
+        applyJournalEntry(&entry, payloadOffset);
+        sessions.journalSize = offset;
+    }
+    fclose(file);
+}
+
+bool appendJournalEntry(int sessionID, int type, int stage, const struct Booking *booking)
+{
+    struct JournalEntry entry = {sessionID, type, stage, (long long)currentTime()};
+    if (sessions.journalSize == 0)
+    {
+        if (!createDataFile(SESSION_JOURNAL_FILENAME))
+        {
+            return false;
+        }
+        sessions.journalSize = DATA_HEADER_SIZE;
+    }
+    long payloadOffset = sessions.journalSize + sizeof(entry);
+    if (!ioBackend->append(SESSION_JOURNAL_FILENAME, &entry, sizeof(entry)))
+    {
+        return false;
+    }
+    if (type == JOURNAL_SNAPSHOT && !ioBackend->append(SESSION_JOURNAL_FILENAME, booking, sizeof(struct Booking)))
+    {
+        return false;
+    }
+    sessions.journalSize = payloadOffset + (type == JOURNAL_SNAPSHOT ? sizeof(struct Booking) : 0);
+    applyJournalEntry(&entry, payloadOffset);
+    return true;
+}
+
+bool readSessionSnapshot(const struct SessionSlot *slot, struct Booking *booking)
+{
+    ioBackend->prepareRead(SESSION_JOURNAL_FILENAME);
+    int fd = open(SESSION_JOURNAL_FILENAME, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool success = (pread(fd, booking, sizeof(struct Booking), slot->snapshotOffset) == sizeof(struct Booking));
+    close(fd);
+    return success;
+}
+
+// Rewrites the journal with one snapshot per live session, dropping finished
+// sessions and closing the ones idle for longer than SESSION_TTL_SECONDS.
+void compactSessionJournal()
+{
+    long long now = currentTime();
+    const char *tempName = SESSION_JOURNAL_FILENAME ".tmp";
+    FILE *tempFile = fopen(tempName, "wb");
+    if (tempFile == NULL || !writeDataHeader(tempFile, SESSION_JOURNAL_FILENAME))
+    {
+        if (tempFile != NULL)
+        {
+            fclose(tempFile);
+            remove(tempName);
+        }
+        return;
+    }
+
+    for (int i = 0; i < sessions.capacity; i++)
+    {
+        struct SessionSlot *slot = &sessions.slots[i];
+        struct Booking booking;
+        if (!slot->used || !slot->open || now - slot->updatedAt > SESSION_TTL_SECONDS)
+        {
+            continue;
+        }
+        if (!readSessionSnapshot(slot, &booking))
+        {
+            continue;
+        }
+        struct JournalEntry entry = {slot->sessionID, JOURNAL_SNAPSHOT, slot->stage, slot->updatedAt};
+        fwrite(&entry, sizeof(entry), 1, tempFile);
+        fwrite(&booking, sizeof(booking), 1, tempFile);
+    }
+
+    if (fclose(tempFile) == 0 && rename(tempName, SESSION_JOURNAL_FILENAME) == 0)
+    {
+        replaySessionJournal();
+    }
+    else
+    {
+        remove(tempName);
+    }
+}
+
+void loadSessionJournal()
+{
+    if (sessions.loaded)
+    {
+        return;
+    }
+    replaySessionJournal();
+
+    bool abandoned = false;
+    long long now = currentTime();
+    for (int i = 0; i < sessions.capacity && !abandoned; i++)
+    {
+        abandoned = sessions.slots[i].open && now - sessions.slots[i].updatedAt > SESSION_TTL_SECONDS;
+    }
+    if (abandoned || sessions.entryCount > 2L * sessions.openCount + JOURNAL_COMPACT_MIN_ENTRIES)
+    {
+        compactSessionJournal();
+    }
+}
+
+void savePartialBooking(struct PartialBooking *partial)
+{
+    loadSessionJournal();
+    int type = partial->inProgress ? JOURNAL_SNAPSHOT : JOURNAL_CLOSE;
+    if (!appendJournalEntry(partial->booking.ticketID, type, partial->stage, &partial->booking))
+    {
+        printf("Error: Unable to save partial booking. Please try again.\n");
+    }
+}
+
+bool loadPartialBooking(int sessionID, struct PartialBooking *partial)
+{
+    loadSessionJournal();
+    struct SessionSlot *slot = findSessionSlot(sessionID, false);
+    if (slot == NULL || !slot->open || !readSessionSnapshot(slot, &partial->booking))
+    {
+        return false;
+    }
+    partial->inProgress = true;
+    partial->stage = slot->stage;
+    return true;
+}
+
+int openSessionCount()
+{
+    loadSessionJournal();
+    return sessions.openCount;
+}
+
+int listOpenSessions()
+{
+    if (openSessionCount() == 0)
+    {
+        return 0;
+    }
+
+    printf("\nBookings in progress:\n");
+    printf(" +------------+----------------------+-------+\n");
+    printf(" | Session ID | Name                 | Stage |\n");
+    printf(" +------------+----------------------+-------+\n");
+    for (int i = 0; i < sessions.capacity; i++)
+    {
+        struct Booking booking;
+        if (sessions.slots[i].used && sessions.slots[i].open && readSessionSnapshot(&sessions.slots[i], &booking))
+        {
+            printf(" | %-10d | %-20.20s | %-5d |\n", sessions.slots[i].sessionID,
+                   sessions.slots[i].stage > 1 ? booking.name : "", sessions.slots[i].stage);
+        }
+    }
+    printf(" +------------+----------------------+-------+\n");
+    return sessions.openCount;
+}
+
+int discardOpenSessions()
+{
+    int discarded = 0;
+    loadSessionJournal();
+    for (int i = 0; i < sessions.capacity; i++)
+    {
+        if (sessions.slots[i].used && sessions.slots[i].open &&
+            appendJournalEntry(sessions.slots[i].sessionID, JOURNAL_CLOSE, sessions.slots[i].stage, NULL))
+        {
+            discarded++;
+        }
+    }
+    flushIOBackend();
+    return discarded;
+}
+
+void saveBookingProgress()
+{
+    flushIOBackend();
+    printf("Booking progress saved successfully.\n");
+}
+
+void generateReferenceNumber(char *refNumber, int ticketID)
+{
+    srand((unsigned)currentTime());
+    int random = rand() % 1000;
+    sprintf(refNumber, "REF-%d-%03d", ticketID, random);
+}
+
+int unique_id()
+{ // Automatically Generate Unique, Non-Repeating Ticket IDs #16 by Vasu
+    static int counter = 0;
+    time_t now = currentTime();
+    return ((int)(now % 1234) | counter++);
+}
+
+void printBookingSummary(const struct PartialBooking *partial, int n)
+{
+    printf("\n +--------------------------------------------------+\n");
+    printf(" |                 Booking Summary                  |\n");
+    printf(" +--------------------------------------------------+\n");
+    printf(" | Ticket ID: %-35d |\n", partial->booking.ticketID);
+    printf(" | Name: %-42s |\n", partial->booking.name);
+    printf(" | Current Location: %-30s |\n", cityName(partial->booking.currentCityID));
+    printf(" | Destination: %-34s |\n", cityName(partial->booking.destinationCityID));
+    printf(" | Mode: %-36s |\n", modeName(partial->booking.modeID));
+    printf(" | Number of Travelers: %-27d |\n", n);
+    printf(" | Category: %-36s |\n", categoryName(partial->booking.categoryID));
+    char travelDay[16];
+    formatDay(partial->booking.travelDate / SECONDS_PER_DAY, travelDay, sizeof(travelDay));
+    printf(" | Travel Date: %-33s |\n", travelDay);
+
+    printf(" | Seats Booked: ");
+    int seats[MAX_TRAVELERS];
+    for (int j = 0; j < bookingSeats(&partial->booking, seats); j++)
+    {
+        printf("%d ", seats[j]);
+    }
+    printf("%*s|\n", 39 - (2 * n), ""); // Adjust spacing based on seat numbers
+
+    printf(" | Price: Rs.%-35d |\n", partial->booking.price);
+    printf(" +--------------------------------------------------+\n");
+}
+
+void addBooking()
+{
+    struct PartialBooking partial = {0};
+    bool resuming = false;
+    char bookingReference[20]; // To store the generated booking reference number
+
+    char userName[MAX_NAME_LENGTH];
+    strcpy(userName, partial.booking.name);
+    
+    TransportMode(&partial);
+    if (listOpenSessions() > 0)
+    {
+        printf("Enter a session ID to resume, or 0 to start a new booking: ");
+        int sessionID;
+        if (scanf("%d", &sessionID) != 1)
+        {
+            printf("Error: Invalid input. Starting a new booking.\n");
+        }
+        else if (sessionID != 0)
+        {
+            resuming = loadPartialBooking(sessionID, &partial);
+            if (!resuming)
+            {
+                printf("No booking in progress with session ID %d. Starting a new booking.\n", sessionID);
+            }
+        }
+        clearInputBuffer();
+    }
+
+    if (!resuming)
+    {
+        partial.inProgress = true;
+        partial.stage = 0;
+    }
+
+    if (!resuming || partial.stage == 0)
+    {
+        partial.booking.ticketID = unique_id();
+        partial.stage = 1;
+    }
+
+    if (!resuming || partial.stage <= 1)
+    {
+        printf("\n");
+        // Get Name
+        do
+        {
+            printf("Enter Name (alphabets and spaces only, or 'pause' to pause): ");
             if (fgets(partial.booking.name, MAX_NAME_LENGTH, stdin) == NULL)
             {
-                printf("Error: Failed to read input. Please try again.\n");
-                continue;
+                stopAtEndOfInput();
+                printf("Error: Failed to read input. Please try again.\n");
+                continue;
+            }
+            partial.booking.name[strcspn(partial.booking.name, "\n")] = 0; // Remove newline
+            if (strcmp(partial.booking.name, "pause") == 0)
+            {
+                savePartialBooking(&partial);
+                printf("Booking paused. You can resume later.\n");
+                return;
+            }
+            if (!isValidName(partial.booking.name))
+            {
+                printf("Error: Invalid name. Please use only alphabets and spaces.\n");
+                continue;
+            }
+            break;
+        } while (1);
+        partial.stage = 2;
+        savePartialBooking(&partial);
+    }
+    printf("\n");
+    if (!resuming || partial.stage <= 2)
+    {
+
+        int currentChoice;
+        char returnChoice[4]; // return ticket implementation
+        do
+        {
+            printf("Do you want return ticket(yes or no) : ");
+            if (fgets(returnChoice, sizeof(returnChoice), stdin) == NULL)
+            {
+                stopAtEndOfInput();
+                printf("Error: Failed to read input. Please try again.\n");
+                continue;
+            }
+
+            // Remove newline character that fgets adds
+            returnChoice[strcspn(returnChoice, "\n")] = '\0';
+            if (strcmp(returnChoice, "yes") == 0)
+            {
+                partial.booking.returnTicket = true;
+                printf("Return ticket selected.\n");
+                break;
+            }
+            else if (strcmp(returnChoice, "no") == 0)
+            {
+                partial.booking.returnTicket = false;
+                printf("One-way ticket selected.\n");
+                break;
+            }
+            else
+            {
+                printf("Invalid input. Please enter 'yes' or 'no'.\n");
+            }
+
+        } while (1);
+        // Current Location Input
+        printf("Enter your current location:\n");
+        for (int i = 0; i < numCities; i++)
+        {
+            printf("%d. %s\n", i + 1, indianCities[i]);
+        }
+
+        do
+        {
+            printf("Enter the number of your current location (1-%d), or 0 to pause: ", numCities);
+            if (scanf("%d", &currentChoice) != 1 || currentChoice < 0 || currentChoice > numCities)
+            {
+                stopAtEndOfInput();
+                printf("Error: Invalid choice. Please enter a number between 0 and %d.\n", numCities);
+                clearInputBuffer();
+                continue;
+            }
+            if (currentChoice == 0)
+            {
+                savePartialBooking(&partial);
+                printf("Booking paused. You can resume later.\n");
+                return;
+            }
+            break;
+        } while (1);
+
+        partial.booking.currentCityID = currentChoice - 1;
+        clearInputBuffer();
+
+        int choice;
+        printf("\n");
+        // Destination Input
+        printf("Select Destination:\n");
+        for (int i = 0; i < numCities; i++)
+        {
+            printf("%d. %s\n", i + 1, indianCities[i]);
+        }
+
+        do
+        {
+            printf("Enter the number of your destination (1-%d), or 0 to pause: ", numCities);
+            if (scanf("%d", &choice) != 1 || choice < 0 || choice > numCities)
+            {
+                stopAtEndOfInput();
+                printf("Error: Invalid choice. Please enter a number between 0 and %d.\n", numCities);
+                clearInputBuffer();
+                continue;
+            }
+            if (choice == 0)
+            {
+                savePartialBooking(&partial);
+                printf("Booking paused. You can resume later.\n");
+                return;
+            }
+            break;
+        } while (1);
+        printf("\n");
+        // Check for same pickup and destination
+        if (currentChoice - 1 == choice - 1)
+        {
+            printf("Pickup point and destination cannot be the same.\n");
+            return;
+        }
+
+        partial.booking.destinationCityID = choice - 1;
+
+        // Add the route for new booking
+        if (addRoute(partial.booking.currentCityID, partial.booking.destinationCityID, partial.booking.modeID) < 0)
+        {
+            printf("Sorry, no more routes can be opened.\n");
+            return;
+        }
+
+        clearInputBuffer();
+        partial.booking.travelDate = (long long)promptDate("Enter travel date (YYYY-MM-DD): ") * SECONDS_PER_DAY;
+
+        int n;
+        printf("\n");
+        do
+        {
+            // Traveler Count Input
+            printf("Enter how many travelers: ");
+            if (scanf("%d", &n) != 1 || n <= 0 || n > MAX_TRAVELERS)
+            {
+                stopAtEndOfInput();
+                printf("Invalid input. Please enter a valid number of travelers (1-%d).\n", MAX_TRAVELERS);
+                clearInputBuffer();
+            }
+            else
+            {
+                break;
+            }
+        } while (1);
+        clearInputBuffer();
+
+        int categoryChoice;
+        printf("\n");
+        // Ticket Category Selection
+        printf("Select Ticket Category:\n");
+        for (int i = 0; i < sizeof(ticketCategories) / sizeof(ticketCategories[0]); i++)
+        {
+            printf("%d. %s\n", i + 1, ticketCategories[i]);
+        }
+        printf("\n");
+        do
+        {
+            printf("Enter the number of your selected category (1-%ld): ", sizeof(ticketCategories) / sizeof(ticketCategories[0]));
+            if (scanf("%d", &categoryChoice) != 1 || categoryChoice < 1 || categoryChoice > sizeof(ticketCategories) / sizeof(ticketCategories[0]))
+            {
+                stopAtEndOfInput();
+                printf("Error: Invalid choice. Please enter a number between 1 and %ld.\n", sizeof(ticketCategories) / sizeof(ticketCategories[0]));
+                clearInputBuffer();
+                continue;
+            }else{
+                partial.booking.categoryID = categoryChoice - 1;
+            }
+            break;
+        } while (1);
+     
+        // No seats are booked yet
+        memset(partial.booking.seatRuns, 0, sizeof(partial.booking.seatRuns));
+
+        int autoAssign = 0;
+        int coachClass = -1, berthType = BERTH_ANY;
+        if (partial.booking.modeID == MODE_TRAIN)
+        {
+            printf("\nSelect Coach Class:\n");
+            for (int k = 0; k < TRAIN_CLASSES; k++)
+            {
+                printf("%d. %s\n", k + 1, coachClasses[k].name);
+            }
+            do
+            {
+                printf("Enter the number of your coach class (1-%d): ", TRAIN_CLASSES);
+                if (scanf("%d", &coachClass) != 1 || coachClass < 1 || coachClass > TRAIN_CLASSES)
+                {
+                    stopAtEndOfInput();
+                    printf("Error: Invalid choice. Please enter a number between 1 and %d.\n", TRAIN_CLASSES);
+                    clearInputBuffer();
+                    continue;
+                }
+                break;
+            } while (1);
+            coachClass--;
+
+            int preference;
+            printf("\nBerth Preference:\n");
+            printf("0. Any\n");
+            for (int type = 0; type < BERTH_TYPES; type++)
+            {
+                printf("%d. %s\n", type + 1, berthTypeNames[type]);
+            }
+            printf("%d. Choose berths myself\n", BERTH_TYPES + 1);
+            do
+            {
+                printf("Enter your berth preference (0-%d): ", BERTH_TYPES + 1);
+                if (scanf("%d", &preference) != 1 || preference < 0 || preference > BERTH_TYPES + 1)
+                {
+                    stopAtEndOfInput();
+                    printf("Error: Invalid choice. Please enter a number between 0 and %d.\n", BERTH_TYPES + 1);
+                    clearInputBuffer();
+                    continue;
+                }
+                if (preference >= 1 && preference <= BERTH_TYPES && n > MAX_SEAT_RUNS)
+                {
+                    // No two berths of one type are side by side, so each is a block of its own
+                    printf("Error: Berths of one type are never next to each other, and a booking holds at most %d separate blocks of seats.\n", MAX_SEAT_RUNS);
+                    printf("Please choose Any for a group of %d, or book the group as smaller bookings.\n", n);
+                    continue;
+                }
+                break;
+            } while (1);
+            berthType = preference == 0 ? BERTH_ANY : preference - 1;
+            autoAssign = preference <= BERTH_TYPES;
+        }
+
+        int routeIndex = findRouteIndex(partial.booking.currentCityID, partial.booking.destinationCityID, partial.booking.modeID);
+        advanceSeatHolds();
+        int freeSeats = countFreeSeats(&seatMap->routes[routeIndex]);
+        if (n > freeSeats)
+        {
+            printf("Sorry, only %d seats are available on this route.\n", freeSeats);
+            int joinChoice;
+            printf("Do you want to join the waitlist? (1: Yes, 0: No): ");
+            if (scanf("%d", &joinChoice) == 1 && joinChoice == 1)
+            {
+                int requestID = joinWaitlist(&partial.booking, n, coachClass, berthType);
+                if (requestID >= 0)
+                {
+                    printf("You are on the waitlist. Request ID: %d\n", requestID);
+                }
+            }
+            clearInputBuffer();
+            partial.inProgress = false;
+            savePartialBooking(&partial);
+            return;
+        }
+        partial.booking.numTravelers = n;
+        partial.booking.bookedSeat = n;
+
+        if (partial.booking.modeID != MODE_TRAIN && n > 1)
+        {
+            do
+            {
+                printf("Auto-assign %d seats together? (1: Yes, 0: No): ", n);
+                if (scanf("%d", &autoAssign) != 1 || (autoAssign != 0 && autoAssign != 1))
+                {
+                    stopAtEndOfInput();
+                    printf("Invalid input. Please enter 1 for Yes or 0 for No.\n");
+                    clearInputBuffer();
+                    continue;
+                }
+                break;
+            } while (1);
+        }
+
+        int seats[MAX_TRAVELERS], seatHolds[MAX_TRAVELERS];
+        if (autoAssign == 1)
+        {
+            int fragments, held = 0;
+            for (int attempt = 0; attempt < 5; attempt++)
+            {
+                fragments = coachClass >= 0 ? autoAssignBerths(routeIndex, coachClass, berthType, n, seats)
+                                            : autoAssignSeats(routeIndex, n, seats);
+                while (fragments > 0 && held < n &&
+                       (seatHolds[held] = holdSeatRoute(partial.booking.currentCityID, partial.booking.destinationCityID, partial.booking.modeID, seats[held], SEAT_HOLD_TTL_SECONDS)) >= 0)
+                {
+                    held++;
+                }
+                if (fragments < 0 || held == n)
+                {
+                    break;
+                }
+                while (held > 0)
+                {
+                    releaseSeatHold(seatHolds[--held]); // Another counter took a seat, pick again
+                }
+            }
+            if (held < n)
+            {
+                if (fragments >= 0)
+                {
+                    printf("Sorry, the seats on this route were just taken at another counter.\n");
+                }
+                else if (coachClass >= 0)
+                {
+                    printf("Sorry, %d %s%sberths are not free together in %s on this train.\n", n,
+                           berthType == BERTH_ANY ? "" : berthCodes[berthType], berthType == BERTH_ANY ? "" : " ",
+                           coachClasses[coachClass].name);
+                }
+                else
+                {
+                    printf("Sorry, the free seats on this route are too scattered for one booking.\n");
+                }
+                partial.inProgress = false;
+                savePartialBooking(&partial);
+                return;
+            }
+            if (coachClass >= 0)
+            {
+                if (fragments > 1)
+                {
+                    printf("No coach has %d such berths free; your group is spread over %d coaches.\n", n, fragments);
+                }
+                for (int i = 0; i < n; i++)
+                {
+                    char berth[32];
+                    formatBerth(seats[i], berth, sizeof(berth));
+                    printf("Traveler %d: seat %d (%s)\n", i + 1, seats[i], berth);
+                }
+            }
+            else if (fragments > 1)
+            {
+                printf("No block of %d adjacent seats is free; your group is split into %d blocks.\n", n, fragments);
+            }
+        }
+        int capacity = seatMap->routes[routeIndex].capacity;
+        for (int i = 0; autoAssign == 0 && i < n; i++)
+        {
+            int seatNum;
+            displayAvailableSeats(partial.booking.currentCityID, partial.booking.destinationCityID, partial.booking.modeID); // Show available seats before booking
+            do
+            {
+                printf("Enter seat number for traveler %d: ", i + 1);
+                if (scanf("%d", &seatNum) != 1 || seatNum < 1 || seatNum > capacity || !isSeatAvailableForRoute(partial.booking.currentCityID, partial.booking.destinationCityID, partial.booking.modeID, seatNum))
+                {
+                    stopAtEndOfInput();
+                    printf("Error: Invalid or unavailable seat number. Please select an available seat (1-%d).\n", capacity);
+                    clearInputBuffer();
+                    continue;
+                }
+                seats[i] = seatNum;
+                if (countSeatRuns(seats, i + 1) > MAX_SEAT_RUNS)
+                {
+                    printf("Error: A booking holds at most %d separate blocks of seats. Please pick a seat next to the previous one.\n", MAX_SEAT_RUNS);
+                    clearInputBuffer();
+                    continue;
+                }
+                break;
+            } while (1);
+            seatHolds[i] = holdSeatRoute(partial.booking.currentCityID, partial.booking.destinationCityID, partial.booking.modeID, seatNum, SEAT_HOLD_TTL_SECONDS);
+            if (seatHolds[i] < 0)
+            {
+                printf("Sorry, seat %d was just taken at another counter.\n", seatNum);
+                i--; // Ask again for this traveler
+                continue;
+            }
+        }
+        setBookingSeats(&partial.booking, seats, n); // Both paths keep within MAX_SEAT_RUNS
+        printf("Your seats are held for %d minutes.\n", SEAT_HOLD_TTL_SECONDS / 60);
+
+        partial.booking.price = bookingFare(&partial.booking);
+
+        clearInputBuffer();
+        do
+        {
+            char promoChoice[4];
+            char enteredCode[20];
+            printf("Do you want to add Promo Code(yes or no) : ");
+            if (fgets(promoChoice, sizeof(promoChoice), stdin) == NULL)
+            {
+                stopAtEndOfInput();
+                printf("Error: Failed to read input. Please try again.\n");
+                continue;
+            }
+
+            // Remove newline character that fgets adds
+            promoChoice[strcspn(promoChoice, "\n")] = '\0';
+
+            struct PromoCode promoCodes[] = {{"CLUBGAMMA", 20}, {"CHARUSAT", 15}, {"HECTOBERFEST", 10}};
+            int numCodes = sizeof(promoCodes) / sizeof(promoCodes[0]);
+            int promoApplied = 0;
+            if (strcmp(promoChoice, "yes") == 0)
+            {
+                printf("Enter promotional code: ");
+                scanf("%s", enteredCode);
+                for (int i = 0; i < numCodes; i++)
+                {
+                    if (strcmp(enteredCode, promoCodes[i].code) == 0)
+                    {
+                        int discountAmount = partial.booking.price * (promoCodes[i].discount / 100.0);
+                        partial.booking.price -= discountAmount;
+                        printf("Promotional code applied! Discount: %d%%\n", promoCodes[i].discount);
+                        printf("New price after discount: %d\n", partial.booking.price);
+                        promoApplied = 1;
+                        break;
+                    }
+                }
+                if (!promoApplied)
+                {
+                    printf("Invalid promotional code.\n");
+                    continue;
+                }
+                break;
+            }
+            else if (strcmp(promoChoice, "no") == 0)
+            {
+                break;
+            }
+            else
+            {
+                printf("Invalid input. Please enter 'yes' or 'no'.\n");
+            }
+        } while (1);
+
+         
+        // Display summary before finalizing booking
+        printBookingSummary(&partial, n); // Improved summary display
+
+        char confirm[10];
+
+        printf("\n");
+        do
+        {
+            printf("Do you want to confirm this booking? (yes/no): ");
+            if (fgets(confirm, sizeof(confirm), stdin) == NULL)
+            {
+                stopAtEndOfInput();
+                printf("Error: Failed to read input. Please try again.\n");
+                continue; // Retry prompt in case of error
+            }
+
+            // Remove newline character that fgets adds
+            confirm[strcspn(confirm, "\n")] = '\0';
+
+            for (int i = 0; confirm[i]; i++)
+            {
+                confirm[i] = tolower(confirm[i]);
+            }
+
+            if (strcmp(confirm, "yes") == 0)
+            {
+                // Turn the held seats into bookings
+                bool confirmed[MAX_TRAVELERS];
+                bool holdsExpired = false;
+                for (int j = 0; j < n; j++)
+                {
+                    confirmed[j] = confirmSeatHold(seatHolds[j]);
+                    holdsExpired = holdsExpired || !confirmed[j];
+                }
+                if (holdsExpired)
+                {
+                    // Expired seats were already released; give back the rest
+                    for (int j = 0; j < n; j++)
+                    {
+                        if (confirmed[j])
+                        {
+                            freeSeatRoute(partial.booking.currentCityID, partial.booking.destinationCityID, partial.booking.modeID, seats[j]);
+                        }
+                    }
+                    printf("Your seat hold expired before the booking was confirmed. Please choose your seats again.\n");
+                    return;
+                }
+
+                int totalBookingPrice = partial.booking.price; 
+
+                 update_reedem_Points(partial.booking.name, partial.booking.price);
+                 int currentPoints = getPoints(partial.booking.name);
+                 printf("Your current Reedem points: %d\n", currentPoints);
+
+                 int pointsToRedeem;
+                 printf("Do you want to redeem Rddem points? (Enter points to redeem, 0 to skip): ");
+                 scanf("%d", &pointsToRedeem);
+                 clearInputBuffer();
+
+                 if (pointsToRedeem > currentPoints) {
+                 printf("Error: You cannot reedem more points than you have. Available points: %d\n", currentPoints);
+                 pointsToRedeem = 0; 
+               }
+
+                 if (pointsToRedeem > 0) {
+                      int redeemedPoints = RedeemPoints(partial.booking.name, pointsToRedeem);
+                           if (redeemedPoints > 0) {
+                                 partial.booking.price -= redeemedPoints * 100; 
+                                 printf("Reedem points redeemed successfully! New price: Rs. %d\n", partial.booking.price);
+                           } else {
+                                 printf("Insufficient Reedem points or error reedeming points.\n");
+                           }
+                }
+                
+                partial.booking.createdAt = currentTime();
+                sealBooking(&partial.booking);
+                if (!insertBooking(&partial.booking))
+                {
+                    printf("Error: Failed to write booking data. Please try again.\n");
+                }
+                else
+                {
+                    bookingAppended(&partial.booking);
+                    generateReferenceNumber(bookingReference, partial.booking.ticketID);
+                    recordFeedback(partial.booking.ticketID, partial.booking.name);
+                    printf("\nBooking added successfully!\n");
+
+                    const int width = 90;
+                    printf("\n");
+
+                    // Receipt
+                    printCentered("+----------------------------------------------+", 50);
+                    printCentered("|                   Receipt                    |", 50);
+                    printCentered("+----------------------------------------------+", 50);
+                    printf(" | Ticket ID: %-33d |\n", partial.booking.ticketID);
+                    printf(" | Name: %-38s |\n", partial.booking.name);
+                    printf(" | Current Location: %-26s |\n", cityName(partial.booking.currentCityID));
+                    printf(" | Destination: %-31s |\n", cityName(partial.booking.destinationCityID));
+                    printf(" | Number of Travelers: %-23d |\n", n);
+                    printf(" | Category: %-34s |\n", categoryName(partial.booking.categoryID));
+                    char travelDay[16];
+                    formatDay(partial.booking.travelDate / SECONDS_PER_DAY, travelDay, sizeof(travelDay));
+                    printf(" | Travel Date: %-31s |\n", travelDay);
+                    printf("| Seats Booked: ");
+                    for (int j = 0; j < n; j++)
+                    {
+                        printf("%d ", seats[j]);
+                    }
+                    printf("%lu |\n", (width - strlen("| Seats Booked: ") - (n * 2) - 1), ""); // Calculate space to keep in line
+                    printf(" | Price: Rs. %-32d  |\n", partial.booking.price);
+                    printCentered("+----------------------------------------------+", 50);
+                }
+                flushIOBackend();
+
+                // Clear partial booking
+                partial.inProgress = false;
+                savePartialBooking(&partial);
+                flushIOBackend();
+                break;
+            }
+            else if (strcmp(confirm, "no") == 0)
+            {
+
+                for (int j = 0; j < n; j++)
+                {
+                    releaseSeatHold(seatHolds[j]);
+                }
+                partial.inProgress = false;
+                savePartialBooking(&partial);
+                flushIOBackend();
+                printf("Booking cancelled. You can make changes or start over.\n");
+                return;
+            }
+            else
+            {
+                printf("Invalid input. Please enter 'yes' or 'no'.\n");
+            }
+
+        } while (1);
+    }
+}
+
+int getPoints(const char* userName) {
+    struct User user;
+    ioBackend->prepareRead(POINTS_FILENAME);
+    FILE *file = openDataFile(POINTS_FILENAME);
+    if (file == NULL) {
+        if (!createDataFile(POINTS_FILENAME)) {
+            printf("Error: Unable to create reedem points file.\n");
+        }
+        return 0;
+    }
+
+    while (readUser(file, &user)) {
+        if (strcmp(user.name, userName) == 0) {
+            fclose(file);
+            return user.points;
+        }
+    }
+
+    fclose(file);
+    return 0; 
+}
+
+// Finds userName in the points file. Returns the record offset, or -1 if absent.
+long findPointsRecord(const char* userName, struct User *user) {
+    ioBackend->prepareRead(POINTS_FILENAME);
+    FILE *file = openDataFile(POINTS_FILENAME);
+    if (file == NULL) {
+        return -1;
+    }
+
+    while (readUser(file, user)) {
+        if (strcmp(user->name, userName) == 0) {
+            long offset = ftell(file) - (long)sizeof(struct User);
+            fclose(file);
+            return offset;
+        }
+    }
+
+    fclose(file);
+    return -1;
+}
+
+// A change to one user's points, applied through ioBackend->update().
+struct PointsChange {
+    const char* name;
+    int delta;
+    bool clamp;   // Stop at zero rather than refuse the change
+    bool current; // The record still belonged to name
+    int total;
+};
+
+bool applyPointsChange(void* record, void* context) {
+    struct User* user = record;
+    struct PointsChange* change = context;
+    change->current = recordIntact(user, sizeof(struct User), offsetof(struct User, checksum)) &&
+                      strcmp(user->name, change->name) == 0;
+    if (!change->current || (!change->clamp && user->points + change->delta < 0)) {
+        return false;
+    }
+    user->points = user->points + change->delta < 0 ? 0 : user->points + change->delta;
+    sealUser(user);
+    change->total = user->points;
+    return true;
+}
+
+// Adds delta to userName's points and returns the new total. The record is
+// reread and rewritten through the I/O backend under a lock on just that
+// record, so counters updating the same user at once cannot lose each
+// other's changes. With create set a missing user gets a new record; that
+// append keeps the append lock across the second lookup, so it goes to the
+// file directly. Returns -1 if there is no record, the total would drop
+// below zero, or the file cannot be written.
+int adjustPoints(const char* userName, int delta, bool create) {
+    int total = -1;
+    struct PointsChange change = {userName, delta, false, false, -1};
+    struct User user;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        long offset = findPointsRecord(userName, &user);
+        if (offset < 0) {
+            if (!create || delta < 0) {
+                break;
+            }
+            int fd = open(POINTS_FILENAME, O_RDWR | O_CREAT, 0644);
+            if (!lockCurrentFile(&fd, POINTS_FILENAME, O_RDWR | O_CREAT, F_WRLCK, APPEND_LOCK_OFFSET, 1)) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+                break;
+            }
+            // Look again under the append lock so two counters cannot both create the user
+            if (findPointsRecord(userName, &user) >= 0) {
+                close(fd); // Releases the append lock
+                continue;
+            }
+            memset(&user, 0, sizeof(user));
+            strncpy(user.name, userName, MAX_NAME_LENGTH);
+            user.points = delta;
+            sealUser(&user);
+            if (appendLocked(&fd, POINTS_FILENAME, &user, sizeof(struct User))) { // Releases the append lock
+                total = user.points;
+            }
+            close(fd);
+            break;
+        }
+
+        if (ioBackend->update(POINTS_FILENAME, offset, sizeof(struct User), applyPointsChange, &change)) {
+            total = change.total;
+            break;
+        }
+        if (change.current) {
+            break; // Too few points, or the write failed
+        }
+        // A repair moved the record after we found it; look it up again
+    }
+    return total;
+}
+
+// Gives userName the points a booking of bookingPrice earns, creating the
+// user on their first. Returns the new total, 0 if the price earns none, or
+// -1 if the points file cannot be updated.
+int earnBookingPoints(const char* userName, int bookingPrice, bool* created) {
+    *created = false;
+    if (bookingPrice <= 1800) {
+        return 0;
+    }
+    int total = adjustPoints(userName, 10, false);
+    if (total < 0 && (total = adjustPoints(userName, 10, true)) >= 0) {
+        *created = true; // Start with 10 points for the first booking
+    }
+    return total;
+}
+
+void update_reedem_Points(const char* userName, int bookingPrice) {
+    bool created;
+    int total = earnBookingPoints(userName, bookingPrice, &created);
+    if (total > 0 && created) {
+        printf("New user created. Reedem points: %d\n", total);
+    } else if (total > 0) {
+        printf("Reedem points updated! New total: %d\n", total);
+    } else if (total < 0) {
+        printf("Error: Unable to update Reedem points file.\n");
+    } else {
+        printf("Booking price is not high enough to earn Reedem points.\n");
+    }
+}
+
+int RedeemPoints(const char* userName, int pointsToRedeem) {
+    // Fails when the user is unknown or does not have enough points
+    return adjustPoints(userName, -pointsToRedeem, false) >= 0 ? pointsToRedeem : 0;
+}
+
+void displayPoints(const char* userName) {
+    struct User user;
+    ioBackend->prepareRead(POINTS_FILENAME);
+    FILE *file = openDataFile(POINTS_FILENAME);
+    if (file == NULL) {
+        printf("Error: Unable to open Reedem points file.\n");
+        return;
+    }
+
+    while (readUser(file, &user)) {
+        if (strcmp(user.name, userName) == 0) {
+            printf("Your current Reedem points: %d\n", user.points);
+            fclose(file);
+            return;
+        }
+    }
+
+    fclose(file);
+    printf("No Reedem points found for this user.\n");
+}
+
+void displayBookings()
+{
+    int Transport_Choice;
+    while(1){
+        printf("\nSelect mode of transport:\n");
+        printf("1. Bus\n");
+        printf("2. Train\n");
+        printf("Enter your choice: ");
+
+        if (scanf("%d", &Transport_Choice) != 1 || (Transport_Choice < 1 || Transport_Choice > 2)) {
+            stopAtEndOfInput();
+            printf("Invalid choice. Please choose 1 for Bus or 2 for Train.\n");
+            clearInputBuffer();
+            continue;
+        }
+        clearInputBuffer();
+        printf("You selected: %s\n", Transport_Choice == 1 ? "Bus" : "Train");
+        break;
+    }
+    struct Booking booking;
+    prepareBookingsScan();
+    FILE *file = openDataFile(FILENAME);
+
+    if (file == NULL)
+    {
+        printf("No bookings found or error opening file.\n");
+        return;
+    }
+
+    // Adjusted header to include "Booked Seat"
+    printf("\n +----------------------------------------------------------------------------------------------------------+\n");
+    printf(" | %-10s %-20s %-20s %-20s %-10s %-6.5s %10s|\n", "Ticket ID", "Name", "Current Location", "Destination", "Booked Seat", "Price", "Mode");
+    printf(" +----------------------------------------------------------------------------------------------------------+\n");
+
+    // Read and display each booking entry
+    while (readBooking(file, &booking))
+    {
+        int bookedCount = bookingSeatCount(&booking); // Count how many seats were booked
+
+        // Display booking information
+        if(Transport_Choice==1){
+            if(booking.modeID == MODE_BUS){
+            printf(" | %-10d %-20s %-20s %-20s %-10d Rs.%4d %10s |\n",
+               booking.ticketID, booking.name, cityName(booking.currentCityID),
+               cityName(booking.destinationCityID), bookedCount, booking.price, modeName(booking.modeID));
+            }
+        }else{
+            if(booking.modeID == MODE_TRAIN){
+            printf(" | %-10d %-20s %-20s %-20s %-10d Rs.%4d %10s |\n",
+               booking.ticketID, booking.name, cityName(booking.currentCityID),
+               cityName(booking.destinationCityID), bookedCount, booking.price, modeName(booking.modeID));
+            }
+        }
+    }
+    printf(" +----------------------------------------------------------------------------------------------------------+\n");
+
+    // Check for any read errors
+    if (ferror(file))
+    {
+        printf("Error occurred while reading the file.\n");
+    }
+
+    fclose(file);
+}
+
+void searchNamesFuzzy()
+{
+    char name[MAX_NAME_LENGTH];
+    printf("Enter Name to search: ");
+    if (fgets(name, MAX_NAME_LENGTH, stdin) == NULL)
+    {
+        return;
+    }
+    name[strcspn(name, "\n")] = 0; // Remove newline
+
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    struct NameMatch matches[FUZZY_MATCHES];
+    int candidates;
+    int found = fuzzyFindNames(name, matches, FUZZY_MATCHES, &candidates);
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    if (found == 0)
+    {
+        printf("No booking found with the given criteria.\n");
+        return;
+    }
+    printf("\n+----------------------------------------------------+-------+---------------------------+\n");
+    printf("| %-50s | %-5s | %-25s |\n", "Name", "Edits", "Ticket IDs");
+    printf("+----------------------------------------------------+-------+---------------------------+\n");
+    for (int i = 0; i < found; i++)
+    {
+        const struct NameEntry *entry = &nameEntries[matches[i].nameID];
+        char tickets[64] = "";
+        int length = 0, shown = 0;
+        for (; shown < entry->tickets.count && shown < 3; shown++)
+        {
+            length += snprintf(tickets + length, sizeof(tickets) - length, shown ? " %d" : "%d", entry->tickets.items[shown]);
+        }
+        if (entry->tickets.count > shown)
+        {
+            snprintf(tickets + length, sizeof(tickets) - length, " +%d more", entry->tickets.count - shown);
+        }
+        printf("| %-50s | %-5d | %-25s |\n", entry->name, matches[i].distance, tickets);
+    }
+    printf("+----------------------------------------------------+-------+---------------------------+\n");
+    printf("%d candidate name(s) checked in %.2f ms.\n", candidates,
+           (finished.tv_sec - started.tv_sec) * 1000.0 + (finished.tv_nsec - started.tv_nsec) / 1e6);
+}
+
+void printFoundBooking(const struct Booking *booking)
+{
+    printf("\nBooking Found:\n");
+    printf("Ticket ID: %d\n", booking->ticketID);
+    printf("Name: %s\n", booking->name);
+    printf("Destination: %s\n", cityName(booking->destinationCityID));
+    printf("Category: %s\n", categoryName(booking->categoryID));
+    printf("Price: Rs. %d\n", booking->price);
+}
+
+void searchBookings()
+{
+    int searchChoice;
+    printf("\nSearch by:\n");
+    printf("1. Ticket ID\n");
+    printf("2. Name\n");
+    printf("3. Name (closest matches)\n");
+    printf("Enter your choice: ");
+    if (scanf("%d", &searchChoice) != 1)
+    {
+        printf("Error: Invalid input. Please enter a valid number.\n");
+        clearInputBuffer();
+        return;
+    }
+    clearInputBuffer();
+
+    if (searchChoice == 3)
+    {
+        searchNamesFuzzy();
+        return;
+    }
+    if ((searchChoice == 1 || searchChoice == 2) && searchBookingsIndexed(searchChoice))
+    {
+        return;
+    }
+
+    struct Booking booking;
+    prepareBookingsScan();
+    FILE *file = openDataFile(FILENAME);
+    if (file == NULL)
+    {
+        printf(" error opening file.\n");
+        return;
+    }
+
+    bool found = false;
+    if (searchChoice == 1)
+    {
+        int ticketID;
+        printf("Enter Ticket ID to search: ");
+        if (scanf("%d", &ticketID) != 1)
+        {
+            printf("Error: Invalid input.\n");
+            clearInputBuffer();
+            fclose(file);
+            return;
+        }
+        clearInputBuffer();
+
+        while (readBooking(file, &booking))
+        {
+            if (booking.ticketID == ticketID)
+            {
+                printFoundBooking(&booking);
+                found = true;
+            }
+        }
+    }
+    else if (searchChoice == 2)
+    {
+        char name[MAX_NAME_LENGTH];
+        printf("Enter Name to search: ");
+        fgets(name, MAX_NAME_LENGTH, stdin);
+        name[strcspn(name, "\n")] = 0; // Remove newline
+
+        while (readBooking(file, &booking))
+        {
+            if (strcasecmp(booking.name, name) == 0)
+            {
+                printFoundBooking(&booking);
+                found = true;
+            }
+        }
+    }
+    else
+    {
+        printf("Invalid choice.\n");
+        fclose(file);
+        return;
+    }
+
+    if (!found)
+    {
+        printf("No booking found with the given criteria.\n");
+    }
+
+    fclose(file);
+}
+
+// Whole-file loader: sizes a single arena with fstat() and fills it with a
+// few large reads, so callers get every booking as one contiguous array and
+// release it with one free.
+struct BookingArena
+{
+    struct Booking *records;
+    long count;
+};
+
+bool readBookingArena(int fd, struct BookingArena *arena)
+{
+    arena->records = NULL;
+    arena->count = 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        return false;
+    }
+    if (st.st_size > 0 && !dataHeaderCurrent(fd, FILENAME))
+    {
+        return false;
+    }
+    size_t size = recordCount(st.st_size, sizeof(struct Booking)) * sizeof(struct Booking); // Ignore a torn tail
+    arena->records = malloc(size > 0 ? size : 1);
+    if (arena->records == NULL)
+    {
+        return false;
+    }
+    size_t got = 0;
+    while (got < size)
+    {
+        ssize_t n = pread(fd, (char *)arena->records + got, size - got, DATA_HEADER_SIZE + got);
+        if (n <= 0)
+        {
+            break;
+        }
+        got += n;
+    }
+
+    arena->count = got / sizeof(struct Booking);
+    return true;
+}
+
+bool loadBookingArena(struct BookingArena *arena)
+{
+    ioBackend->prepareRead(FILENAME);
+    int fd = open(FILENAME, O_RDONLY);
+    if (fd < 0)
+    {
+        arena->records = NULL;
+        arena->count = 0;
+        return false;
+    }
+    bool loaded = readBookingArena(fd, arena);
+    close(fd);
+    return loaded;
+}
+
+void freeBookingArena(struct BookingArena *arena)
+{
+    free(arena->records);
+    arena->records = NULL;
+    arena->count = 0;
+}
+
+// Writes records to a temporary file in one go and swaps it in for bookings.dat.
+// Callers hold the compaction lock from lockBookingsFile().
+bool replaceBookingsFile(const struct Booking *records, long count)
+{
+    FILE *tempFile = fopen(FILENAME ".tmp", "wb");
+    if (tempFile == NULL)
+    {
+        return false;
+    }
+    bool success = writeDataHeader(tempFile, FILENAME) &&
+                   (count == 0 || fwrite(records, sizeof(struct Booking), count, tempFile) == (size_t)count);
+    if (fclose(tempFile) != 0 || !success)
+    {
+        remove(FILENAME ".tmp");
+        return false;
+    }
+    return rename(FILENAME ".tmp", FILENAME) == 0; // Replace original file with updated file
+}
+
+// Takes the compaction lock: an exclusive lock on all of bookings.dat,
+// including the append lock, so no other process appends or updates until
+// the returned descriptor is closed after the rewritten file is in place.
+int lockBookingsFile()
+{
+    ioBackend->prepareRead(FILENAME); // Our own queued appends would wait on the lock
+    return openLocked(FILENAME, O_RDWR, F_WRLCK, 0, 0);
+}
+
+// Modify and cancel are optimistic: the operator edits a copy of the booking
+// with nothing locked, and the change is only applied if the stored record
+// still carries the version the copy was read at. Otherwise the caller gets
+// the current record back and can show it and retry.
+enum BookingChangeResult
+{
+    BOOKING_CHANGED,
+    BOOKING_CONFLICT,     // Changed at another counter first
+    BOOKING_GONE,         // Cancelled at another counter
+    BOOKING_WRITE_FAILED
+};
+
+// Finds ticketID in bookings.dat. Returns the record offset, or -1 if absent.
+long findBookingRecord(int ticketID, struct Booking *booking)
+{
+    ioBackend->prepareRead(FILENAME);
+    FILE *file = openDataFile(FILENAME);
+    if (file == NULL)
+    {
+        return -1;
+    }
+    while (readBooking(file, booking))
+    {
+        if (booking->ticketID == ticketID)
+        {
+            long offset = ftell(file) - (long)sizeof(struct Booking);
+            fclose(file);
+            return offset;
+        }
+    }
+    fclose(file);
+    return -1;
+}
+
+// Writes updated in place of the booking with the same ticket ID if that is
+// still at expectedVersion, under a lock on just that record. *offset is
+// where the booking was last seen and follows it if a compaction moved it.
+// On a conflict the stored booking is copied to updated.
+int commitBookingChange(long *offset, unsigned int expectedVersion, struct Booking *updated)
+{
+    int fd = open(FILENAME, O_RDWR);
+    int result = BOOKING_WRITE_FAILED;
+    for (int attempt = 0; attempt < 3 && fd >= 0; attempt++)
+    {
+        if (!lockCurrentFile(&fd, FILENAME, O_RDWR, F_WRLCK, *offset, sizeof(struct Booking)))
+        {
+            break;
+        }
+        struct Booking current;
+        if (pread(fd, &current, sizeof(current), *offset) == sizeof(current) &&
+            bookingIntact(&current) && current.ticketID == updated->ticketID)
+        {
+            if (current.version != expectedVersion)
+            {
+                *updated = current;
+                result = BOOKING_CONFLICT;
+            }
+            else
+            {
+                updated->version = expectedVersion + 1;
+                sealBooking(updated);
+                result = pwriteAll(fd, updated, sizeof(*updated), *offset) ? BOOKING_CHANGED : BOOKING_WRITE_FAILED;
+            }
+            unlockRange(fd, *offset, sizeof(struct Booking));
+            break;
+        }
+        unlockRange(fd, *offset, sizeof(struct Booking));
+
+        // Another booking was cancelled and the file compacted; look again
+        if ((*offset = findBookingRecord(updated->ticketID, &current)) < 0)
+        {
+            result = BOOKING_GONE;
+            break;
+        }
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return result;
+}
+
+// Rewrites bookings.dat without the booking ticketID if it is still at
+// expectedVersion. The removed booking, or on a conflict the current one, is
+// copied to booking.
+int removeBookingRecord(int ticketID, unsigned int expectedVersion, struct Booking *booking)
+{
+    int fd = lockBookingsFile();
+    if (fd < 0)
+    {
+        return BOOKING_GONE; // No bookings file at all
+    }
+    struct BookingArena arena;
+    if (!readBookingArena(fd, &arena))
+    {
+        close(fd);
+        return BOOKING_WRITE_FAILED;
+    }
+
+    int result = BOOKING_GONE;
+    long kept = 0;
+    for (long i = 0; i < arena.count; i++)
+    {
+        if (result == BOOKING_GONE && arena.records[i].ticketID == ticketID && bookingIntact(&arena.records[i]))
+        {
+            *booking = arena.records[i];
+            if (booking->version != expectedVersion)
+            {
+                result = BOOKING_CONFLICT;
+                break;
+            }
+            result = BOOKING_CHANGED;
+            continue;
+        }
+        arena.records[kept++] = arena.records[i];
+    }
+    if (result == BOOKING_CHANGED && !replaceBookingsFile(arena.records, kept))
+    {
+        result = BOOKING_WRITE_FAILED;
+    }
+    freeBookingArena(&arena);
+    close(fd); // Release the lock only once the new file is in place
+    return result;
+}
+
+// Booking storage engines, chosen with BOOKING_ENGINE. The "file" engine
+// keeps bookings.dat as the store itself: new bookings are appended, modify
+// rewrites a record in place and cancel compacts the file. The "lsm" engine
+// keeps bookings in a log-structured merge tree under bookings.lsm/ and
+// regenerates bookings.dat from it as a read-only view whenever code that
+// scans all bookings needs it.
+struct BookingEngine
+{
+    const char *name;
+    bool logStructured; // Changes are small log records rather than file rewrites
+    bool (*insert)(struct Booking *booking); // May give the booking a new ticket ID
+    long (*find)(int ticketID, struct Booking *booking); // Returns a position for change(), or -1
+    int (*change)(long *position, unsigned int expectedVersion, struct Booking *updated);
+    int (*remove)(int ticketID, unsigned int expectedVersion, struct Booking *booking);
+    bool (*prepareScan)(void); // Brings bookings.dat up to date; true if it was regenerated
+};
+
+bool fileInsertBooking(struct Booking *booking)
+{
+    return ioBackend->append(FILENAME, booking, sizeof(*booking));
+}
+
+bool filePrepareScan(void)
+{
+    ioBackend->prepareRead(FILENAME);
+    return false;
+}
+
+// The LSM engine. Every change is appended to a write-ahead log and applied
+// to the memtable, a sorted in-memory table of the log's entries. A full
+// memtable is written out as an immutable run file sorted by ticket ID with
+// a bloom filter, and a new log is started. Runs from memtable flushes form
+// level 0; a background thread merges them into one run per deeper level,
+// each level LSM_LEVEL_RATIO times larger than the one above. A lookup
+// checks the memtable and then every run from newest to oldest, skipping
+// runs whose bloom filter rules the ticket out, and binary searches the rest.
+// Cancellations are tombstone entries, dropped when merged into the bottom
+// level.
+//
+// bookings.lsm/manifest lists the live runs and the current log. Processes
+// sharing the directory serialize every operation with a lock on byte 0 of
+// bookings.lsm/lock and catch up on the manifest and log first; byte 1
+// elects a single compactor.
+//   The manifest, every run and every log start with LSM_MAGIC and the
+// BOOKINGS_LAYOUT of the bookings their entries embed, so a store of
+// another layout is refused instead of misread. Stores from before that
+// ("LSM1") are converted by lsmUpgrade().
+#define LSM_MAGIC 0x324d534c     // "LSM2"
+#define LSM_OLD_MAGIC 0x314d534c // "LSM1"
+
+struct LsmEntry
+{
+    struct Booking booking; // Only the ticket ID is meaningful in a tombstone
+    int tombstone;
+    unsigned int checksum; // CRC32C of the entry, so a torn log tail is detected
+};
+
+struct LsmRunInfo
+{
+    unsigned long long id; // The run is bookings.lsm/run-<id>.dat
+    int level;
+    long long count;
+};
+
+struct LsmManifest
+{
+    unsigned int magic;
+    unsigned int layout; // BOOKINGS_LAYOUT of every entry in the store
+    int runCount;
+    unsigned long long generation; // Bumped whenever the set of runs changes
+    unsigned long long nextID;     // Next run or log file number
+    unsigned long long walID;      // The log is bookings.lsm/wal-<walID>.log
+    struct LsmRunInfo runs[LSM_MAX_RUNS]; // Newest first: level 0 newest to oldest, then levels 1, 2, ...
+};
+
+// A run file is this header, bloomWords bloom filter words and then count
+// entries sorted by ticket ID.
+struct LsmRunHeader
+{
+    unsigned int magic;
+    unsigned int layout;
+    unsigned int bloomWords;
+    long long count;
+};
+
+// A log is this header followed by entries.
+struct LsmLogHeader
+{
+    unsigned int magic;
+    unsigned int layout;
+};
+
+struct LsmRun
+{
+    unsigned long long id;
+    int level;
+    long long count;
+    void *mapped;
+    size_t mappedSize;
+    const unsigned long long *bloom;
+    unsigned int bloomWords;
+    const struct LsmEntry *entries;
+};
+
+// Identifies one state of the tree, and so one version of the bookings.dat view.
+struct LsmViewStamp
+{
+    unsigned long long generation;
+    unsigned long long walID;
+    long long walBytes;
+};
+
+struct LsmState
+{
+    int lockFd;
+    struct LsmManifest manifest; // As last read
+    struct LsmRun runs[LSM_MAX_RUNS];
+    int runCount;
+    unsigned long long walID; // Log the memtable holds
+    long long walApplied;     // Bytes of that log applied to the memtable
+    struct LsmEntry *memtable;
+    int *memtableOrder; // Indices into memtable, sorted by ticket ID
+    int memtableCount;
+    int memtableCapacity;
+    struct LsmViewStamp seenView; // bookings.dat as this process last read it
+} lsm = {.lockFd = -1};
+
+pthread_mutex_t lsmCompactionMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t lsmCompactionWanted = PTHREAD_COND_INITIALIZER;
+bool lsmCompactionRequested = false;
+
+void lsmFilePath(char *path, size_t size, const char *kind, unsigned long long id)
+{
+    snprintf(path, size, "%s/%s-%llu.%s", LSM_DIRECTORY, kind, id, strcmp(kind, "wal") == 0 ? "log" : "dat");
+}
+
+void sealLsmEntry(struct LsmEntry *entry)
+{
+    entry->checksum = recordChecksum(entry, sizeof(*entry), offsetof(struct LsmEntry, checksum));
+}
+
+// Bloom filter probes use double hashing over one 64-bit hash of the ticket.
+void lsmBloomAdd(unsigned long long *bloom, unsigned int words, int ticketID)
+{
+    unsigned long long hash = mixHash((unsigned int)ticketID);
+    unsigned long long step = (hash >> 32) | 1, bits = (unsigned long long)words * 64;
+    for (int i = 0; i < LSM_BLOOM_HASHES; i++, hash += step)
+    {
+        bloom[(hash % bits) / 64] |= 1ULL << (hash % bits % 64);
+    }
+}
+
+bool lsmBloomMayContain(const unsigned long long *bloom, unsigned int words, int ticketID)
+{
+    unsigned long long hash = mixHash((unsigned int)ticketID);
+    unsigned long long step = (hash >> 32) | 1, bits = (unsigned long long)words * 64;
+    for (int i = 0; i < LSM_BLOOM_HASHES; i++, hash += step)
+    {
+        if (!((bloom[(hash % bits) / 64] >> (hash % bits % 64)) & 1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned int lsmBloomWords(long long count)
+{
+    return (unsigned int)((count * LSM_BLOOM_BITS_PER_KEY + 63) / 64) + 1;
+}
+
+// Binary search; returns the index of ticketID or where it would be inserted.
+long long lsmSearchRun(const struct LsmRun *run, int ticketID)
+{
+    long long low = 0, high = run->count;
+    while (low < high)
+    {
+        long long mid = low + (high - low) / 2;
+        if (run->entries[mid].booking.ticketID < ticketID)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int lsmSearchMemtable(int ticketID)
+{
+    int low = 0, high = lsm.memtableCount;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (lsm.memtable[lsm.memtableOrder[mid]].booking.ticketID < ticketID)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool lsmMemtablePut(const struct LsmEntry *entry)
+{
+    int position = lsmSearchMemtable(entry->booking.ticketID);
+    if (position < lsm.memtableCount && lsm.memtable[lsm.memtableOrder[position]].booking.ticketID == entry->booking.ticketID)
+    {
+        lsm.memtable[lsm.memtableOrder[position]] = *entry; // Newer entry for the same ticket
+        return true;
+    }
+    if (lsm.memtableCount == lsm.memtableCapacity)
+    {
+        int capacity = lsm.memtableCapacity ? lsm.memtableCapacity * 2 : LSM_MEMTABLE_RECORDS;
+        struct LsmEntry *entries = realloc(lsm.memtable, capacity * sizeof(struct LsmEntry));
+        int *order = entries != NULL ? realloc(lsm.memtableOrder, capacity * sizeof(int)) : NULL;
+        if (entries != NULL)
+        {
+            lsm.memtable = entries;
+        }
+        if (order == NULL)
+        {
+            return false;
+        }
+        lsm.memtableOrder = order;
+        lsm.memtableCapacity = capacity;
+    }
+    lsm.memtable[lsm.memtableCount] = *entry;
+    memmove(&lsm.memtableOrder[position + 1], &lsm.memtableOrder[position], (lsm.memtableCount - position) * sizeof(int));
+    lsm.memtableOrder[position] = lsm.memtableCount++;
+    return true;
+}
+
+bool lsmReadManifest(struct LsmManifest *manifest)
+{
+    int fd = open(LSM_DIRECTORY "/manifest", O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool valid = pread(fd, manifest, sizeof(*manifest), 0) == sizeof(*manifest) && manifest->magic == LSM_MAGIC &&
+                 manifest->layout == BOOKINGS_LAYOUT && manifest->runCount >= 0 && manifest->runCount <= LSM_MAX_RUNS;
+    close(fd);
+    return valid;
+}
+
+// Replaces the manifest atomically. Callers hold the operation lock.
+bool lsmWriteManifest(const struct LsmManifest *manifest)
+{
+    int fd = open(LSM_DIRECTORY "/manifest.tmp", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool written = pwriteAll(fd, manifest, sizeof(*manifest), 0);
+    close(fd);
+    return written && rename(LSM_DIRECTORY "/manifest.tmp", LSM_DIRECTORY "/manifest") == 0;
+}
+
+bool lsmMapRun(struct LsmRun *run, const struct LsmRunInfo *info)
+{
+    char path[64];
+    lsmFilePath(path, sizeof(path), "run", info->id);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    void *mapped = fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(struct LsmRunHeader)
+                       ? mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)
+                       : MAP_FAILED;
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        return false;
+    }
+    const struct LsmRunHeader *header = mapped;
+    size_t expected = sizeof(*header) + header->bloomWords * sizeof(unsigned long long) + header->count * sizeof(struct LsmEntry);
+    if (header->magic != LSM_MAGIC || header->layout != BOOKINGS_LAYOUT || expected != (size_t)st.st_size)
+    {
+        munmap(mapped, st.st_size);
+        return false;
+    }
+    run->id = info->id;
+    run->level = info->level;
+    run->count = header->count;
+    run->mapped = mapped;
+    run->mappedSize = st.st_size;
+    run->bloomWords = header->bloomWords;
+    run->bloom = (const unsigned long long *)(header + 1);
+    run->entries = (const struct LsmEntry *)(run->bloom + header->bloomWords);
+    return true;
+}
+
+// Catches this process up with the tree: maps runs added by flushes and
+// compactions, drops merged ones and applies log entries written since the
+// last call. Callers hold the operation lock.
+bool lsmRefresh()
+{
+    struct LsmManifest manifest;
+    if (!lsmReadManifest(&manifest))
+    {
+        return false;
+    }
+    if (manifest.generation != lsm.manifest.generation) // Generations start at 1
+    {
+        struct LsmRun runs[LSM_MAX_RUNS];
+        int count = 0;
+        bool kept[LSM_MAX_RUNS] = {false};
+        for (int i = 0; i < manifest.runCount; i++)
+        {
+            int existing = 0;
+            while (existing < lsm.runCount && lsm.runs[existing].id != manifest.runs[i].id)
+            {
+                existing++;
+            }
+            if (existing < lsm.runCount)
+            {
+                runs[count] = lsm.runs[existing];
+                runs[count++].level = manifest.runs[i].level;
+                kept[existing] = true;
+            }
+            else if (lsmMapRun(&runs[count], &manifest.runs[i]))
+            {
+                count++;
+            }
+            else
+            {
+                printf("Warning: Booking run %llu is missing or damaged.\n", manifest.runs[i].id);
+            }
+        }
+        for (int i = 0; i < lsm.runCount; i++)
+        {
+            if (!kept[i])
+            {
+                munmap(lsm.runs[i].mapped, lsm.runs[i].mappedSize);
+            }
+        }
+        memcpy(lsm.runs, runs, count * sizeof(struct LsmRun));
+        lsm.runCount = count;
+    }
+    lsm.manifest = manifest;
+    lsm.manifest.runCount = lsm.runCount;
+
+    if (manifest.walID != lsm.walID)
+    {
+        lsm.walID = manifest.walID; // The memtable was flushed; start on the new log
+        lsm.walApplied = 0;
+        lsm.memtableCount = 0;
+    }
+    char path[64];
+    lsmFilePath(path, sizeof(path), "wal", lsm.walID);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return true; // Nothing logged yet
+    }
+    if (lsm.walApplied == 0)
+    {
+        struct LsmLogHeader header;
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header))
+        {
+            close(fd);
+            return true; // Torn before the first entry
+        }
+        if (header.magic != LSM_MAGIC || header.layout != BOOKINGS_LAYOUT)
+        {
+            close(fd);
+            printf("Warning: Booking log %s is not in the layout this version reads.\n", path);
+            return false;
+        }
+        lsm.walApplied = sizeof(header);
+    }
+    struct LsmEntry entry;
+    while (pread(fd, &entry, sizeof(entry), lsm.walApplied) == sizeof(entry) &&
+           recordIntact(&entry, sizeof(entry), offsetof(struct LsmEntry, checksum)))
+    {
+        if (!lsmMemtablePut(&entry))
+        {
+            break;
+        }
+        lsm.walApplied += sizeof(entry);
+    }
+    close(fd);
+    return true;
+}
+
+bool lsmLock()
+{
+    if (!lockRange(lsm.lockFd, F_WRLCK, 0, 1))
+    {
+        return false;
+    }
+    if (!lsmRefresh())
+    {
+        unlockRange(lsm.lockFd, 0, 1);
+        return false;
+    }
+    return true;
+}
+
+void lsmUnlock()
+{
+    unlockRange(lsm.lockFd, 0, 1);
+}
+
+// Finds the newest entry for ticketID, which may be a tombstone.
+bool lsmGet(int ticketID, struct LsmEntry *entry)
+{
+    int position = lsmSearchMemtable(ticketID);
+    if (position < lsm.memtableCount && lsm.memtable[lsm.memtableOrder[position]].booking.ticketID == ticketID)
+    {
+        *entry = lsm.memtable[lsm.memtableOrder[position]];
+        return true;
+    }
+    for (int r = 0; r < lsm.runCount; r++)
+    {
+        const struct LsmRun *run = &lsm.runs[r];
+        if (!lsmBloomMayContain(run->bloom, run->bloomWords, ticketID))
+        {
+            continue;
+        }
+        long long index = lsmSearchRun(run, ticketID);
+        if (index < run->count && run->entries[index].booking.ticketID == ticketID)
+        {
+            *entry = run->entries[index];
+            return true;
+        }
+    }
+    return false;
+}
+
+// A run file being written: entries go after room for a bloom filter sized
+// for at most capacity keys, and the header and filter are written last.
+struct LsmRunWriter
+{
+    FILE *file;
+    unsigned long long *bloom;
+    unsigned int bloomWords;
+    long long count;
+    bool dropTombstones; // Set when writing the bottom level
+};
+
+bool lsmBeginRun(struct LsmRunWriter *writer, const char *path, long long capacity, bool dropTombstones)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->bloomWords = lsmBloomWords(capacity);
+    writer->bloom = calloc(writer->bloomWords, sizeof(unsigned long long));
+    writer->file = writer->bloom != NULL ? fopen(path, "wb") : NULL;
+    writer->dropTombstones = dropTombstones;
+    if (writer->file == NULL ||
+        fseek(writer->file, sizeof(struct LsmRunHeader) + writer->bloomWords * sizeof(unsigned long long), SEEK_SET) != 0)
+    {
+        free(writer->bloom);
+        if (writer->file != NULL)
+        {
+            fclose(writer->file);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool lsmRunWriterAdd(const struct LsmEntry *entry, void *context)
+{
+    struct LsmRunWriter *writer = context;
+    if (entry->tombstone && writer->dropTombstones)
+    {
+        return true;
+    }
+    lsmBloomAdd(writer->bloom, writer->bloomWords, entry->booking.ticketID);
+    writer->count++;
+    return fwrite(entry, sizeof(*entry), 1, writer->file) == 1;
+}
+
+bool lsmFinishRun(struct LsmRunWriter *writer)
+{
+    struct LsmRunHeader header = {.magic = LSM_MAGIC, .layout = BOOKINGS_LAYOUT, .bloomWords = writer->bloomWords, .count = writer->count};
+    bool written = fseek(writer->file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, writer->file) == 1 &&
+                   fwrite(writer->bloom, sizeof(unsigned long long), writer->bloomWords, writer->file) == writer->bloomWords;
+    free(writer->bloom);
+    return fclose(writer->file) == 0 && written;
+}
+
+// One sorted input to a merge: entries, read through order when it is set.
+struct LsmCursor
+{
+    const struct LsmEntry *entries;
+    const int *order;
+    long long count;
+    long long next;
+};
+
+const struct LsmEntry *lsmCursorHead(const struct LsmCursor *cursor)
+{
+    if (cursor->next >= cursor->count)
+    {
+        return NULL;
+    }
+    return &cursor->entries[cursor->order != NULL ? cursor->order[cursor->next] : cursor->next];
+}
+
+// Walks sources (newest first) in ticket ID order and hands emit() the
+// newest entry for each ticket. Stops early if emit() fails.
+bool lsmMerge(struct LsmCursor *sources, int count, bool (*emit)(const struct LsmEntry *entry, void *context), void *context)
+{
+    while (1)
+    {
+        const struct LsmEntry *newest = NULL;
+        for (int i = 0; i < count; i++)
+        {
+            const struct LsmEntry *head = lsmCursorHead(&sources[i]);
+            if (head != NULL && (newest == NULL || head->booking.ticketID < newest->booking.ticketID))
+            {
+                newest = head; // Ties keep the earlier, newer source
+            }
+        }
+        if (newest == NULL)
+        {
+            return true;
+        }
+        struct LsmEntry entry = *newest;
+        for (int i = 0; i < count; i++)
+        {
+            const struct LsmEntry *head = lsmCursorHead(&sources[i]);
+            if (head != NULL && head->booking.ticketID == entry.booking.ticketID)
+            {
+                sources[i].next++;
+            }
+        }
+        if (!emit(&entry, context))
+        {
+            return false;
+        }
+    }
+}
+
+void lsmRequestCompaction()
+{
+    pthread_mutex_lock(&lsmCompactionMutex);
+    lsmCompactionRequested = true;
+    pthread_cond_signal(&lsmCompactionWanted);
+    pthread_mutex_unlock(&lsmCompactionMutex);
+}
+
+// Writes the memtable out as a new level-0 run and starts a new log.
+// Callers hold the operation lock.
+bool lsmFlushMemtable()
+{
+    struct LsmManifest manifest = lsm.manifest;
+    if (manifest.runCount == LSM_MAX_RUNS)
+    {
+        lsmRequestCompaction(); // Keep logging until compaction frees a slot
+        return false;
+    }
+
+    unsigned long long runID = manifest.nextID++;
+    char path[64];
+    lsmFilePath(path, sizeof(path), "run", runID);
+    struct LsmRunWriter writer;
+    struct LsmCursor memtable = {lsm.memtable, lsm.memtableOrder, lsm.memtableCount, 0};
+    if (!lsmBeginRun(&writer, path, lsm.memtableCount, false))
+    {
+        return false;
+    }
+    if (!lsmMerge(&memtable, 1, lsmRunWriterAdd, &writer) || !lsmFinishRun(&writer))
+    {
+        remove(path);
+        return false;
+    }
+
+    memmove(&manifest.runs[1], &manifest.runs[0], manifest.runCount * sizeof(struct LsmRunInfo));
+    manifest.runs[0].id = runID;
+    manifest.runs[0].level = 0;
+    manifest.runs[0].count = writer.count;
+    manifest.runCount++;
+    unsigned long long oldWal = manifest.walID;
+    manifest.walID = manifest.nextID++;
+    manifest.generation++;
+    if (!lsmWriteManifest(&manifest))
+    {
+        remove(path);
+        return false;
+    }
+    lsmFilePath(path, sizeof(path), "wal", oldWal);
+    remove(path);
+    lsmRefresh();
+    lsmRequestCompaction();
+    return true;
+}
+
+// Logs entry and applies it to the memtable. Callers hold the operation lock.
+bool lsmWrite(struct LsmEntry *entry)
+{
+    sealLsmEntry(entry);
+    char path[64];
+    lsmFilePath(path, sizeof(path), "wal", lsm.walID);
+    int fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    // Writing at the applied length, not O_APPEND, overwrites a torn entry
+    // left by a counter that died mid-write. A new log gets its header first.
+    struct LsmLogHeader header = {LSM_MAGIC, BOOKINGS_LAYOUT};
+    long long offset = lsm.walApplied > 0 ? lsm.walApplied : (long long)sizeof(header);
+    bool written = (lsm.walApplied > 0 || pwriteAll(fd, &header, sizeof(header), 0)) &&
+                   pwriteAll(fd, entry, sizeof(*entry), offset) && ftruncate(fd, offset + sizeof(*entry)) == 0;
+    close(fd);
+    if (!written || !lsmMemtablePut(entry))
+    {
+        return false;
+    }
+    lsm.walApplied = offset + sizeof(*entry);
+    if (lsm.memtableCount >= LSM_MEMTABLE_RECORDS)
+    {
+        lsmFlushMemtable();
+    }
+    return true;
+}
+
+bool lsmInsertBooking(struct Booking *booking)
+{
+    if (!lsmLock())
+    {
+        return false;
+    }
+    // Ticket IDs are the key, so one that is already taken is drawn again
+    struct LsmEntry entry;
+    while (lsmGet(booking->ticketID, &entry) && !entry.tombstone)
+    {
+        booking->ticketID = unique_id();
+        sealBooking(booking);
+    }
+    memset(&entry, 0, sizeof(entry));
+    entry.booking = *booking;
+    bool written = lsmWrite(&entry);
+    lsmUnlock();
+    return written;
+}
+
+long lsmFindBooking(int ticketID, struct Booking *booking)
+{
+    if (!lsmLock())
+    {
+        return -1;
+    }
+    struct LsmEntry entry;
+    bool found = lsmGet(ticketID, &entry) && !entry.tombstone;
+    lsmUnlock();
+    if (found)
+    {
+        *booking = entry.booking;
+    }
+    return found ? 0 : -1;
+}
+
+int lsmChangeBooking(long *position, unsigned int expectedVersion, struct Booking *updated)
+{
+    (void)position; // Entries are found by ticket ID
+    if (!lsmLock())
+    {
+        return BOOKING_WRITE_FAILED;
+    }
+    struct LsmEntry entry;
+    int result;
+    if (!lsmGet(updated->ticketID, &entry) || entry.tombstone)
+    {
+        result = BOOKING_GONE;
+    }
+    else if (entry.booking.version != expectedVersion)
+    {
+        *updated = entry.booking;
+        result = BOOKING_CONFLICT;
+    }
+    else
+    {
+        updated->version = expectedVersion + 1;
+        sealBooking(updated);
+        memset(&entry, 0, sizeof(entry));
+        entry.booking = *updated;
+        result = lsmWrite(&entry) ? BOOKING_CHANGED : BOOKING_WRITE_FAILED;
+    }
+    lsmUnlock();
+    return result;
+}
+
+int lsmRemoveBooking(int ticketID, unsigned int expectedVersion, struct Booking *booking)
+{
+    if (!lsmLock())
+    {
+        return BOOKING_WRITE_FAILED;
+    }
+    struct LsmEntry entry;
+    int result;
+    if (!lsmGet(ticketID, &entry) || entry.tombstone)
+    {
+        result = BOOKING_GONE;
+    }
+    else
+    {
+        *booking = entry.booking;
+        if (booking->version != expectedVersion)
+        {
+            result = BOOKING_CONFLICT;
+        }
+        else
+        {
+            memset(&entry, 0, sizeof(entry));
+            entry.booking.ticketID = ticketID;
+            entry.tombstone = 1;
+            result = lsmWrite(&entry) ? BOOKING_CHANGED : BOOKING_WRITE_FAILED;
+        }
+    }
+    lsmUnlock();
+    return result;
+}
+
+bool lsmViewWriterAdd(const struct LsmEntry *entry, void *context)
+{
+    return entry->tombstone || fwrite(&entry->booking, sizeof(struct Booking), 1, context) == 1;
+}
+
+// Regenerates bookings.dat, in ticket ID order, if the tree changed since
+// it was last written by any process.
+bool lsmPrepareScan(void)
+{
+    if (!lsmLock())
+    {
+        return false;
+    }
+    struct LsmViewStamp current = {lsm.manifest.generation, lsm.walID, lsm.walApplied}, written;
+    int fd = open(LSM_DIRECTORY "/view", O_RDONLY);
+    bool fresh = fd >= 0 && pread(fd, &written, sizeof(written), 0) == sizeof(written) &&
+                 memcmp(&written, &current, sizeof(current)) == 0 && access(FILENAME, F_OK) == 0;
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    if (!fresh)
+    {
+        struct LsmCursor sources[LSM_MAX_RUNS + 1];
+        sources[0] = (struct LsmCursor){lsm.memtable, lsm.memtableOrder, lsm.memtableCount, 0};
+        for (int r = 0; r < lsm.runCount; r++)
+        {
+            sources[r + 1] = (struct LsmCursor){lsm.runs[r].entries, NULL, lsm.runs[r].count, 0};
+        }
+        FILE *view = fopen(FILENAME ".tmp", "wb");
+        bool merged = view != NULL && writeDataHeader(view, FILENAME) && lsmMerge(sources, lsm.runCount + 1, lsmViewWriterAdd, view);
+        if (view != NULL && (fclose(view) != 0 || !merged || rename(FILENAME ".tmp", FILENAME) != 0))
+        {
+            remove(FILENAME ".tmp");
+            view = NULL;
+        }
+        fd = view != NULL ? open(LSM_DIRECTORY "/view", O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+        if (fd >= 0)
+        {
+            pwriteAll(fd, &current, sizeof(current), 0);
+            close(fd);
+        }
+        else
+        {
+            printf("Error: Unable to refresh %s from the booking store.\n", FILENAME);
+        }
+    }
+    lsmUnlock();
+
+    bool changed = memcmp(&lsm.seenView, &current, sizeof(current)) != 0;
+    lsm.seenView = current;
+    return changed;
+}
+
+// Merges one set of runs if a level is over its limit: all level-0 runs into
+// level 1 once there are LSM_LEVEL0_RUNS of them, or a deeper level into the
+// next once it holds LSM_LEVEL_RATIO times more than the level above may.
+// Runs on the compaction thread with its own lock descriptor; the operation
+// lock is only held to read the manifest and to install the result. That
+// needs locks per open file description: with per-process locks the thread
+// would walk past the operation lock its own process holds.
+bool lsmCompactOnce(int lockFd)
+{
+    if (!RANGE_LOCKS_PER_DESCRIPTION)
+    {
+        return false;
+    }
+    if (!tryLockRange(lockFd, F_WRLCK, 1, 1))
+    {
+        return false; // Another process is compacting
+    }
+    struct LsmManifest manifest;
+    lockRange(lockFd, F_WRLCK, 0, 1);
+    bool loaded = lsmReadManifest(&manifest);
+    unlockRange(lockFd, 0, 1);
+
+    long long levelSize[LSM_MAX_LEVELS] = {0};
+    int levelRuns[LSM_MAX_LEVELS] = {0}, deepest = 0;
+    for (int i = 0; loaded && i < manifest.runCount; i++)
+    {
+        levelSize[manifest.runs[i].level] += manifest.runs[i].count;
+        levelRuns[manifest.runs[i].level]++;
+        deepest = manifest.runs[i].level > deepest ? manifest.runs[i].level : deepest;
+    }
+    int from = -1;
+    long long limit = (long long)LSM_MEMTABLE_RECORDS * LSM_LEVEL0_RUNS;
+    if (levelRuns[0] >= LSM_LEVEL0_RUNS)
+    {
+        from = 0;
+    }
+    for (int level = 1; loaded && from < 0 && level < LSM_MAX_LEVELS - 1; level++, limit *= LSM_LEVEL_RATIO)
+    {
+        if (levelSize[level] > limit)
+        {
+            from = level;
+        }
+    }
+    if (from < 0)
+    {
+        unlockRange(lockFd, 1, 1);
+        return false;
+    }
+
+    // Inputs are the runs on levels from and from + 1, newest first
+    struct LsmRun inputs[LSM_MAX_RUNS];
+    struct LsmCursor sources[LSM_MAX_RUNS];
+    int inputCount = 0;
+    long long capacity = 0;
+    bool mapped = true;
+    for (int i = 0; i < manifest.runCount; i++)
+    {
+        if (manifest.runs[i].level == from || manifest.runs[i].level == from + 1)
+        {
+            if (!lsmMapRun(&inputs[inputCount], &manifest.runs[i]))
+            {
+                mapped = false;
+                break;
+            }
+            sources[inputCount] = (struct LsmCursor){inputs[inputCount].entries, NULL, inputs[inputCount].count, 0};
+            capacity += inputs[inputCount++].count;
+        }
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/compact-%d.tmp", LSM_DIRECTORY, (int)getpid());
+    struct LsmRunWriter writer;
+    bool merged = mapped && lsmBeginRun(&writer, path, capacity, from + 1 >= deepest);
+    if (merged)
+    {
+        merged = lsmMerge(sources, inputCount, lsmRunWriterAdd, &writer);
+        merged = lsmFinishRun(&writer) && merged;
+    }
+    for (int i = 0; i < inputCount; i++)
+    {
+        munmap(inputs[i].mapped, inputs[i].mappedSize);
+    }
+
+    // Install: flushes may have added level-0 runs meanwhile, so start from
+    // the current manifest and swap the inputs for the output
+    bool installed = false;
+    lockRange(lockFd, F_WRLCK, 0, 1);
+    if (merged && lsmReadManifest(&manifest))
+    {
+        unsigned long long outputID = manifest.nextID++;
+        char runPath[64];
+        lsmFilePath(runPath, sizeof(runPath), "run", outputID);
+        struct LsmRunInfo runs[LSM_MAX_RUNS], removed[LSM_MAX_RUNS];
+        int count = 0, removedCount = 0;
+        bool placed = false;
+        for (int i = 0; i < manifest.runCount; i++)
+        {
+            const struct LsmRunInfo *run = &manifest.runs[i];
+            if (!placed && run->level > from)
+            {
+                runs[count++] = (struct LsmRunInfo){outputID, from + 1, writer.count};
+                placed = true;
+            }
+            bool input = false;
+            for (int j = 0; j < inputCount && !input; j++)
+            {
+                input = inputs[j].id == run->id;
+            }
+            if (input)
+            {
+                removed[removedCount++] = *run;
+                continue;
+            }
+            runs[count++] = *run;
+        }
+        if (!placed)
+        {
+            runs[count++] = (struct LsmRunInfo){outputID, from + 1, writer.count};
+        }
+        memcpy(manifest.runs, runs, count * sizeof(struct LsmRunInfo));
+        manifest.runCount = count;
+        manifest.generation++;
+        if (rename(path, runPath) == 0 && lsmWriteManifest(&manifest))
+        {
+            installed = true;
+            for (int i = 0; i < removedCount; i++)
+            {
+                lsmFilePath(runPath, sizeof(runPath), "run", removed[i].id);
+                remove(runPath); // Processes that still map it keep their copy
+            }
+        }
+    }
+    unlockRange(lockFd, 0, 1);
+    if (!installed)
+    {
+        remove(path);
+    }
+    unlockRange(lockFd, 1, 1);
+    return installed;
+}
+
+void *lsmCompactionThread(void *unused)
+{
+    (void)unused;
+    int lockFd = open(LSM_DIRECTORY "/lock", O_RDWR); // Its own description, so its locks exclude ours
+    if (lockFd < 0)
+    {
+        return NULL;
+    }
+    while (1)
+    {
+        pthread_mutex_lock(&lsmCompactionMutex);
+        while (!lsmCompactionRequested)
+        {
+            pthread_cond_wait(&lsmCompactionWanted, &lsmCompactionMutex);
+        }
+        lsmCompactionRequested = false;
+        pthread_mutex_unlock(&lsmCompactionMutex);
+
+        while (lsmCompactOnce(lockFd))
+        {
+        }
+    }
+    return NULL;
+}
+
+int compareBookingTickets(const void *a, const void *b)
+{
+    int x = ((const struct Booking *)a)->ticketID, y = ((const struct Booking *)b)->ticketID;
+    return (x > y) - (x < y);
+}
+
+// Creates the tree on first use, importing bookings.dat as one level-1 run.
+// Bookings that share a ticket ID with an earlier one get a new ID, since
+// ticket IDs are the key. Callers hold the operation lock.
+bool lsmCreate()
+{
+    struct BookingArena arena;
+    if (!loadBookingArena(&arena) && arena.records == NULL)
+    {
+        arena.records = malloc(1); // No bookings yet
+    }
+    long count = 0;
+    for (long i = 0; i < arena.count; i++)
+    {
+        if (bookingIntact(&arena.records[i]))
+        {
+            arena.records[count++] = arena.records[i];
+        }
+    }
+    int renumbered = 0;
+    qsort(arena.records, count, sizeof(struct Booking), compareBookingTickets);
+    int nextTicketID = count > 0 ? arena.records[count - 1].ticketID + 1 : 0;
+    for (long i = 1; i < count; i++)
+    {
+        if (arena.records[i].ticketID == arena.records[i - 1].ticketID)
+        {
+            arena.records[i].ticketID = nextTicketID++; // Past every existing ID
+            sealBooking(&arena.records[i]);
+            renumbered++;
+        }
+    }
+    if (renumbered > 0)
+    {
+        qsort(arena.records, count, sizeof(struct Booking), compareBookingTickets);
+        printf("Note: %d booking(s) shared a ticket ID and were given new ones.\n", renumbered);
+    }
+
+    struct LsmManifest manifest;
+    memset(&manifest, 0, sizeof(manifest));
+    manifest.magic = LSM_MAGIC;
+    manifest.layout = BOOKINGS_LAYOUT;
+    manifest.generation = 1;
+    manifest.nextID = 1;
+    bool created = true;
+    if (count > 0)
+    {
+        char path[64];
+        lsmFilePath(path, sizeof(path), "run", manifest.nextID);
+        struct LsmRunWriter writer;
+        created = lsmBeginRun(&writer, path, count, true);
+        for (long i = 0; created && i < count; i++)
+        {
+            struct LsmEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.booking = arena.records[i];
+            sealLsmEntry(&entry);
+            created = lsmRunWriterAdd(&entry, &writer);
+        }
+        created = created && lsmFinishRun(&writer);
+        manifest.runs[0] = (struct LsmRunInfo){manifest.nextID++, 1, count};
+        manifest.runCount = 1;
+    }
+    manifest.walID = manifest.nextID++;
+    freeBookingArena(&arena);
+    return created && lsmWriteManifest(&manifest);
+}
+
+bool lsmOpen()
+{
+    if (!RANGE_LOCKS_PER_DESCRIPTION)
+    {
+        fprintf(stderr, "Error: %s needs open file description locks, which this system does not have.\n", LSM_DIRECTORY);
+        return false;
+    }
+    if (mkdir(LSM_DIRECTORY, 0755) != 0 && errno != EEXIST)
+    {
+        return false;
+    }
+    lsm.lockFd = open(LSM_DIRECTORY "/lock", O_RDWR | O_CREAT, 0644);
+    if (lsm.lockFd < 0 || !lockRange(lsm.lockFd, F_WRLCK, 0, 1))
+    {
+        return false;
+    }
+    struct LsmManifest manifest;
+    bool ready = lsmReadManifest(&manifest) || (access(LSM_DIRECTORY "/manifest", F_OK) != 0 ? lsmCreate() : lsmUpgrade());
+    ready = ready && lsmRefresh();
+    unlockRange(lsm.lockFd, 0, 1);
+    if (!ready)
+    {
+        return false;
+    }
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, lsmCompactionThread, NULL) == 0)
+    {
+        pthread_detach(tid);
+    }
+    lsmRequestCompaction(); // Pick up work left by a previous run
+    return true;
+}
+
+const struct BookingEngine fileEngine = {"file", false, fileInsertBooking, findBookingRecord, commitBookingChange, removeBookingRecord, filePrepareScan};
+const struct BookingEngine lsmEngine = {"lsm", true, lsmInsertBooking, lsmFindBooking, lsmChangeBooking, lsmRemoveBooking, lsmPrepareScan};
+const struct BookingEngine *bookingEngine = &fileEngine;
+
+// The engine belongs to the data directory, not the process: once
+// bookings.lsm has a manifest, bookings.dat is only a view of it, and a
+// process writing the view directly would lose its bookings at the next
+// regeneration. BOOKING_ENGINE only picks the engine for a new directory.
+// Returns false if the directory's engine cannot be used.
+bool selectBookingEngine()
+{
+    const char *choice = getenv(BOOKING_ENGINE_ENV);
+    bool recorded = access(LSM_DIRECTORY "/manifest", F_OK) == 0;
+    if (recorded && choice != NULL && strcmp(choice, lsmEngine.name) != 0)
+    {
+        fprintf(stderr, "Error: Bookings here are kept in %s, so %s=%s cannot be used.\n", LSM_DIRECTORY, BOOKING_ENGINE_ENV, choice);
+        return false;
+    }
+    if (!recorded && (choice == NULL || strcmp(choice, lsmEngine.name) != 0))
+    {
+        return true;
+    }
+    if (!lsmOpen())
+    {
+        if (recorded)
+        {
+            fprintf(stderr, "Error: Unable to open the booking store in %s.\n", LSM_DIRECTORY);
+            return false;
+        }
+        printf("Warning: Unable to open the booking store in %s, using %s directly.\n", LSM_DIRECTORY, FILENAME);
+        return true;
+    }
+    bookingEngine = &lsmEngine;
+    return true;
+}
+
+bool insertBooking(struct Booking *booking)
+{
+    return bookingEngine->insert(booking);
+}
+
+// Brings bookings.dat up to date for code that reads it directly. Returns
+// true if the engine regenerated it, which renumbers its records.
+bool prepareBookingsView()
+{
+    ioBackend->prepareRead(FILENAME);
+    if (!bookingEngine->prepareScan())
+    {
+        return false;
+    }
+    recordSeatMapSource(); // Regenerated from the same bookings the seats were taken for
+    return true;
+}
+
+void prepareBookingsScan()
+{
+    if (prepareBookingsView())
+    {
+        bookingsFileRewritten();
+    }
+}
+
+// Point lookups for storage engines that have them: the ticket ID directly,
+// or each ticket the name index lists for a name. Returns false if the
+// engine only supports scanning.
+bool searchBookingsIndexed(int searchChoice)
+{
+    if (!bookingEngine->logStructured)
+    {
+        return false;
+    }
+    struct Booking booking;
+    bool found = false;
+    if (searchChoice == 1)
+    {
+        int ticketID;
+        printf("Enter Ticket ID to search: ");
+        if (scanf("%d", &ticketID) != 1)
+        {
+            printf("Error: Invalid input.\n");
+            clearInputBuffer();
+            return true;
+        }
+        clearInputBuffer();
+        if (bookingEngine->find(ticketID, &booking) >= 0)
+        {
+            printFoundBooking(&booking);
+            found = true;
+        }
+    }
+    else
+    {
+        char name[MAX_NAME_LENGTH];
+        printf("Enter Name to search: ");
+        fgets(name, MAX_NAME_LENGTH, stdin);
+        name[strcspn(name, "\n")] = 0; // Remove newline
+        if (!nameIndexBuilt)
+        {
+            buildNameIndex();
+        }
+        int slot = nameSlotCount > 0 ? findNameSlot(name) : -1;
+        if (slot >= 0 && nameSlots[slot] != 0)
+        {
+            const struct IntList *tickets = &nameEntries[nameSlots[slot] - 1].tickets;
+            for (int i = 0; i < tickets->count; i++)
+            {
+                if (bookingEngine->find(tickets->items[i], &booking) >= 0)
+                {
+                    printFoundBooking(&booking);
+                    found = true;
+                }
+            }
+        }
+    }
+    if (!found)
+    {
+        printf("No booking found with the given criteria.\n");
+    }
+    return true;
+}
+
+// exit without save functionality
+void removeLastBooking()
+{
+    int fd = lockBookingsFile();
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return;
+    }
+
+    // Drop the last complete record (and anything torn after it)
+    long count = recordCount(st.st_size, sizeof(struct Booking));
+    struct Booking last;
+    if (count > 0 && pread(fd, &last, sizeof(last), recordOffset(count - 1, sizeof(struct Booking))) == sizeof(last) && bookingIntact(&last))
+    {
+        nameIndexRemove(last.name, last.ticketID);
+    }
+    if (count > 0 && ftruncate(fd, recordOffset(count - 1, sizeof(struct Booking))) != 0)
+    {
+        printf("Error: Unable to remove the last booking.\n");
+    }
+    close(fd);
+    bookingsFileRewritten();
+}
+
+void displayCities()
+{
+    printf("Available Cities:\n");
+    for (int i = 0; i < numCities; i++)
+    {
+        printf("%d. %s\n", i + 1, indianCities[i]);
+    }
+}
+
+bool cityExists(const char *name)
+{
+    return lookupName(CATALOG_CITY, name) >= 0;
+}
+
+int selectCity()
+{
+    int choice;
+
+    while (1)
+    {
+        printf("Please select a city (1-%d) or 0 to skip: ", numCities);
+        if (scanf("%d", &choice) != 1 || choice < 0 || choice > numCities)
+        {
+            stopAtEndOfInput();
+            printf("Error: Invalid input. Please enter a number between 0 and %d.\n", numCities);
+            clearInputBuffer();
+        }
+        else
+        {
+            break; // Valid input received
+        }
+    }
+
+    clearInputBuffer();
+    return choice;
+}
+
+// Journey planner. The cities form a complete graph with a Bus and a Train
+// edge for every ordered pair. A leg costs the fare of the city it leaves
+// from, as in fareFor(), and a pair is closed while its route has no free
+// seats. The JOURNEY_ITINERARIES cheapest itineraries of up to
+// JOURNEY_MAX_LEGS legs, never visiting a city twice, are kept for every
+// category, origin and destination, so a query is a table lookup. When a
+// route fills up or frees its first seat, only the origins whose tables can
+// change are rebuilt.
+struct Itinerary
+{
+    int fare; // Per traveller
+    int legs;
+    short cities[JOURNEY_MAX_LEGS + 1];
+    unsigned char modes[JOURNEY_MAX_LEGS];
+};
+
+struct ItineraryList
+{
+    int count;
+    struct Itinerary items[JOURNEY_ITINERARIES]; // Cheapest first
+};
+
+struct ItineraryList *journeyTables = NULL; // [category][origin][destination]
+bool *journeyEdgeOpen = NULL;               // [from][to]
+struct IntList *journeyEdgesUsed = NULL;    // [category][origin], legs in an origin's tables as sorted from * numCities + to
+int *journeyPrefixFare = NULL;              // [category][origin][city], cheapest with fewer than JOURNEY_MAX_LEGS legs
+int *journeyWorstFare = NULL;               // [category][origin], the fare a new itinerary must beat
+int journeyCategoryCount = 0;
+
+struct ItineraryList *journeyList(int category, int origin, int destination)
+{
+    return &journeyTables[((long)category * numCities + origin) * numCities + destination];
+}
+
+bool itineraryVisits(const struct Itinerary *itinerary, int city)
+{
+    for (int i = 0; i <= itinerary->legs; i++)
+    {
+        if (itinerary->cities[i] == city)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Inserts itinerary into list if it is among the cheapest. Equal fares keep
+// the itinerary with fewer legs first.
+void itineraryListOffer(struct ItineraryList *list, const struct Itinerary *itinerary)
+{
+    int at = list->count;
+    while (at > 0 && (list->items[at - 1].fare > itinerary->fare ||
+                      (list->items[at - 1].fare == itinerary->fare && list->items[at - 1].legs > itinerary->legs)))
+    {
+        at--;
+    }
+    if (at == JOURNEY_ITINERARIES)
+    {
+        return;
+    }
+    int last = list->count < JOURNEY_ITINERARIES ? list->count++ : JOURNEY_ITINERARIES - 1;
+    memmove(&list->items[at + 1], &list->items[at], (last - at) * sizeof(struct Itinerary));
+    list->items[at] = *itinerary;
+}
+
+
+// Recomputes every table for one origin, extending the cheapest itineraries
+// with l - 1 legs by one leg to get those with l legs.
+void rebuildJourneyRow(int category, int origin)
+{
+    struct ItineraryList *current = calloc(numCities, sizeof(struct ItineraryList));
+    struct ItineraryList *next = calloc(numCities, sizeof(struct ItineraryList));
+    if (current == NULL || next == NULL)
+    {
+        free(current);
+        free(next);
+        return;
+    }
+    struct ItineraryList *row = journeyList(category, origin, 0);
+    int *prefix = &journeyPrefixFare[((long)category * numCities + origin) * numCities];
+    memset(row, 0, numCities * sizeof(struct ItineraryList));
+    for (int city = 0; city < numCities; city++)
+    {
+        prefix[city] = INT_MAX;
+    }
+
+    current[origin].count = 1;
+    current[origin].items[0].cities[0] = origin;
+    for (int legs = 1; legs <= JOURNEY_MAX_LEGS; legs++)
+    {
+        memset(next, 0, numCities * sizeof(struct ItineraryList));
+        for (int from = 0; from < numCities; from++)
+        {
+            for (int i = 0; i < current[from].count; i++)
+            {
+                const struct Itinerary *path = &current[from].items[i];
+                for (int to = 0; to < numCities; to++)
+                {
+                    if (!journeyEdgeOpen[from * numCities + to] || itineraryVisits(path, to))
+                    {
+                        continue;
+                    }
+                    for (int mode = MODE_BUS; mode <= MODE_TRAIN; mode++)
+                    {
+                        int fare = fareFor(from, mode, category);
+                        if (fare <= 0)
+                        {
+                            continue;
+                        }
+                        struct Itinerary extended = *path;
+                        extended.fare += fare;
+                        extended.cities[legs] = to;
+                        extended.modes[legs - 1] = mode;
+                        extended.legs = legs;
+                        itineraryListOffer(&next[to], &extended);
+                        itineraryListOffer(&row[to], &extended);
+                        if (legs < JOURNEY_MAX_LEGS && extended.fare < prefix[to])
+                        {
+                            prefix[to] = extended.fare;
+                        }
+                    }
+                }
+            }
+        }
+        struct ItineraryList *swap = current;
+        current = next;
+        next = swap;
+    }
+    free(current);
+    free(next);
+
+    int worst = 0;
+    struct IntList *used = &journeyEdgesUsed[category * numCities + origin];
+    bool listed = true;
+    used->count = 0;
+    for (int to = 0; to < numCities; to++)
+    {
+        if (to == origin)
+        {
+            continue;
+        }
+        const struct ItineraryList *list = &row[to];
+        int last = list->count < JOURNEY_ITINERARIES ? INT_MAX : list->items[list->count - 1].fare;
+        if (last > worst)
+        {
+            worst = last;
+        }
+        for (int i = 0; i < list->count; i++)
+        {
+            for (int leg = 0; listed && leg < list->items[i].legs; leg++)
+            {
+                listed = intListAppend(used, list->items[i].cities[leg] * numCities + list->items[i].cities[leg + 1]);
+            }
+        }
+    }
+    if (listed)
+    {
+        qsort(used->items, used->count, sizeof(int), compareInts);
+        int kept = 0;
+        for (int i = 0; i < used->count; i++)
+        {
+            if (kept == 0 || used->items[kept - 1] != used->items[i])
+            {
+                used->items[kept++] = used->items[i];
+            }
+        }
+        used->count = kept;
+    }
+    else
+    {
+        used->count = -1; // Out of memory: treat every edge as used
+    }
+    journeyWorstFare[category * numCities + origin] = worst;
+}
+
+bool journeyRowUsesEdge(int category, int origin, int from, int to)
+{
+    const struct IntList *used = &journeyEdgesUsed[category * numCities + origin];
+    int edge = from * numCities + to;
+    return used->count < 0 || (used->count > 0 && bsearch(&edge, used->items, used->count, sizeof(int), compareInts) != NULL);
+}
+
+void freeJourneyTables()
+{
+    for (int i = 0; journeyEdgesUsed != NULL && i < journeyCategoryCount * numCities; i++)
+    {
+        free(journeyEdgesUsed[i].items);
+    }
+    free(journeyTables);
+    free(journeyEdgeOpen);
+    free(journeyEdgesUsed);
+    free(journeyPrefixFare);
+    free(journeyWorstFare);
+    journeyTables = NULL; // Leaves the planner off
+    journeyEdgeOpen = NULL;
+    journeyEdgesUsed = NULL;
+    journeyPrefixFare = NULL;
+    journeyWorstFare = NULL;
+}
+
+// An edge is open while the bus or the train between two cities has a free
+// seat; planJourney() checks the mode of each leg.
+bool journeyEdgeHasSeats(int from, int to)
+{
+    return freeSeatsOnRoute(from, to, MODE_BUS) > 0 || freeSeatsOnRoute(from, to, MODE_TRAIN) > 0;
+}
+
+// Must run after initializeSeats().
+bool buildJourneyTables()
+{
+    journeyCategoryCount = sizeof(ticketCategories) / sizeof(ticketCategories[0]);
+    long pairs = (long)numCities * numCities;
+    journeyTables = calloc(journeyCategoryCount * pairs, sizeof(struct ItineraryList));
+    journeyEdgeOpen = calloc(pairs, sizeof(bool));
+    journeyEdgesUsed = calloc(journeyCategoryCount * numCities, sizeof(struct IntList));
+    journeyPrefixFare = calloc(journeyCategoryCount * pairs, sizeof(int));
+    journeyWorstFare = calloc(journeyCategoryCount * numCities, sizeof(int));
+    if (journeyTables == NULL || journeyEdgeOpen == NULL || journeyEdgesUsed == NULL ||
+        journeyPrefixFare == NULL || journeyWorstFare == NULL)
+    {
+        freeJourneyTables();
+        return false;
+    }
+
+    for (int from = 0; from < numCities; from++)
+    {
+        for (int to = 0; to < numCities; to++)
+        {
+            journeyEdgeOpen[from * numCities + to] = from != to && journeyEdgeHasSeats(from, to);
+        }
+    }
+    for (int category = 0; category < journeyCategoryCount; category++)
+    {
+        for (int origin = 0; origin < numCities; origin++)
+        {
+            rebuildJourneyRow(category, origin);
+        }
+    }
+    return true;
+}
+
+// Called whenever seats on route are booked or freed. Closing a route only
+// affects origins that use it; opening one only affects origins that can
+// reach its start cheaply enough to beat one of their current itineraries.
+void journeyRouteChanged(const struct Routs *route)
+{
+    int from = route->currentCityID, to = route->destinationCityID;
+    if (journeyTables == NULL || from < 0 || from >= numCities || to < 0 || to >= numCities || from == to)
+    {
+        return;
+    }
+    bool open = journeyEdgeHasSeats(from, to);
+    if (journeyEdgeOpen[from * numCities + to] == open)
+    {
+        return;
+    }
+    journeyEdgeOpen[from * numCities + to] = open;
+
+    for (int category = 0; category < journeyCategoryCount; category++)
+    {
+        int legFare = INT_MAX;
+        for (int mode = MODE_BUS; mode <= MODE_TRAIN; mode++)
+        {
+            int fare = fareFor(from, mode, category);
+            if (fare > 0 && fare < legFare)
+            {
+                legFare = fare;
+            }
+        }
+        for (int origin = 0; origin < numCities; origin++)
+        {
+            long row = (long)category * numCities + origin;
+            bool rebuild;
+            if (!open)
+            {
+                rebuild = journeyRowUsesEdge(category, origin, from, to);
+            }
+            else
+            {
+                int reach = origin == from ? 0 : journeyPrefixFare[row * numCities + from];
+                rebuild = reach != INT_MAX && legFare != INT_MAX && reach + legFare <= journeyWorstFare[row];
+            }
+            if (rebuild)
+            {
+                rebuildJourneyRow(category, origin);
+            }
+        }
+    }
+}
+
+// Copies the precomputed itineraries from origin to destination that still
+// have seats for every traveller on each leg. Returns how many were copied.
+int planJourney(int origin, int destination, int category, int travelers, struct Itinerary *out)
+{
+    if (journeyTables == NULL || origin == destination)
+    {
+        return 0;
+    }
+    int routes = __atomic_load_n(&seatMap->routeCount, __ATOMIC_ACQUIRE);
+    for (int r = 0; r < routes; r++)
+    {
+        journeyRouteChanged(&seatMap->routes[r]); // Picks up routes other processes filled or freed
+    }
+    const struct ItineraryList *list = journeyList(category, origin, destination);
+    int found = 0;
+    for (int i = 0; i < list->count; i++)
+    {
+        const struct Itinerary *itinerary = &list->items[i];
+        bool fits = true;
+        for (int leg = 0; fits && leg < itinerary->legs; leg++)
+        {
+            fits = freeSeatsOnRoute(itinerary->cities[leg], itinerary->cities[leg + 1], itinerary->modes[leg]) >= travelers;
+        }
+        if (fits)
+        {
+            out[found++] = *itinerary;
+        }
+    }
+    return found;
+}
+
+void journeyPlanner()
+{
+    displayCities();
+    printf("From: ");
+    int origin = selectCity();
+    printf("To: ");
+    int destination = selectCity();
+    if (origin == 0 || destination == 0 || origin == destination)
+    {
+        printf("Please select two different cities.\n");
+        return;
+    }
+
+    int numCategories = sizeof(ticketCategories) / sizeof(ticketCategories[0]);
+    int categoryChoice;
+    do
+    {
+        printf("Category (");
+        for (int i = 0; i < numCategories; i++)
+        {
+            printf(i ? ", %d: %s" : "%d: %s", i + 1, ticketCategories[i]);
+        }
+        printf("): ");
+        if (scanf("%d", &categoryChoice) != 1 || categoryChoice < 1 || categoryChoice > numCategories)
+        {
+            stopAtEndOfInput();
+            printf("Invalid choice. Please enter a number between 1 and %d.\n", numCategories);
+            clearInputBuffer();
+            continue;
+        }
+        break;
+    } while (1);
+
+    int travelers;
+    do
+    {
+        printf("Number of travelers: ");
+        if (scanf("%d", &travelers) != 1 || travelers < 1 || travelers > MAX_TRAVELERS)
+        {
+            stopAtEndOfInput();
+            printf("Invalid number. Please enter between 1 and %d.\n", MAX_TRAVELERS);
+            clearInputBuffer();
+            continue;
+        }
+        break;
+    } while (1);
+    clearInputBuffer();
+
+    advanceSeatHolds();
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    struct Itinerary itineraries[JOURNEY_ITINERARIES];
+    int found = planJourney(origin - 1, destination - 1, categoryChoice - 1, travelers, itineraries);
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    if (found == 0)
+    {
+        printf("No itinerary with %d free seat(s) on every leg.\n", travelers);
+        return;
+    }
+    printf("\n+----+------------------------------------------------------------------+------+------------+\n");
+    printf("| %-2s | %-64s | %-4s | %-10s |\n", "#", "Itinerary", "Legs", "Total Fare");
+    printf("+----+------------------------------------------------------------------+------+------------+\n");
+    for (int i = 0; i < found; i++)
+    {
+        char route[128];
+        int length = snprintf(route, sizeof(route), "%s", cityName(itineraries[i].cities[0]));
+        for (int leg = 0; leg < itineraries[i].legs; leg++)
+        {
+            length += snprintf(route + length, sizeof(route) - length, " -%s-> %s",
+                               modeName(itineraries[i].modes[leg]), cityName(itineraries[i].cities[leg + 1]));
+        }
+        printf("| %-2d | %-64s | %-4d | Rs. %-6d |\n", i + 1, route, itineraries[i].legs, itineraries[i].fare * travelers);
+    }
+    printf("+----+------------------------------------------------------------------+------+------------+\n");
+    printf("Found in %.1f us. Book each leg with Add/Resume Booking.\n",
+           (finished.tv_sec - started.tv_sec) * 1e6 + (finished.tv_nsec - started.tv_nsec) / 1e3);
+}
+
+void printRouteAvailabilityRow(int currentCityID, int destinationCityID, int modeID, int freeSeats)
+{
+    printf("| %-20s | %-20s | %-6s | %-10d |\n", cityName(currentCityID), cityName(destinationCityID), modeName(modeID), freeSeats);
+}
+
+// Answers availability questions across routes from the free-count buckets.
+// City pairs nobody has booked yet have every seat free and are listed too.
+void searchAvailability()
+{
+    int choice;
+    do
+    {
+        printf("\n1. Routes with at least N free seats\n");
+        printf("2. Sold-out routes\n");
+        printf("Enter your choice: ");
+        if (scanf("%d", &choice) != 1 || choice < 1 || choice > 2)
+        {
+            stopAtEndOfInput();
+            printf("Invalid choice. Please enter 1 or 2.\n");
+            clearInputBuffer();
+            continue;
+        }
+        break;
+    } while (1);
+    clearInputBuffer();
+
+    int origin = -1, minFree = 0, maxFree = 0;
+    if (choice == 1)
+    {
+        displayCities();
+        printf("From (0 for any): ");
+        origin = selectCity() - 1;
+        do
+        {
+            printf("Minimum free seats: ");
+            if (scanf("%d", &minFree) != 1 || minFree < 1 || minFree > MAX_ROUTE_SEATS)
+            {
+                stopAtEndOfInput();
+                printf("Invalid number. Please enter between 1 and %d.\n", MAX_ROUTE_SEATS);
+                clearInputBuffer();
+                continue;
+            }
+            break;
+        } while (1);
+        clearInputBuffer();
+        maxFree = MAX_ROUTE_SEATS;
+    }
+
+    advanceSeatHolds();
+    int *routes;
+    int found = findRoutesByFreeSeats(origin, minFree, maxFree, &routes);
+    if (found < 0)
+    {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    printf("\n+----------------------+----------------------+--------+------------+\n");
+    printf("| %-20s | %-20s | %-6s | %-10s |\n", "From", "To", "Mode", "Free Seats");
+    printf("+----------------------+----------------------+--------+------------+\n");
+    for (int i = 0; i < found; i++)
+    {
+        const struct Routs *route = &seatMap->routes[routes[i]];
+        printRouteAvailabilityRow(route->currentCityID, route->destinationCityID, route->modeID, route->freeCount);
+    }
+    if (choice == 1)
+    {
+        for (int from = 0; from < numCities; from++)
+        {
+            for (int to = 0; to < numCities; to++)
+            {
+                for (int mode = MODE_BUS; mode <= MODE_TRAIN; mode++)
+                {
+                    if (from != to && (origin < 0 || from == origin) && findRouteIndex(from, to, mode) < 0 &&
+                        routeCapacityFor(from, to, mode) >= minFree)
+                    {
+                        printRouteAvailabilityRow(from, to, mode, routeCapacityFor(from, to, mode));
+                        found++;
+                    }
+                }
+            }
+        }
+    }
+    if (found == 0)
+    {
+        printf("| %-65s |\n", choice == 1 ? "No route has that many free seats." : "No route is sold out.");
+    }
+    printf("+----------------------+----------------------+--------+------------+\n");
+    free(routes);
+}
+
+// Seats editBooking took for a booking, held until the change is saved.
+// Seats the booking already had on its route are kept rather than held.
+struct SeatClaim
+{
+    int count;
+    int seats[MAX_TRAVELERS];
+    int holds[MAX_TRAVELERS];
+};
+
+void releaseSeatClaim(struct SeatClaim *claim)
+{
+    for (int i = 0; i < claim->count; i++)
+    {
+        releaseSeatHold(claim->holds[i]);
+    }
+    claim->count = 0;
+}
+
+// Gives back the seats of a confirmed claim that were not saved.
+void freeSeatClaim(const struct Booking *booking, const struct SeatClaim *claim)
+{
+    for (int i = 0; i < claim->count; i++)
+    {
+        freeSeatRoute(booking->currentCityID, booking->destinationCityID, booking->modeID, claim->seats[i]);
+    }
+}
+
+// Shows a booking and lets the operator change its fields. New seats are
+// held through claim, as addBooking holds them. Returns false, holding
+// nothing, if the booking cannot be changed.
+bool editBooking(struct Booking *booking, struct SeatClaim *claim)
+{
+    struct Booking original = *booking;
+    claim->count = 0;
+    printf("Current Booking Details:\n");
+    printf("Name: %s\n", booking->name);
+    printf("Current Location: %s\n", cityName(booking->currentCityID));
+    printf("Destination: %s\n", cityName(booking->destinationCityID));
+    printf("Price: Rs. %d\n", booking->price);
+
+    // Modify the Name
+    printf("Enter new name (leave blank for no change): ");
+    char newName[MAX_NAME_LENGTH];
+    fgets(newName, MAX_NAME_LENGTH, stdin);
+    newName[strcspn(newName, "\n")] = 0;
+    if (strlen(newName) > 0)
+    {
+        strncpy(booking->name, newName, MAX_NAME_LENGTH);
+    }
+
+    // Display Indian Cities and Modify Current Location
+    for (int i = 0; i < numCities; i++)
+    {
+        printf("%d. %s\n", i + 1, indianCities[i]);
+    }
+    printf("current location : ");
+    int currentLocationChoice = selectCity();
+    if (currentLocationChoice > 0)
+    {
+        booking->currentCityID = currentLocationChoice - 1;
+    }
+    else if (currentLocationChoice == 0)
+    {
+        printf("No change to the current location.\n");
+    }
+
+    // Display Cities and Modify Destination Location
+    for (int i = 0; i < numCities; i++)
+    {
+        printf("%d. %s\n", i + 1, indianCities[i]);
+    }
+
+    printf("destination location : ");
+    int newDestChoice = selectCity();
+    if (newDestChoice > 0)
+    {
+        booking->destinationCityID = newDestChoice - 1;
+    }
+    else if (newDestChoice == 0)
+    {
+        printf("No change to the destination.\n");
+    }
+
+    // Modify Number of Travelers
+    int n;
+   do {
+     printf("Enter new number of travelers (or enter 0 to skip): ");
+       if (scanf("%d", &n) != 1) {
+            stopAtEndOfInput();
+            printf("Invalid input. Please enter a valid number of travelers.\n");
+            clearInputBuffer();
+      } 
+       else if (n < 0 || n > MAX_TRAVELERS) {
+            printf("Please enter a valid number between 0 and %d.\n", MAX_TRAVELERS);
+            clearInputBuffer();
+      } 
+       else {
+            break;
+     }
+  } while (1);
+    
+       clearInputBuffer();
+
+     if (n > 0) {
+            booking->numTravelers = n;
+    } 
+     else if (n == 0) {
+          printf("No change to the number of travelers.\n");
+     }
+    // Modify Ticket Category
+      int cateChoice;
+      printf("Select Ticket Category (enter 0 to skip):\n");
+    
+       for (int i = 0; i < sizeof(ticketCategories) / sizeof(ticketCategories[0]); i++) {
+              printf("%d. %s\n", i + 1, ticketCategories[i]);
+        }
+
+       char categoryInput[10];
+       fgets(categoryInput, sizeof(categoryInput), stdin);
+    
+       if (sscanf(categoryInput, "%d", &cateChoice) == 1 && cateChoice != 0 &&
+            cateChoice >= 1 && cateChoice <= sizeof(ticketCategories) / sizeof(ticketCategories[0])) 
+       {
+             booking->categoryID = cateChoice - 1; 
+       } 
+       else 
+       {
+             printf("No change to the category.\n");
+        }
+
+
+    // Modify Seats for Each Traveler
+printf("Select new seats for the travelers (enter 0 to skip):\n");
+
+int seats[MAX_TRAVELERS];
+int seatCount = bookingSeats(booking, seats);
+int originalSeats[MAX_TRAVELERS];
+int originalSeatCount = bookingSeats(&original, originalSeats);
+// A seat the booking has is only kept on the same route; any other is claimed
+bool sameRoute = booking->currentCityID == original.currentCityID && booking->destinationCityID == original.destinationCityID;
+int routeIndex = addRoute(booking->currentCityID, booking->destinationCityID, booking->modeID);
+if (routeIndex < 0) {
+    printf("Error: No more routes can be added. The booking was not changed.\n");
+    return false;
+}
+int capacity = seatMap->routes[routeIndex].capacity;
+for (int i = 0; i < booking->numTravelers; i++) {
+   
+    if (i < seatCount) {
+        printf("Current seat for traveler %d: %d\n", i + 1, seats[i]);
+    } else {
+        printf("Current seat for traveler %d: None\n", i + 1);
+    }
+
+    int newSeatNum;
+    while (1) {
+        char seatInput[10];
+        printf("Select new seat number for traveler %d (or enter 0 to skip): ", i + 1);
+        if (fgets(seatInput, sizeof(seatInput), stdin) == NULL) {
+            stopAtEndOfInput();
+            continue;
+        }
+
+
+        bool keep = strcmp(seatInput, "0\n") == 0;
+        if (keep) {
+
+            if (i >= seatCount) {
+                printf("Error: New travelers must have a seat assigned.\n");
+                continue;
+            }
+            newSeatNum = seats[i];
+        } else if (sscanf(seatInput, "%d", &newSeatNum) != 1 || newSeatNum < 1 || newSeatNum > capacity) {
+            printf("Error: Invalid seat number. Please enter a valid seat (1-%d).\n", capacity);
+            continue;
+        }
+
+        int taken = -1;
+        for (int j = 0; j < i; j++) {
+            taken = seats[j] == newSeatNum ? j : taken;
+        }
+        if (taken >= 0) {
+            printf("Error: Seat %d is already taken by traveler %d.\n", newSeatNum, taken + 1);
+            continue;
+        }
+        bool owned = false;
+        for (int j = 0; sameRoute && j < originalSeatCount; j++) {
+            owned = owned || originalSeats[j] == newSeatNum;
+        }
+        if (!owned) {
+            // Claimed the way addBooking claims it, so no other counter can have it
+            int hold = newSeatNum <= capacity ? holdSeatRoute(booking->currentCityID, booking->destinationCityID, booking->modeID, newSeatNum, SEAT_HOLD_TTL_SECONDS) : -1;
+            if (hold < 0) {
+                printf("Error: Seat %d is not available%s. Please choose another seat.\n", newSeatNum, keep ? " on the new route" : "");
+                continue;
+            }
+            claim->seats[claim->count] = newSeatNum;
+            claim->holds[claim->count++] = hold;
+        }
+        seats[i] = newSeatNum;
+        if (keep) {
+            printf("No change for traveler %d's seat.\n", i + 1);
+        } else {
+            printf("Traveler %d's seat successfully changed to %d.\n", i + 1, newSeatNum);
+        }
+        break;
+    }
+}
+
+
+if (setBookingSeats(booking, seats, booking->numTravelers)) {
+    booking->bookedSeat = booking->numTravelers;
+} else {
+    printf("Error: A booking holds at most %d separate blocks of seats. The booking was not changed.\n", MAX_SEAT_RUNS);
+    releaseSeatClaim(claim);
+    return false;
+}
+
+
+    if (booking->currentCityID >= 0 && booking->currentCityID < numCities &&
+        booking->destinationCityID >= 0 && booking->destinationCityID < numCities)
+    {
+        booking->price = bookingFare(booking);
+    }
+    else
+    {
+        printf("Error: Unable to find current location or destination in the cities list.\n");
+        releaseSeatClaim(claim);
+        return false;
+    }
+    return true;
+}
+
+// Frees the seats a saved change took off a booking and lets the waitlist
+// have them.
+void releaseDroppedSeats(const struct Booking *before, const struct Booking *after)
+{
+    int routeIndex = findRouteIndex(before->currentCityID, before->destinationCityID, before->modeID);
+    if (routeIndex < 0)
+    {
+        return;
+    }
+    bool sameRoute = before->currentCityID == after->currentCityID && before->destinationCityID == after->destinationCityID &&
+                     before->modeID == after->modeID;
+    int oldSeats[MAX_TRAVELERS];
+    int newSeats[MAX_TRAVELERS];
+    int oldCount = bookingSeats(before, oldSeats);
+    int newCount = sameRoute ? bookingSeats(after, newSeats) : 0;
+    bool released = false;
+    for (int i = 0; i < oldCount; i++)
+    {
+        bool kept = false;
+        for (int j = 0; j < newCount; j++)
+        {
+            kept = kept || newSeats[j] == oldSeats[i];
+        }
+        if (!kept)
+        {
+            markSeatFree(&seatMap->routes[routeIndex], oldSeats[i]);
+            released = true;
+        }
+    }
+    if (released)
+    {
+        promoteWaitlist(routeIndex);
+    }
+}
+
+void modifyBooking()
+{
+    int ticketID;
+    printf("Enter Ticket ID to modify: ");
+    if (scanf("%d", &ticketID) != 1)
+    {
+        printf("Error: Invalid input.\n");
+        clearInputBuffer();
+        return;
+    }
+    clearInputBuffer();
+
+    struct Booking booking;
+    long offset = bookingEngine->find(ticketID, &booking);
+    if (offset < 0)
+    {
+        printf("Booking with Ticket ID %d not found.\n", ticketID);
+        return;
+    }
+
+    // Nothing is locked while the operator edits; the change is only saved
+    // if no other counter changed the booking in the meantime
+    while (1)
+    {
+        struct Booking original = booking;
+        struct SeatClaim claim;
+        if (!editBooking(&booking, &claim))
+        {
+            return;
+        }
+
+        // Turn the held seats into bookings
+        bool confirmed[MAX_TRAVELERS];
+        bool holdsExpired = false;
+        for (int i = 0; i < claim.count; i++)
+        {
+            confirmed[i] = confirmSeatHold(claim.holds[i]);
+            holdsExpired = holdsExpired || !confirmed[i];
+        }
+        if (holdsExpired)
+        {
+            // Expired seats were already released; give back the rest
+            for (int i = 0; i < claim.count; i++)
+            {
+                if (confirmed[i])
+                {
+                    freeSeatRoute(booking.currentCityID, booking.destinationCityID, booking.modeID, claim.seats[i]);
+                }
+            }
+            printf("Your seat hold expired before the change was saved. No changes were saved.\n");
+            return;
+        }
+
+        struct Booking edited = booking; // change() overwrites booking on a conflict
+        int result = bookingEngine->change(&offset, original.version, &booking);
+        if (result == BOOKING_CHANGED)
+        {
+            if (strcmp(original.name, booking.name) != 0)
+            {
+                nameIndexRemove(original.name, booking.ticketID);
+                nameIndexAdd(booking.name, booking.ticketID);
+            }
+            printf("Booking modified successfully!\n");
+            bookingsFileRewritten();
+            releaseDroppedSeats(&original, &booking);
+            return;
+        }
+        freeSeatClaim(&edited, &claim);
+        if (result == BOOKING_GONE)
+        {
+            printf("Error: Ticket ID %d was cancelled at another counter.\n", ticketID);
+            return;
+        }
+        if (result == BOOKING_WRITE_FAILED)
+        {
+            printf("Error: Unable to update bookings file.\n");
+            return;
+        }
+
+        // booking now holds what the other counter saved
+        printf("Ticket ID %d was changed at another counter while you were editing it.\n", ticketID);
+        printf("Edit the updated booking instead? (1: Yes, 0: No): ");
+        int retry;
+        if (scanf("%d", &retry) != 1 || retry != 1)
+        {
+            clearInputBuffer();
+            printf("No changes were saved.\n");
+            return;
+        }
+        clearInputBuffer();
+    }
+}
+
+void cancelBooking() {
+    int ticketID;
+    printf("Enter Ticket ID to cancel: ");
+    if (scanf("%d", &ticketID) != 1) {
+        printf("Error: Invalid input.\n");
+        clearInputBuffer();
+        return;
+    }
+    clearInputBuffer();
+
+    struct Booking cancelledBooking;
+    if (bookingEngine->find(ticketID, &cancelledBooking) < 0) {
+        printf("Booking with Ticket ID %d not found.\n", ticketID);
+        return;
+    }
+
+    // The file is only locked for the rewrite, not while the user decides.
+    // If the booking changed in the meantime, show it again and re-ask.
+    int result;
+    do {
+        printf("Booking with Ticket ID %d found. Cancel booking? (1: Yes, 0: No): ", ticketID);
+        int confirm;
+        if (scanf("%d", &confirm) != 1 || (confirm != 0 && confirm != 1)) {
+            printf("Invalid input. Please enter 1 for Yes or 0 for No.\n");
+            clearInputBuffer();
+            confirm = 0;  // Default to not canceling if input invalid
+        }
+        clearInputBuffer();
+        if (confirm != 1) {
+            return;
+        }
+
+        result = bookingEngine->remove(ticketID, cancelledBooking.version, &cancelledBooking);
+        if (result == BOOKING_CONFLICT) {
+            printf("Ticket ID %d was changed at another counter. It is now:\n", ticketID);
+            printf("Name: %s, %s to %s, Price: Rs. %d\n", cancelledBooking.name, cityName(cancelledBooking.currentCityID),
+                   cityName(cancelledBooking.destinationCityID), cancelledBooking.price);
+        }
+    } while (result == BOOKING_CONFLICT);
+
+    bool cancelled = result == BOOKING_CHANGED;
+    if (cancelled) {
+        printf("Ticket ID %d canceled successfully!\n", ticketID);
+        nameIndexRemove(cancelledBooking.name, cancelledBooking.ticketID);
+        bookingsFileRewritten();
+    } else if (result == BOOKING_GONE) {
+        printf("Ticket ID %d was already cancelled at another counter.\n", ticketID);
+    } else {
+        printf("Error: Unable to update bookings file.\n");
+    }
+
+    if (cancelled) {
+        // Give the seats back and let the waitlist take them
+        int routeIndex = addRoute(cancelledBooking.currentCityID, cancelledBooking.destinationCityID, cancelledBooking.modeID);
+        int seats[MAX_TRAVELERS];
+        int seatCount = bookingSeats(&cancelledBooking, seats);
+        for (int j = 0; routeIndex >= 0 && j < seatCount; j++) {
+            markSeatFree(&seatMap->routes[routeIndex], seats[j]);
+        }
+        if (routeIndex >= 0) {
+            promoteWaitlist(routeIndex);
+        }
+    }
+}
+
+
+// Bulk operations over every booking matching a filter, applied in a single
+// pass over bookings.dat. Filter fields set to -1 match anything.
+struct BookingFilter
+{
+    int currentCityID;
+    int destinationCityID;
+    int modeID;
+    int categoryID;
+};
+
+enum BulkAction
+{
+    BULK_CANCEL = 1,
+    BULK_REPRICE = 2
+};
+
+struct PointsAdjustment
+{
+    char name[MAX_NAME_LENGTH];
+    int points;
+};
+
+bool bookingMatches(const struct BookingFilter *filter, const struct Booking *booking)
+{
+    return (filter->currentCityID < 0 || filter->currentCityID == booking->currentCityID) &&
+           (filter->destinationCityID < 0 || filter->destinationCityID == booking->destinationCityID) &&
+           (filter->modeID < 0 || filter->modeID == booking->modeID) &&
+           (filter->categoryID < 0 || filter->categoryID == booking->categoryID);
+}
+
+int comparePointsAdjustments(const void *a, const void *b)
+{
+    return strcmp(((const struct PointsAdjustment *)a)->name, ((const struct PointsAdjustment *)b)->name);
+}
+
+// Applies all points adjustments in one pass over the points file.
+void applyPointsAdjustments(struct PointsAdjustment *adjustments, int count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    qsort(adjustments, count, sizeof(struct PointsAdjustment), comparePointsAdjustments);
+
+    ioBackend->prepareRead(POINTS_FILENAME);
+    FILE *file = openDataFile(POINTS_FILENAME);
+    if (file == NULL)
+    {
+        return;
+    }
+
+    struct User user;
+    while (readUser(file, &user))
+    {
+        struct PointsAdjustment key;
+        strncpy(key.name, user.name, MAX_NAME_LENGTH);
+        struct PointsAdjustment *first = bsearch(&key, adjustments, count, sizeof(struct PointsAdjustment), comparePointsAdjustments);
+        if (first == NULL)
+        {
+            continue;
+        }
+        // bsearch may land anywhere in a run of equal names
+        while (first > adjustments && strcmp((first - 1)->name, user.name) == 0)
+        {
+            first--;
+        }
+        int delta = 0;
+        for (struct PointsAdjustment *a = first; a < adjustments + count && strcmp(a->name, user.name) == 0; a++)
+        {
+            delta += a->points;
+        }
+
+        // The backend rereads the record under its lock in case another counter changed it
+        long offset = ftell(file) - (long)sizeof(struct User);
+        struct PointsChange change = {user.name, delta, true, false, -1};
+        ioBackend->update(POINTS_FILENAME, offset, sizeof(struct User), applyPointsChange, &change);
+    }
+    fclose(file);
+}
+
+// Cancels or reprices every booking that matches filter. With dryRun set
+// nothing is changed and only the number of matching bookings is returned.
+// Cancelled seats are released, points earned on cancelled bookings are
+// taken back and waitlists on the affected routes are promoted.
+long applyBulkOperation(const struct BookingFilter *filter, int action, int newPrice, bool dryRun)
+{
+    prepareBookingsScan();
+    bool rewrite = !dryRun && !bookingEngine->logStructured;
+    int lockFd = -1;
+    if (rewrite && (lockFd = lockBookingsFile()) < 0)
+    {
+        return 0;
+    }
+    FILE *file = openDataFile(FILENAME);
+    if (file == NULL)
+    {
+        if (lockFd >= 0)
+        {
+            close(lockFd);
+        }
+        return 0;
+    }
+    FILE *tempFile = NULL;
+    if (rewrite)
+    {
+        tempFile = fopen(FILENAME ".tmp", "wb");
+        if (tempFile == NULL || !writeDataHeader(tempFile, FILENAME))
+        {
+            if (tempFile != NULL)
+            {
+                fclose(tempFile);
+            }
+            fclose(file);
+            close(lockFd);
+            return -1;
+        }
+    }
+
+    struct PointsAdjustment *adjustments = NULL;
+    int adjustmentCount = 0, adjustmentCapacity = 0;
+    bool touchedRoutes[MAX_ROUTES] = {false};
+    long matched = 0;
+    struct Booking booking;
+
+    while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+    {
+        bool match = bookingIntact(&booking) && bookingMatches(filter, &booking); // Damaged records are copied as they are
+        matched += match;
+        if (dryRun)
+        {
+            continue;
+        }
+        if (bookingEngine->logStructured)
+        {
+            if (!match)
+            {
+                continue;
+            }
+            // Each change is one small log record. Bookings changed at
+            // another counter since this scan are left alone.
+            long position = 0;
+            struct Booking updated = booking;
+            updated.price = newPrice;
+            int result = action == BULK_CANCEL ? bookingEngine->remove(booking.ticketID, booking.version, &updated)
+                                               : bookingEngine->change(&position, booking.version, &updated);
+            if (result != BOOKING_CHANGED)
+            {
+                matched--;
+                continue;
+            }
+            if (action != BULK_CANCEL)
+            {
+                continue;
+            }
+        }
+        else
+        {
+            if (match && action == BULK_REPRICE)
+            {
+                booking.price = newPrice;
+                booking.version++; // Open edits of this booking must not overwrite the new price
+                sealBooking(&booking);
+            }
+            if (!match || action != BULK_CANCEL)
+            {
+                fwrite(&booking, sizeof(struct Booking), 1, tempFile);
+                continue;
+            }
+        }
+
+        nameIndexRemove(booking.name, booking.ticketID);
+        int routeIndex = findRouteIndex(booking.currentCityID, booking.destinationCityID, booking.modeID);
+        int seats[MAX_TRAVELERS];
+        int seatCount = bookingSeats(&booking, seats);
+        for (int j = 0; routeIndex >= 0 && j < seatCount; j++)
+        {
+            markSeatFree(&seatMap->routes[routeIndex], seats[j]);
+            touchedRoutes[routeIndex] = true;
+        }
+        if (booking.price > MIN_BOOKING_PRICE)
+        {
+            if (adjustmentCount == adjustmentCapacity)
+            {
+                int capacity = adjustmentCapacity ? adjustmentCapacity * 2 : 64;
+                struct PointsAdjustment *grown = realloc(adjustments, capacity * sizeof(struct PointsAdjustment));
+                if (grown == NULL)
+                {
+                    // The booking is already cancelled; only its points stay
+                    printf("Error: Out of memory. Points for ticket %d were not taken back.\n", booking.ticketID);
+                    continue;
+                }
+                adjustments = grown;
+                adjustmentCapacity = capacity;
+            }
+            strncpy(adjustments[adjustmentCount].name, booking.name, MAX_NAME_LENGTH);
+            adjustments[adjustmentCount].points = -10; // Points granted by update_reedem_Points
+            adjustmentCount++;
+        }
+    }
+    fclose(file);
+
+    if (rewrite)
+    {
+        fclose(tempFile);
+        rename(FILENAME ".tmp", FILENAME);
+        close(lockFd); // Release the compaction lock once the new file is in place
+    }
+    if (!dryRun)
+    {
+        bookingsFileRewritten();
+        applyPointsAdjustments(adjustments, adjustmentCount);
+        for (int r = 0; r < seatMap->routeCount; r++)
+        {
+            if (touchedRoutes[r])
+            {
+                promoteWaitlist(r);
+            }
+        }
+    }
+    free(adjustments);
+    return matched;
+}
+
+void bulkUpdateBookings()
+{
+    struct BookingFilter filter;
+
+    displayCities();
+    printf("Current location (0 for any): ");
+    filter.currentCityID = selectCity() - 1;
+    printf("Destination (0 for any): ");
+    filter.destinationCityID = selectCity() - 1;
+
+    int modeChoice;
+    do
+    {
+        printf("Mode (1: Bus, 2: Train, 0: Any): ");
+        if (scanf("%d", &modeChoice) != 1 || modeChoice < 0 || modeChoice > 2)
+        {
+            stopAtEndOfInput();
+            printf("Invalid choice. Please enter 0, 1 or 2.\n");
+            clearInputBuffer();
+            continue;
+        }
+        break;
+    } while (1);
+    filter.modeID = modeChoice == 0 ? -1 : (modeChoice == 1 ? MODE_BUS : MODE_TRAIN);
+
+    int numCategories = sizeof(ticketCategories) / sizeof(ticketCategories[0]);
+    int categoryChoice;
+    do
+    {
+        printf("Category (");
+        for (int i = 0; i < numCategories; i++)
+        {
+            printf("%d: %s, ", i + 1, ticketCategories[i]);
+        }
+        printf("0: Any): ");
+        if (scanf("%d", &categoryChoice) != 1 || categoryChoice < 0 || categoryChoice > numCategories)
+        {
+            stopAtEndOfInput();
+            printf("Invalid choice. Please enter a number between 0 and %d.\n", numCategories);
+            clearInputBuffer();
+            continue;
+        }
+        break;
+    } while (1);
+    filter.categoryID = categoryChoice - 1;
+
+    int action;
+    do
+    {
+        printf("Action (1: Cancel, 2: Reprice): ");
+        if (scanf("%d", &action) != 1 || (action != BULK_CANCEL && action != BULK_REPRICE))
+        {
+            stopAtEndOfInput();
+            printf("Invalid choice. Please enter 1 or 2.\n");
+            clearInputBuffer();
+            continue;
+        }
+        break;
+    } while (1);
+
+    int newPrice = 0;
+    if (action == BULK_REPRICE)
+    {
+        do
+        {
+            printf("New price: Rs. ");
+            if (scanf("%d", &newPrice) != 1 || newPrice < 0)
+            {
+                stopAtEndOfInput();
+                printf("Invalid price.\n");
+                clearInputBuffer();
+                continue;
+            }
+            break;
+        } while (1);
+    }
+    clearInputBuffer();
+
+    long matched = applyBulkOperation(&filter, action, newPrice, true);
+    printf("%ld booking(s) match.\n", matched);
+    if (matched == 0)
+    {
+        return;
+    }
+
+    int confirm;
+    printf("%s all of them? (1: Yes, 0: No): ", action == BULK_CANCEL ? "Cancel" : "Reprice");
+    if (scanf("%d", &confirm) != 1 || confirm != 1)
+    {
+        clearInputBuffer();
+        printf("No bookings were changed.\n");
+        return;
+    }
+    clearInputBuffer();
+
+    matched = applyBulkOperation(&filter, action, newPrice, false);
+    if (matched < 0)
+    {
+        printf("Error opening file.\n");
+        return;
+    }
+    printf("%ld booking(s) %s.\n", matched, action == BULK_CANCEL ? "canceled" : "repriced");
+}
+
+// Parallel scan engine: splits bookings.dat into record-aligned chunks and
+// hands them to a pool of workers. Each worker folds records into its own
+// partial result, and the partials are merged once all workers are done.
+struct BookingScan
+{
+    int fd;
+    long long totalRecords;
+    long long nextChunk; // Claimed atomically by workers
+    void (*visit)(const struct Booking *booking, void *partial);
+    bool failed; // A read error left records unvisited
+};
+
+struct ScanWorker
+{
+    struct BookingScan *scan;
+    void *partial;
+};
+
+// Reads count records from first on and visits the intact ones, at most
+// capacity records per read. Returns false on a read error; a file that
+// ends early just has fewer records to visit.
+bool scanBookingRecords(struct ScanWorker *worker, struct Booking *buffer, long long capacity, long long first, long long count)
+{
+    struct BookingScan *scan = worker->scan;
+    for (long long done = 0; done < count;)
+    {
+        long long piece = count - done < capacity ? count - done : capacity;
+        size_t wanted = piece * sizeof(struct Booking);
+        size_t got = 0;
+        while (got < wanted)
+        {
+            ssize_t n = pread(scan->fd, (char *)buffer + got, wanted - got, recordOffset(first + done, sizeof(struct Booking)) + got);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n < 0)
+            {
+                return false;
+            }
+            if (n == 0)
+            {
+                break;
+            }
+            got += n;
+        }
+
+        long long records = got / sizeof(struct Booking);
+        for (long long i = 0; i < records; i++)
+        {
+            if (bookingIntact(&buffer[i]))
+            {
+                scan->visit(&buffer[i], worker->partial);
+            }
+        }
+        if (records < piece)
+        {
+            break; // The file was truncated under us
+        }
+        done += piece;
+    }
+    return true;
+}
+
+void *bookingScanWorker(void *arg)
+{
+    struct ScanWorker *worker = arg;
+    struct BookingScan *scan = worker->scan;
+    // Without a chunk buffer the worker still takes its share, a record at a time
+    struct Booking single;
+    struct Booking *buffer = malloc(SCAN_CHUNK_RECORDS * sizeof(struct Booking));
+    long long capacity = buffer != NULL ? SCAN_CHUNK_RECORDS : 1;
+    if (buffer == NULL)
+    {
+        buffer = &single;
+    }
+
+    while (1)
+    {
+        long long chunk = __atomic_fetch_add(&scan->nextChunk, 1, __ATOMIC_RELAXED);
+        long long first = chunk * SCAN_CHUNK_RECORDS;
+        if (first >= scan->totalRecords)
+        {
+            break;
+        }
+        long long count = scan->totalRecords - first;
+        if (count > SCAN_CHUNK_RECORDS)
+        {
+            count = SCAN_CHUNK_RECORDS;
+        }
+        if (!scanBookingRecords(worker, buffer, capacity, first, count))
+        {
+            __atomic_store_n(&scan->failed, true, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (buffer != &single)
+    {
+        free(buffer);
+    }
+    return NULL;
+}
+
+int scanThreadLimit = MAX_SCAN_THREADS; // Lowered by --benchmark scan
+
+int scanThreadCount(long long totalRecords)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long long chunks = (totalRecords + SCAN_CHUNK_RECORDS - 1) / SCAN_CHUNK_RECORDS;
+    int threads = cpus > 0 ? (int)cpus : 1;
+    if (threads > scanThreadLimit)
+    {
+        threads = scanThreadLimit;
+    }
+    if (threads > chunks)
+    {
+        threads = chunks > 0 ? (int)chunks : 1;
+    }
+    return threads;
+}
+
+// Runs visit() over every booking on a worker pool. Each worker starts from a
+// zeroed partial of partialSize bytes; merge() folds each partial into result.
+// Returns false if the bookings file cannot be opened or read, in which case
+// result is incomplete.
+bool scanBookingsParallel(void (*visit)(const struct Booking *booking, void *partial),
+                          size_t partialSize,
+                          void (*merge)(void *result, const void *partial),
+                          void *result)
+{
+    prepareBookingsScan();
+    int fd = open(FILENAME, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    struct BookingScan scan = {fd, recordCount(st.st_size, sizeof(struct Booking)), 0, visit, false};
+    int threads = scanThreadCount(scan.totalRecords);
+
+    pthread_t tids[MAX_SCAN_THREADS];
+    struct ScanWorker workers[MAX_SCAN_THREADS];
+    char *partials = calloc(threads, partialSize);
+    if (partials == NULL && threads > 1)
+    {
+        threads = 1; // Scan serially on this thread with a single partial
+        partials = calloc(1, partialSize);
+    }
+    if (partials == NULL)
+    {
+        close(fd);
+        return false;
+    }
+
+    // Workers claim chunks as they go, so chunks of a worker that failed to
+    // start are picked up by the others or by worker 0 on this thread.
+    int started = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        workers[i].scan = &scan;
+        workers[i].partial = partials + i * partialSize;
+        if (i > 0 && pthread_create(&tids[started], NULL, bookingScanWorker, &workers[i]) == 0)
+        {
+            started++;
+        }
+    }
+    bookingScanWorker(&workers[0]);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(tids[i], NULL);
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        merge(result, partials + i * partialSize);
+    }
+
+    free(partials);
+    close(fd);
+    return !scan.failed;
+}
+
+// Natural log for x > 0. Kept local so the program still builds with a
+// plain gcc call and no -lm.
+double naturalLog(double x)
+{
+    int exponent = 0;
+    while (x >= 2)
+    {
+        x /= 2;
+        exponent++;
+    }
+    while (x < 1)
+    {
+        x *= 2;
+        exponent--;
+    }
+    // ln(x) = 2 atanh((x - 1) / (x + 1)), and that ratio is at most 1/3 here
+    double y = (x - 1) / (x + 1), y2 = y * y, term = y, sum = 0;
+    for (int n = 1; n < 40; n += 2)
+    {
+        sum += term / n;
+        term *= y2;
+    }
+    return 2 * sum + exponent * 0.69314718055994530942;
+}
+
+// Streaming sketches behind the reports. Each has a fixed size however many
+// bookings it has seen, is valid when zeroed, and merging the sketches of
+// two sets of bookings gives the sketch of their union. That lets every
+// scan thread build its own and the results be combined at the end.
+// Customers are told apart by name, ignoring case like searchBookings does.
+unsigned long long hashCustomer(const char *name)
+{
+    unsigned long long hash = 1469598103934665603ULL;
+    for (const char *c = name; *c != '\0'; c++)
+    {
+        hash = (hash ^ (unsigned char)tolower((unsigned char)*c)) * 1099511628211ULL;
+    }
+    return mixHash(hash);
+}
+
+// HyperLogLog distinct counter, about 3% standard error at 1024 registers.
+struct HyperLogLog
+{
+    unsigned char registers[HLL_REGISTERS];
+};
+
+void hllAdd(struct HyperLogLog *hll, unsigned long long hash)
+{
+    int index = hash >> (64 - HLL_PRECISION);
+    unsigned long long rest = hash << HLL_PRECISION;
+    int rank = rest == 0 ? 64 - HLL_PRECISION + 1 : __builtin_clzll(rest) + 1;
+    if (rank > hll->registers[index])
+    {
+        hll->registers[index] = rank;
+    }
+}
+
+void hllMerge(struct HyperLogLog *into, const struct HyperLogLog *from)
+{
+    for (int i = 0; i < HLL_REGISTERS; i++)
+    {
+        if (from->registers[i] > into->registers[i])
+        {
+            into->registers[i] = from->registers[i];
+        }
+    }
+}
+
+double hllEstimate(const struct HyperLogLog *hll)
+{
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++)
+    {
+        sum += 1.0 / (1ULL << hll->registers[i]);
+        zeros += hll->registers[i] == 0;
+    }
+    double alpha = 0.7213 / (1 + 1.079 / HLL_REGISTERS);
+    double estimate = alpha * HLL_REGISTERS * HLL_REGISTERS / sum;
+    if (estimate <= 2.5 * HLL_REGISTERS && zeros > 0)
+    {
+        estimate = HLL_REGISTERS * naturalLog((double)HLL_REGISTERS / zeros); // Small-range correction
+    }
+    return estimate;
+}
+
+// Distinct customers for one route and mode. Slots are found by open
+// addressing on the route/mode key.
+struct RouteCustomers
+{
+    unsigned long long key; // routeModeKey() + 1, 0 while the slot is unused
+    struct HyperLogLog customers;
+};
+
+unsigned long long routeModeKey(int currentCityID, int destinationCityID, int modeID)
+{
+    return ((unsigned long long)currentCityID * MAX_CATALOG_ENTRIES + destinationCityID) * MAX_CATALOG_ENTRIES + modeID;
+}
+
+struct RouteCustomers *findRouteCustomers(struct RouteCustomers *slots, unsigned long long key)
+{
+    int i = mixHash(key) % SKETCH_ROUTE_SLOTS;
+    for (int probe = 0; probe < SKETCH_ROUTE_SLOTS; probe++)
+    {
+        if (slots[i].key == key + 1 || slots[i].key == 0)
+        {
+            slots[i].key = key + 1;
+            return &slots[i];
+        }
+        i = (i + 1) % SKETCH_ROUTE_SLOTS;
+    }
+    return NULL; // Table full; the pair is still counted in the overall total
+}
+
+// Count-min sketch. Estimates never undercount; with 2048 columns they
+// overcount by at most 0.14% of all updates with 98% probability.
+struct CountMinSketch
+{
+    unsigned int counts[CMS_DEPTH][CMS_WIDTH];
+};
+
+void cmsAdd(struct CountMinSketch *cms, unsigned long long key)
+{
+    unsigned long long hash = mixHash(key);
+    unsigned int h1 = hash, h2 = hash >> 32;
+    for (int row = 0; row < CMS_DEPTH; row++)
+    {
+        cms->counts[row][(h1 + row * h2) % CMS_WIDTH]++;
+    }
+}
+
+long long cmsEstimate(const struct CountMinSketch *cms, unsigned long long key)
+{
+    unsigned long long hash = mixHash(key);
+    unsigned int h1 = hash, h2 = hash >> 32;
+    long long estimate = -1;
+    for (int row = 0; row < CMS_DEPTH; row++)
+    {
+        long long count = cms->counts[row][(h1 + row * h2) % CMS_WIDTH];
+        if (estimate < 0 || count < estimate)
+        {
+            estimate = count;
+        }
+    }
+    return estimate;
+}
+
+void cmsMerge(struct CountMinSketch *into, const struct CountMinSketch *from)
+{
+    for (int row = 0; row < CMS_DEPTH; row++)
+    {
+        for (int i = 0; i < CMS_WIDTH; i++)
+        {
+            into->counts[row][i] += from->counts[row][i];
+        }
+    }
+}
+
+// The TOP_K keys with the highest count-min estimates, as a min-heap on
+// the estimate so the weakest candidate is always at the root.
+struct TopK
+{
+    int count;
+    unsigned long long keys[TOP_K];
+    long long estimates[TOP_K];
+};
+
+void topKSwap(struct TopK *top, int a, int b)
+{
+    unsigned long long key = top->keys[a];
+    long long estimate = top->estimates[a];
+    top->keys[a] = top->keys[b];
+    top->estimates[a] = top->estimates[b];
+    top->keys[b] = key;
+    top->estimates[b] = estimate;
+}
+
+void topKSiftDown(struct TopK *top, int i)
+{
+    while (1)
+    {
+        int smallest = i;
+        for (int child = 2 * i + 1; child <= 2 * i + 2 && child < top->count; child++)
+        {
+            if (top->estimates[child] < top->estimates[smallest])
+            {
+                smallest = child;
+            }
+        }
+        if (smallest == i)
+        {
+            return;
+        }
+        topKSwap(top, i, smallest);
+        i = smallest;
+    }
+}
+
+void topKOffer(struct TopK *top, unsigned long long key, long long estimate)
+{
+    for (int i = 0; i < top->count; i++)
+    {
+        if (top->keys[i] == key)
+        {
+            top->estimates[i] = estimate; // Estimates only grow
+            topKSiftDown(top, i);
+            return;
+        }
+    }
+    if (top->count < TOP_K)
+    {
+        int i = top->count++;
+        top->keys[i] = key;
+        top->estimates[i] = estimate;
+        while (i > 0 && top->estimates[i] < top->estimates[(i - 1) / 2])
+        {
+            topKSwap(top, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+    if (estimate > top->estimates[0])
+    {
+        top->keys[0] = key;
+        top->estimates[0] = estimate;
+        topKSiftDown(top, 0);
+    }
+}
+
+// Call after the count-min sketches have been merged into cms: every
+// candidate from either side is re-ranked on the merged estimate.
+void topKMerge(struct TopK *into, const struct TopK *from, const struct CountMinSketch *cms)
+{
+    struct TopK candidates = *into;
+    into->count = 0;
+    for (int i = 0; i < candidates.count; i++)
+    {
+        topKOffer(into, candidates.keys[i], cmsEstimate(cms, candidates.keys[i]));
+    }
+    for (int i = 0; i < from->count; i++)
+    {
+        topKOffer(into, from->keys[i], cmsEstimate(cms, from->keys[i]));
+    }
+}
+
+int compareTopKEntries(const void *a, const void *b)
+{
+    long long x = ((const long long *)a)[1], y = ((const long long *)b)[1];
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Copies the entries out as (key, estimate) pairs, largest first.
+int topKSorted(const struct TopK *top, long long pairs[][2])
+{
+    for (int i = 0; i < top->count; i++)
+    {
+        pairs[i][0] = top->keys[i];
+        pairs[i][1] = top->estimates[i];
+    }
+    qsort(pairs, top->count, sizeof(pairs[0]), compareTopKEntries);
+    return top->count;
+}
+
+// Merging t-digest for price quantiles. Values are buffered and folded into
+// the centroids when the buffer fills; centroids near the median may grow
+// large while those at the tails stay small, which keeps p99 accurate.
+struct Centroid
+{
+    double mean;
+    double weight;
+};
+
+struct TDigest
+{
+    double totalWeight;
+    double min;
+    double max;
+    int centroidCount;
+    int bufferCount;
+    struct Centroid centroids[TDIGEST_CENTROIDS];
+    struct Centroid buffer[TDIGEST_BUFFER];
+};
+
+int compareCentroids(const void *a, const void *b)
+{
+    double x = ((const struct Centroid *)a)->mean, y = ((const struct Centroid *)b)->mean;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+void tdigestCompress(struct TDigest *digest)
+{
+    if (digest->bufferCount == 0)
+    {
+        return;
+    }
+    struct Centroid all[TDIGEST_CENTROIDS + TDIGEST_BUFFER];
+    int count = digest->centroidCount;
+    memcpy(all, digest->centroids, count * sizeof(struct Centroid));
+    memcpy(all + count, digest->buffer, digest->bufferCount * sizeof(struct Centroid));
+    count += digest->bufferCount;
+    digest->bufferCount = 0;
+    qsort(all, count, sizeof(struct Centroid), compareCentroids);
+
+    double total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        total += all[i].weight;
+    }
+
+    int out = 0;
+    double before = 0; // Weight left of the centroid being built
+    struct Centroid current = all[0];
+    for (int i = 1; i < count; i++)
+    {
+        // Size bound pi * total * sqrt(q (1 - q)) / compression, compared squared.
+        // It allows about TDIGEST_COMPRESSION centroids however many values
+        // have been added.
+        double weight = current.weight + all[i].weight;
+        double q = (before + weight / 2) / total;
+        double scale = 3.14159265358979 * total / TDIGEST_COMPRESSION;
+        if (weight * weight <= scale * scale * q * (1 - q) || out == TDIGEST_CENTROIDS - 1)
+        {
+            current.mean += (all[i].mean - current.mean) * all[i].weight / weight;
+            current.weight = weight;
+        }
+        else
+        {
+            digest->centroids[out++] = current;
+            before += current.weight;
+            current = all[i];
+        }
+    }
+    digest->centroids[out++] = current;
+    digest->centroidCount = out;
+}
+
+void tdigestAddWeighted(struct TDigest *digest, double value, double weight)
+{
+    if (digest->totalWeight == 0 || value < digest->min)
+    {
+        digest->min = value;
+    }
+    if (digest->totalWeight == 0 || value > digest->max)
+    {
+        digest->max = value;
+    }
+    digest->totalWeight += weight;
+    digest->buffer[digest->bufferCount].mean = value;
+    digest->buffer[digest->bufferCount].weight = weight;
+    if (++digest->bufferCount == TDIGEST_BUFFER)
+    {
+        tdigestCompress(digest);
+    }
+}
+
+void tdigestMerge(struct TDigest *into, const struct TDigest *from)
+{
+    if (from->totalWeight == 0)
+    {
+        return;
+    }
+    double min = into->totalWeight == 0 || from->min < into->min ? from->min : into->min;
+    double max = into->totalWeight == 0 || from->max > into->max ? from->max : into->max;
+    for (int i = 0; i < from->centroidCount; i++)
+    {
+        tdigestAddWeighted(into, from->centroids[i].mean, from->centroids[i].weight);
+    }
+    for (int i = 0; i < from->bufferCount; i++)
+    {
+        tdigestAddWeighted(into, from->buffer[i].mean, from->buffer[i].weight);
+    }
+    into->min = min;
+    into->max = max;
+}
+
+// Value at quantile q (0..1), interpolating between centroid centres.
+double tdigestQuantile(struct TDigest *digest, double q)
+{
+    tdigestCompress(digest);
+    if (digest->centroidCount == 0)
+    {
+        return 0;
+    }
+    double target = q * digest->totalWeight;
+    double previousCentre = 0, previousMean = digest->min, before = 0;
+    for (int i = 0; i < digest->centroidCount; i++)
+    {
+        const struct Centroid *c = &digest->centroids[i];
+        double centre = before + c->weight / 2;
+        if (target < centre)
+        {
+            double span = centre - previousCentre;
+            return span > 0 ? previousMean + (c->mean - previousMean) * (target - previousCentre) / span : c->mean;
+        }
+        previousCentre = centre;
+        previousMean = c->mean;
+        before += c->weight;
+    }
+    double span = digest->totalWeight - previousCentre;
+    return span > 0 ? previousMean + (digest->max - previousMean) * (target - previousCentre) / span : digest->max;
+}
+
+struct ReportTotals
+{
+    long long totalRevenue;
+    long long bookingCount;
+    struct HyperLogLog customers;
+    struct RouteCustomers routeCustomers[SKETCH_ROUTE_SLOTS];
+    struct CountMinSketch counts; // Keyed by sketchKey()
+    struct TopK popularRoutes;
+    struct TopK popularDestinations;
+    struct TDigest prices;
+};
+
+enum SketchKeyKind
+{
+    SKETCH_ROUTE = 1,
+    SKETCH_DESTINATION = 2
+};
+
+unsigned long long sketchKey(int kind, int currentCityID, int destinationCityID)
+{
+    return ((unsigned long long)kind << 40) | ((unsigned long long)currentCityID * MAX_CATALOG_ENTRIES + destinationCityID);
+}
+
+// Report state from the last parallel scan of bookings.dat, reused until
+// the file changes.
+struct ReportTotals reportTotals;
+struct FileVersion reportTotalsSource; // bookings.dat as reportTotals was collected from
+
+void visitReportTotals(const struct Booking *booking, void *partial)
+{
+    struct ReportTotals *totals = partial;
+    totals->totalRevenue += booking->price;
+    totals->bookingCount++;
+
+    unsigned long long customer = hashCustomer(booking->name);
+    hllAdd(&totals->customers, customer);
+    struct RouteCustomers *route = findRouteCustomers(totals->routeCustomers,
+                                                      routeModeKey(booking->currentCityID, booking->destinationCityID, booking->modeID));
+    if (route != NULL)
+    {
+        hllAdd(&route->customers, customer);
+    }
+
+    unsigned long long routeKey = sketchKey(SKETCH_ROUTE, booking->currentCityID, booking->destinationCityID);
+    unsigned long long destinationKey = sketchKey(SKETCH_DESTINATION, 0, booking->destinationCityID);
+    cmsAdd(&totals->counts, routeKey);
+    cmsAdd(&totals->counts, destinationKey);
+    topKOffer(&totals->popularRoutes, routeKey, cmsEstimate(&totals->counts, routeKey));
+    topKOffer(&totals->popularDestinations, destinationKey, cmsEstimate(&totals->counts, destinationKey));
+
+    tdigestAddWeighted(&totals->prices, booking->price, 1);
+}
+
+void mergeReportTotals(void *result, const void *partial)
+{
+    struct ReportTotals *into = result;
+    const struct ReportTotals *from = partial;
+    into->totalRevenue += from->totalRevenue;
+    into->bookingCount += from->bookingCount;
+    hllMerge(&into->customers, &from->customers);
+    for (int i = 0; i < SKETCH_ROUTE_SLOTS; i++)
+    {
+        if (from->routeCustomers[i].key != 0)
+        {
+            struct RouteCustomers *route = findRouteCustomers(into->routeCustomers, from->routeCustomers[i].key - 1);
+            if (route != NULL)
+            {
+                hllMerge(&route->customers, &from->routeCustomers[i].customers);
+            }
+        }
+    }
+    cmsMerge(&into->counts, &from->counts);
+    topKMerge(&into->popularRoutes, &from->popularRoutes, &into->counts);
+    topKMerge(&into->popularDestinations, &from->popularDestinations, &into->counts);
+    tdigestMerge(&into->prices, &from->prices);
+}
+
+bool collectReportTotals(struct ReportTotals *totals)
+{
+    memset(totals, 0, sizeof(*totals));
+    return scanBookingsParallel(visitReportTotals, sizeof(struct ReportTotals), mergeReportTotals, totals);
+}
+
+
+void PopularDestinations(const struct ReportTotals *totals)
+{
+    printf("\n+---------------------------------------------+\n");
+    printCentered("|            Popular Destinations             |", 45);
+    printf("+---------------------------------------------+\n");
+
+    long long top[TOP_K][2];
+    int count = topKSorted(&totals->popularDestinations, top);
+    for (int i = 0; i < count; i++)
+    {
+        printf("| %-31s: %lld bookings |\n", cityName(top[i][0] % MAX_CATALOG_ENTRIES), top[i][1]);
+    }
+    printf("+---------------------------------------------+\n");
+}
+
+void PopularRoutes(const struct ReportTotals *totals)
+{
+    printf("\n+---------------------------------------------+\n");
+    printCentered("|               Popular Routes                |", 45);
+    printf("+---------------------------------------------+\n");
+
+    long long top[TOP_K][2];
+    int count = topKSorted(&totals->popularRoutes, top);
+    for (int i = 0; i < count; i++)
+    {
+        int route = top[i][0] & ((1LL << 40) - 1);
+        char label[64];
+        snprintf(label, sizeof(label), "%s -> %s", cityName(route / MAX_CATALOG_ENTRIES), cityName(route % MAX_CATALOG_ENTRIES));
+        printf("| %-31s: %lld bookings |\n", label, top[i][1]);
+    }
+    printf("+---------------------------------------------+\n");
+}
+
+void CustomerStatistics(const struct ReportTotals *totals)
+{
+    printf("\n+---------------------------------------------+\n");
+    printCentered("|         Distinct Customers (approx.)        |", 45);
+    printf("+---------------------------------------------+\n");
+    printf("| All routes: %-31.0f |\n", hllEstimate(&totals->customers));
+    for (int i = 0; i < SKETCH_ROUTE_SLOTS; i++)
+    {
+        const struct RouteCustomers *route = &totals->routeCustomers[i];
+        if (route->key == 0)
+        {
+            continue;
+        }
+        unsigned long long key = route->key - 1;
+        int modeID = key % MAX_CATALOG_ENTRIES;
+        int routeID = key / MAX_CATALOG_ENTRIES;
+        char label[64];
+        snprintf(label, sizeof(label), "%s -> %s (%s)", cityName(routeID / MAX_CATALOG_ENTRIES),
+                 cityName(routeID % MAX_CATALOG_ENTRIES), modeName(modeID));
+        printf("| %-31s: %-11.0f |\n", label, hllEstimate(&route->customers));
+    }
+    printf("+---------------------------------------------+\n");
+}
+
+void RevenueStatistics(struct ReportTotals *totals)
+{
+    printf("\n+---------------------------------------------+\n");
+    printCentered("|            Revenue Statistics               |", 45);
+    printf("+---------------------------------------------+\n");
+    printf("| Total Revenue from Bookings: Rs. %-10lld |\n", totals->totalRevenue);
+    if (totals->bookingCount > 0)
+    {
+        printf("| Median Price: Rs. %-25.0f |\n", tdigestQuantile(&totals->prices, 0.5));
+        printf("| 90th Percentile Price: Rs. %-16.0f |\n", tdigestQuantile(&totals->prices, 0.9));
+        printf("| 99th Percentile Price: Rs. %-16.0f |\n", tdigestQuantile(&totals->prices, 0.99));
+    }
+    printf("+---------------------------------------------+\n");
+}
+
+// Revenue, bookings and occupancy by travel date for a [from, to) window,
+// grouped by day, week (starting Monday) or month. Only the bookings the
+// travel-date index places in the window are read.
+enum ReportPeriod
+{
+    PERIOD_DAY = 1,
+    PERIOD_WEEK = 2,
+    PERIOD_MONTH = 3
+};
+
+int periodStart(int day, int period)
+{
+    if (period == PERIOD_WEEK)
+    {
+        return day - (day + 3) % 7; // 1970-01-01 was a Thursday
+    }
+    if (period == PERIOD_MONTH)
+    {
+        int year, month, dayOfMonth;
+        civilFromDays(day, &year, &month, &dayOfMonth);
+        return daysFromCivil(year, month, 1);
+    }
+    return day;
+}
+
+int nextPeriodStart(int start, int period)
+{
+    if (period == PERIOD_WEEK)
+    {
+        return start + 7;
+    }
+    if (period == PERIOD_MONTH)
+    {
+        int year, month, day;
+        civilFromDays(start, &year, &month, &day);
+        return month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, month + 1, 1);
+    }
+    return start + 1;
+}
+
+void printPeriodRow(int start, int from, int to, int period, long long bookings, long long revenue, long long seats)
+{
+    // Occupancy is against every known route for each day of the period in the window
+    int first = start > from ? start : from;
+    int end = nextPeriodStart(start, period);
+    int days = (end < to ? end : to) - first;
+    long long capacity = days * totalRouteSeats();
+    char label[16];
+    formatDay(start, label, sizeof(label));
+    printf("| %-10s | %-8lld | Rs. %-11lld | %-6lld | %8.1f%% |\n", label, bookings, revenue, seats,
+           capacity > 0 ? 100.0 * seats / capacity : 0.0);
+}
+
+struct PeriodRow
+{
+    int start;
+    long long bookings;
+    long long revenue;
+    long long seats;
+};
+
+enum PeriodRowsResult
+{
+    PERIOD_ROWS_COLLECTED,
+    PERIOD_ROWS_MOVED, // A record no longer travels on its indexed day
+    PERIOD_ROWS_FAILED
+};
+
+// Totals the indexed bookings travelling in [from, to) into one row per
+// period, reading each from fd. Every record read is checked against its
+// index entry, since another counter may have replaced bookings.dat after
+// the index followed it.
+int collectPeriodRows(int fd, int from, int to, int period, struct PeriodRow **rows, int *rowCount)
+{
+    int capacity = 0;
+    *rowCount = 0;
+    int end = travelIndexLowerBound(to);
+    for (int i = travelIndexLowerBound(from); i < end; i++)
+    {
+        struct Booking booking;
+        if (pread(fd, &booking, sizeof(booking), recordOffset(travelIndex[i].record, sizeof(struct Booking))) != sizeof(booking) ||
+            !bookingIntact(&booking))
+        {
+            continue;
+        }
+        if (booking.travelDate / SECONDS_PER_DAY != travelIndex[i].day)
+        {
+            return PERIOD_ROWS_MOVED;
+        }
+        int start = periodStart(travelIndex[i].day, period);
+        if (*rowCount == 0 || (*rows)[*rowCount - 1].start != start)
+        {
+            if (*rowCount == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 64;
+                struct PeriodRow *grown = realloc(*rows, capacity * sizeof(struct PeriodRow));
+                if (grown == NULL)
+                {
+                    return PERIOD_ROWS_FAILED;
+                }
+                *rows = grown;
+            }
+            (*rows)[(*rowCount)++] = (struct PeriodRow){start, 0, 0, 0};
+        }
+        struct PeriodRow *row = &(*rows)[*rowCount - 1];
+        row->bookings++;
+        row->revenue += booking.price;
+        row->seats += booking.numTravelers;
+    }
+    return PERIOD_ROWS_COLLECTED;
+}
+
+void timeRangeReport()
+{
+    int from = promptDate("From date (YYYY-MM-DD): ");
+    int to = promptDate("To date, not included (YYYY-MM-DD): ");
+    if (to <= from)
+    {
+        printf("Error: The end date must be after the start date.\n");
+        return;
+    }
+    int period;
+    do
+    {
+        printf("Group by (1: Day, 2: Week, 3: Month): ");
+        if (scanf("%d", &period) != 1 || period < PERIOD_DAY || period > PERIOD_MONTH)
+        {
+            stopAtEndOfInput();
+            printf("Invalid choice. Please enter 1, 2 or 3.\n");
+            clearInputBuffer();
+            continue;
+        }
+        break;
+    } while (1);
+    clearInputBuffer();
+
+    struct PeriodRow *rows = NULL;
+    int rowCount = 0;
+    int result = PERIOD_ROWS_MOVED;
+    for (int attempt = 0; attempt < 3 && result == PERIOD_ROWS_MOVED; attempt++)
+    {
+        if (attempt > 0)
+        {
+            travelIndexBuilt = false; // bookings.dat was replaced since the index last followed it
+        }
+        prepareBookingsScan();
+        refreshTravelIndex();
+        int fd = open(FILENAME, O_RDONLY);
+        if (fd < 0)
+        {
+            printf("No bookings found or error opening file.\n");
+            return;
+        }
+        result = collectPeriodRows(fd, from, to, period, &rows, &rowCount);
+        close(fd);
+    }
+    if (result != PERIOD_ROWS_COLLECTED)
+    {
+        free(rows);
+        printf("Error reading bookings file.\n");
+        return;
+    }
+
+    printf("\n+------------+----------+-----------------+--------+-----------+\n");
+    printf("| %-10s | %-8s | %-15s | %-6s | %-9s |\n", "Period", "Bookings", "Revenue", "Seats", "Occupancy");
+    printf("+------------+----------+-----------------+--------+-----------+\n");
+    long long totalBookings = 0, totalRevenue = 0;
+    for (int i = 0; i < rowCount; i++)
+    {
+        printPeriodRow(rows[i].start, from, to, period, rows[i].bookings, rows[i].revenue, rows[i].seats);
+        totalBookings += rows[i].bookings;
+        totalRevenue += rows[i].revenue;
+    }
+    free(rows);
+    printf("+------------+----------+-----------------+--------+-----------+\n");
+    printf("| Total      | %-8lld | Rs. %-11lld |        |           |\n", totalBookings, totalRevenue);
+    printf("+------------+----------+-----------------+--------+-----------+\n");
+}
+
+void generateReports()
+{
+    printf("\n+---------------------------------------------+\n");
+    printCentered("|           Reports and Analytics             |", 45);
+    printf("+---------------------------------------------+\n");
+
+    // Other counters append and modify bookings too, so the totals are only
+    // reused while bookings.dat is exactly as they were collected from
+    prepareBookingsScan();
+    struct FileVersion current;
+    readFileVersion(FILENAME, &current); // Before the scan: a change during it forces the next one
+    if (reportTotalsStale || !sameFileVersion(&current, &reportTotalsSource))
+    {
+        if (!collectReportTotals(&reportTotals))
+        {
+            printf("Error reading bookings file.\n");
+            return;
+        }
+        reportTotalsSource = current;
+        reportTotalsStale = false;
+    }
+
+    PopularDestinations(&reportTotals);
+    PopularRoutes(&reportTotals);
+    CustomerStatistics(&reportTotals);
+    RevenueStatistics(&reportTotals);
+
+    printf("+---------------------------------------------+\n");
+}
+
+void FAQ()
+{
+    const char *questions[] = {
+        "1. How do I book a return ticket?",
+        "2. Are there any discounts available on ticket bookings?",
+        "3. Can I cancel or modify my booking?",
+        "4. How can I choose my preferred seat?",
+        "5. How do I check the status of my booking?"};
+
+    const char *answers[] = {
+        "When booking a ticket, select the 'Return Ticket' option by answering 'yes' when prompted. "
+        "The system will then allow you to book a round-trip ticket.",
+
+        "Yes, you can use a promo code if you have one.",
+
+        "Yes, you can cancel or modify your booking by logging into your account and navigating to "
+        "the 'My Bookings' section. Modifications are allowed up to 24 hours before the scheduled departure time.",
+
+        "During the booking process, you will have an option to select your preferred seat if available. "
+        "Seat options vary based on the type of ticket and availability.",
+
+        "To check the status of your booking, log into your account and go to the 'My Bookings' section. "
+        "You'll see the details and status of each ticket you've booked."};
+
+    int choice;
+    do
+    {
+        printf("\n+---------------------------------------------+\n");
+        printCentered("|           Frequently Asked Questions        |", 45);
+        printf("+---------------------------------------------+\n");
+        int numFAQs = sizeof(questions) / sizeof(questions[0]);
+
+        printf("Frequently Asked Questions:\n");
+        for (int i = 0; i < numFAQs; i++)
+        {
+            printf("%s\n", questions[i]);
+        }
+
+        printf("\nEnter the number of the question you'd like more information about (0 to exit): ");
+        if (scanf("%d", &choice) != 1)
+        {
+            stopAtEndOfInput();
+            clearInputBuffer();
+            choice = -1;
+        }
+
+        if (choice > 0 && choice <= numFAQs)
+        {
+            printf("\nAnswer:\n%s\n", answers[choice - 1]);
+        }
+        else if (choice == 0)
+        {
+            printf("Exiting FAQ section.\n");
+            break;
+        }
+        else
+        {
+            printf("Invalid choice. Please enter a number between 1 and %d.\n", numFAQs);
+        }
+    } while (1);
+}
+
+void recordFeedback(int ticketID, const char* name) {
+    struct Feedback feedback;
+    feedback.ticketID = ticketID;
+    strncpy(feedback.name, name, MAX_NAME_LENGTH - 1);
+    feedback.name[MAX_NAME_LENGTH - 1] = '\0';  // Ensure null termination
+
+    // Input and validate rating
+    printf("Rate your experience (1-5): ");
+    while (scanf("%d", &feedback.rating) != 1 || feedback.rating < 1 || feedback.rating > 5) {
+        stopAtEndOfInput();
+        printf("Invalid input. Please enter a number between 1 and 5.\n");
+        clearInputBuffer();  // Clear invalid input
+        printf("Rate your experience (1-5): ");
+    }
+    clearInputBuffer();  // Clear newline after valid input
+
+    // Input feedback comments
+    printf("Enter Your Feedback (max %d characters): ", MAX_COMMENT_LENGTH - 1);
+    fgets(feedback.comments, sizeof(feedback.comments), stdin);
+    feedback.comments[strcspn(feedback.comments, "\n")] = '\0'; // Remove newline
+
+    // Save feedback to file
+    sealFeedback(&feedback);
+    if (!ioBackend->append(FEEDBACK_FILENAME, &feedback, sizeof(struct Feedback))) {
+        printf("Error writing feedback to file.\n");
+    } else {
+        printf("Thank you for your feedback!\n");
+    }
+}
+
+void displayFeedbacks() {
+    struct Feedback feedback;
+    FILE *file = openDataFile(FEEDBACK_FILENAME);
+
+    if (file == NULL) {
+        printf("+-----------------------------------------------+\n");
+        printf("| No feedbacks available.                        |\n");
+        printf("+-----------------------------------------------+\n");
+        return;
+    }
+
+    printf("\nFeedbacks:\n");
+    printf("+----------------------------------------------------------------------+\n");
+    printf("| Ticket ID | Name                | Rating |      Comments             |\n");
+    printf("+----------------------------------------------------------------------+\n");
+
+    while (readFeedback(file, &feedback)) {
+        printf("| %-10d | %-18s | %-6d | %s\n",
+               feedback.ticketID, feedback.name, feedback.rating, feedback.comments);
+    }
+    printf("+----------------------------------------------------------------------+\n");
+
+    fclose(file);
+}
+
+void displayCalendar() {
+    printf("\n +----------------------------------------------------------------------------------------------+\n");
+    printf(" | Date       | Current Location | Destination | Standard Price | VIP Price | Availability      |\n");
+    printf(" +----------------------------------------------------------------------------------------------+\n");
+
+    for (int i = 0; i < 30; i++) {
+        printf(" | %-10s | %-15s | %-11s | Rs. %-13d | Rs. %-8d | %-12s |\n",
+               tickets[i].date,
+               cityName(tickets[i].currentCityID),
+               cityName(tickets[i].destinationCityID),
+               tickets[i].standardPrice,
+               tickets[i].vipPrice,
+               tickets[i].available ? "Available" : "Sold Out");
+    }
+
+    printf(" +----------------------------------------------------------------------------------------------+\n");
+}
+
+void showSchedule()
+{
+    Initilize_Calendar();
+    displayCalendar();
+}
+
+// Asks whether to exit; exits the program on yes.
+void confirmExit()
+{
+    int exitChoice;
+    do
+    {
+        printf("Do you want to exit? (1: Yes, 0: No): ");
+        if (scanf("%d", &exitChoice) != 1 || (exitChoice != 0 && exitChoice != 1))
+        {
+            stopAtEndOfInput();
+            printf("Invalid input. Please enter 1 for Yes or 0 for No.\n");
+            clearInputBuffer();
+            continue;
+        }
+        clearInputBuffer();
+    } while (exitChoice != 0 && exitChoice != 1);
+
+    if (exitChoice == 1)
+    {
+        printf("Goodbye!\n");
+        exit(0);
+    }
+}
+
+void saveProgressAndExit()
+{
+    if (openSessionCount() > 0)
+    {
+        saveBookingProgress();
+        printf("Progress saved.\n");
+        confirmExit();
+    }
+    else
+    {
+        printf("No booking in progress to save. Goodbye!\n");
+        exit(0);
+    }
+}
+
+void exitWithoutSaving()
+{
+    printf("Exiting without saving.\n");
+    if (discardOpenSessions() > 0)
+    {
+        printf("Unsaved progress cleared.\n");
+    }
+    else
+    {
+        printf("No unsaved progress to clear.\n");
+    }
+    confirmExit();
+}
+
+void exitProgram()
+{
+    exit(0);
+}
+
+void showRedeemPoints()
+{
+    printf("Enter your name to view Reedem points: ");
+    char userName[MAX_NAME_LENGTH];
+    fgets(userName, MAX_NAME_LENGTH, stdin);
+    userName[strcspn(userName, "\n")] = 0; 
+    displayPoints(userName);
+}
+
+// Menu entries in display order. handleInput() looks the user's choice up
+// here, runs the command and loops back to the menu, so a session of any
+// length runs at constant stack depth.
+struct MenuCommand
+{
+    int choice;
+    const char *label;
+    void (*run)(void);
+};
+
+const struct MenuCommand menuCommands[] = {
+    {1, "Show Schedule", showSchedule},
+    {2, "Add/Resume Booking", addBooking},
+    {3, "Display Bookings", displayBookings},
+    {4, "Save Progress and Exit", saveProgressAndExit},
+    {5, "Exit without Saving", exitWithoutSaving},
+    {6, "Search Bookings", searchBookings},
+    {7, "Modify Booking", modifyBooking},
+    {8, "Cancel Booking", cancelBooking},
+    {9, "View Report", generateReports},
+    {10, "View Feed Backs", displayFeedbacks},
+    {11, "Display FAQ.", FAQ},
+    {12, "Exit.", exitProgram},
+    {13, "Display Reedem Points", showRedeemPoints},
+    {14, "Bulk Cancel/Reprice", bulkUpdateBookings},
+    {15, "Report by Travel Date", timeRangeReport},
+    {16, "Plan Journey", journeyPlanner},
+    {17, "Search Availability", searchAvailability},
+};
+
+const int numMenuCommands = sizeof(menuCommands) / sizeof(menuCommands[0]);
+
+void showMenu()
+{
+    char line[128];
+    printf("\n");
+    printCentered("\033[30m+-----------------------------------------------+", 120);
+    printCentered("\033[30m|           Ticket Booking System               |", 120);
+    printCentered("\033[30m+-----------------------------------------------+", 120);
+    for (int i = 0; i < numMenuCommands; i++)
+    {
+        char item[64];
+        snprintf(item, sizeof(item), "%d. %s", menuCommands[i].choice, menuCommands[i].label);
+        snprintf(line, sizeof(line), "\033[30m| %-46s|", item);
+        printCentered(line, 120);
+    }
+    printCentered("\033[30m+-----------------------------------------------+", 120);
+}
+
+const struct MenuCommand *findMenuCommand(int choice)
+{
+    for (int i = 0; i < numMenuCommands; i++)
+    {
+        if (menuCommands[i].choice == choice)
+        {
+            return &menuCommands[i];
+        }
+    }
+    return NULL;
+}
+
+// Streaming export behind --export. Records are read in chunks with pread,
+// encoded to CSV, JSON Lines or a columnar binary format by a pool of
+// threads, and written out in file order. Each thread owns one output
+// buffer and waits for its turn to write, so memory stays bounded by the
+// thread count however large the history is.
+//
+// Columnar layout (all integers little-endian):
+//   "BKCOL1\0\0", u32 column count, then per column: u8 type (1 = int64,
+//   2 = text), u16 name length, name bytes.
+//   One row group per chunk: u32 row count, then per column a u64 byte
+//   length followed by the values, int64 each or u32 length plus bytes.
+//   A row group with zero rows ends the file.
+enum ExportFormat
+{
+    EXPORT_CSV,
+    EXPORT_JSONL,
+    EXPORT_COLUMNAR
+};
+
+enum ExportColumnType
+{
+    COLUMN_INT = 1,
+    COLUMN_TEXT = 2
+};
+
+struct ExportValue
+{
+    long long number;
+    const char *text;
+    char scratch[MAX_TRAVELERS * 5 + 16]; // For text built on the fly
+};
+
+struct ExportColumn
+{
+    const char *name;
+    int type;
+};
+
+struct ExportFilter
+{
+    int modeID;            // -1 for any
+    int currentCityID;     // -1 for any
+    int destinationCityID; // -1 for any
+    int fromDay;           // Travel days in [fromDay, toDay)
+    int toDay;
+};
+
+struct ExportDataset
+{
+    const char *name;
+    const char *path;
+    size_t recordSize;
+    size_t checksumOffset;
+    const struct ExportColumn *columns;
+    int columnCount;
+    void (*column)(const void *record, int column, struct ExportValue *value);
+    bool filtered; // Whether ExportFilter applies
+};
+
+// Writes value in decimal without a terminator and returns the length.
+// Much cheaper than sprintf, which dominated encoding time.
+int formatDecimal(char *out, long long value)
+{
+    char digits[24];
+    int count = 0, length = 0;
+    unsigned long long magnitude = value < 0 ? -(unsigned long long)value : (unsigned long long)value;
+    do
+    {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0)
+    {
+        out[length++] = '-';
+    }
+    while (count > 0)
+    {
+        out[length++] = digits[--count];
+    }
+    return length;
+}
+
+const struct ExportColumn bookingColumns[] = {
+    {"ticket_id", COLUMN_INT}, {"name", COLUMN_TEXT}, {"from", COLUMN_TEXT}, {"to", COLUMN_TEXT},
+    {"mode", COLUMN_TEXT}, {"category", COLUMN_TEXT}, {"price", COLUMN_INT}, {"travelers", COLUMN_INT},
+    {"seats", COLUMN_TEXT}, {"return_ticket", COLUMN_INT}, {"created_at", COLUMN_INT}, {"travel_date", COLUMN_TEXT},
+};
+
+const struct ExportColumn feedbackColumns[] = {
+    {"ticket_id", COLUMN_INT}, {"name", COLUMN_TEXT}, {"rating", COLUMN_INT}, {"comments", COLUMN_TEXT},
+};
+
+const struct ExportColumn pointsColumns[] = {
+    {"name", COLUMN_TEXT}, {"points", COLUMN_INT},
+};
+
+void bookingColumn(const void *record, int column, struct ExportValue *value)
+{
+    const struct Booking *booking = record;
+    switch (column)
+    {
+    case 0: value->number = booking->ticketID; break;
+    case 1: value->text = booking->name; break;
+    case 2: value->text = cityName(booking->currentCityID); break;
+    case 3: value->text = cityName(booking->destinationCityID); break;
+    case 4: value->text = modeName(booking->modeID); break;
+    case 5: value->text = categoryName(booking->categoryID); break;
+    case 6: value->number = booking->price; break;
+    case 7: value->number = booking->numTravelers; break;
+    case 8:
+    {
+        int length = 0;
+        int seats[MAX_TRAVELERS];
+        int seatCount = bookingSeats(booking, seats);
+        for (int i = 0; i < seatCount; i++)
+        {
+            if (i > 0)
+            {
+                value->scratch[length++] = ' ';
             }
-            partial.booking.name[strcspn(partial.booking.name, "\n")] = 0; // Remove newline
-            if (strcmp(partial.booking.name, "pause") == 0)
+            length += formatDecimal(value->scratch + length, seats[i]);
+        }
+        value->scratch[length] = '\0';
+        value->text = value->scratch;
+        break;
+    }
+    case 9: value->number = booking->returnTicket; break;
+    case 10: value->number = booking->createdAt; break;
+    case 11:
+    {
+        int year, month, day;
+        civilFromDays(booking->travelDate / SECONDS_PER_DAY, &year, &month, &day);
+        char *out = value->scratch;
+        out += formatDecimal(out, year);
+        *out++ = '-';
+        *out++ = '0' + month / 10;
+        *out++ = '0' + month % 10;
+        *out++ = '-';
+        *out++ = '0' + day / 10;
+        *out++ = '0' + day % 10;
+        *out = '\0';
+        value->text = value->scratch;
+        break;
+    }
+    }
+}
+
+void feedbackColumn(const void *record, int column, struct ExportValue *value)
+{
+    const struct Feedback *feedback = record;
+    switch (column)
+    {
+    case 0: value->number = feedback->ticketID; break;
+    case 1: value->text = feedback->name; break;
+    case 2: value->number = feedback->rating; break;
+    case 3: value->text = feedback->comments; break;
+    }
+}
+
+void pointsColumn(const void *record, int column, struct ExportValue *value)
+{
+    const struct User *user = record;
+    if (column == 0)
+    {
+        value->text = user->name;
+    }
+    else
+    {
+        value->number = user->points;
+    }
+}
+
+const struct ExportDataset exportDatasets[] = {
+    {"bookings", FILENAME, sizeof(struct Booking), offsetof(struct Booking, checksum), bookingColumns,
+     sizeof(bookingColumns) / sizeof(bookingColumns[0]), bookingColumn, true},
+    {"feedbacks", FEEDBACK_FILENAME, sizeof(struct Feedback), offsetof(struct Feedback, checksum), feedbackColumns,
+     sizeof(feedbackColumns) / sizeof(feedbackColumns[0]), feedbackColumn, false},
+    {"points", POINTS_FILENAME, sizeof(struct User), offsetof(struct User, checksum), pointsColumns,
+     sizeof(pointsColumns) / sizeof(pointsColumns[0]), pointsColumn, false},
+};
+
+bool exportFilterMatches(const struct ExportFilter *filter, const struct Booking *booking)
+{
+    int day = booking->travelDate / SECONDS_PER_DAY;
+    return (filter->modeID < 0 || booking->modeID == filter->modeID) &&
+           (filter->currentCityID < 0 || booking->currentCityID == filter->currentCityID) &&
+           (filter->destinationCityID < 0 || booking->destinationCityID == filter->destinationCityID) &&
+           day >= filter->fromDay && day < filter->toDay;
+}
+
+struct ExportBuffer
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+void exportReserve(struct ExportBuffer *buffer, size_t extra)
+{
+    if (buffer->length + extra > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : 1 << 20;
+        while (capacity < buffer->length + extra)
+        {
+            capacity *= 2;
+        }
+        char *data = realloc(buffer->data, capacity);
+        if (data == NULL)
+        {
+            perror("export");
+            exit(1);
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+}
+
+void exportBytes(struct ExportBuffer *buffer, const void *bytes, size_t size)
+{
+    exportReserve(buffer, size);
+    memcpy(buffer->data + buffer->length, bytes, size);
+    buffer->length += size;
+}
+
+void exportNumber(struct ExportBuffer *buffer, long long number)
+{
+    exportReserve(buffer, 24);
+    buffer->length += formatDecimal(buffer->data + buffer->length, number);
+}
+
+void exportLittleEndian(struct ExportBuffer *buffer, unsigned long long value, int bytes)
+{
+    exportReserve(buffer, bytes);
+    for (int i = 0; i < bytes; i++)
+    {
+        buffer->data[buffer->length++] = (char)(value >> (8 * i));
+    }
+}
+
+// CSV field, quoted only when it contains a separator, quote or newline.
+void exportCsvText(struct ExportBuffer *buffer, const char *text)
+{
+    if (strpbrk(text, ",\"\r\n") == NULL)
+    {
+        exportBytes(buffer, text, strlen(text));
+        return;
+    }
+    exportBytes(buffer, "\"", 1);
+    for (const char *c = text; *c != '\0'; c++)
+    {
+        exportBytes(buffer, c, 1);
+        if (*c == '"')
+        {
+            exportBytes(buffer, "\"", 1);
+        }
+    }
+    exportBytes(buffer, "\"", 1);
+}
+
+void exportJsonText(struct ExportBuffer *buffer, const char *text)
+{
+    exportBytes(buffer, "\"", 1);
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++)
+    {
+        size_t plain = 0;
+        while (c[plain] >= 0x20 && c[plain] != '"' && c[plain] != '\\')
+        {
+            plain++;
+        }
+        if (plain > 0)
+        {
+            exportBytes(buffer, c, plain); // Copy runs that need no escaping in one go
+            c += plain - 1;
+        }
+        else if (*c == '"' || *c == '\\')
+        {
+            char escaped[2] = {'\\', (char)*c};
+            exportBytes(buffer, escaped, 2);
+        }
+        else
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", *c); // Control character
+            exportBytes(buffer, escaped, 6);
+        }
+    }
+    exportBytes(buffer, "\"", 1);
+}
+
+// Encodes rows (already filtered) as one CSV/JSONL block or one row group.
+void encodeExportRows(const struct ExportDataset *dataset, int format, const char *rows, int rowCount, struct ExportBuffer *out)
+{
+    struct ExportValue value;
+    if (format == EXPORT_COLUMNAR)
+    {
+        exportLittleEndian(out, rowCount, 4);
+        for (int c = 0; c < dataset->columnCount; c++)
+        {
+            size_t lengthAt = out->length;
+            exportLittleEndian(out, 0, 8); // Filled in below
+            for (int r = 0; r < rowCount; r++)
             {
-                savePartialBooking(&partial);
-                printf("Booking paused. You can resume later.\n");
-                return;
+                dataset->column(rows + r * dataset->recordSize, c, &value);
+                if (dataset->columns[c].type == COLUMN_INT)
+                {
+                    exportLittleEndian(out, value.number, 8);
+                }
+                else
+                {
+                    size_t length = strlen(value.text);
+                    exportLittleEndian(out, length, 4);
+                    exportBytes(out, value.text, length);
+                }
             }
-            if (!isValidName(partial.booking.name))
+            unsigned long long sectionLength = out->length - lengthAt - 8;
+            for (int i = 0; i < 8; i++)
             {
-                printf("Error: Invalid name. Please use only alphabets and spaces.\n");
-                continue;
-            }
-            break;
-        } while (1);
-        partial.stage = 2;
+                out->data[lengthAt + i] = (char)(sectionLength >> (8 * i));
+            }
+        }
+        return;
     }
-    printf("\n");
-    if (!resuming || partial.stage <= 2)
-    {
 
-        int currentChoice;
-        char returnChoice[4]; // return ticket implementation
-        do
+    for (int r = 0; r < rowCount; r++)
+    {
+        const char *record = rows + r * dataset->recordSize;
+        if (format == EXPORT_JSONL)
         {
-            printf("Do you want return ticket(yes or no) : ");
-            if (fgets(returnChoice, sizeof(returnChoice), stdin) == NULL)
+            exportBytes(out, "{", 1);
+        }
+        for (int c = 0; c < dataset->columnCount; c++)
+        {
+            dataset->column(record, c, &value);
+            if (format == EXPORT_JSONL)
             {
-                printf("Error: Failed to read input. Please try again.\n");
-                continue;
+                if (c > 0)
+                {
+                    exportBytes(out, ",", 1);
+                }
+                exportJsonText(out, dataset->columns[c].name);
+                exportBytes(out, ":", 1);
             }
-
-            // Remove newline character that fgets adds
-            returnChoice[strcspn(returnChoice, "\n")] = '\0';
-            if (strcmp(returnChoice, "yes") == 0)
+            else if (c > 0)
             {
-                partial.booking.returnTicket = true;
-                printf("Return ticket selected.\n");
-                break;
+                exportBytes(out, ",", 1);
             }
-            else if (strcmp(returnChoice, "no") == 0)
+            if (dataset->columns[c].type == COLUMN_INT)
             {
-                partial.booking.returnTicket = false;
-                printf("One-way ticket selected.\n");
-                break;
+                exportNumber(out, value.number);
+            }
+            else if (format == EXPORT_JSONL)
+            {
+                exportJsonText(out, value.text);
             }
             else
             {
-                printf("Invalid input. Please enter 'yes' or 'no'.\n");
+                exportCsvText(out, value.text);
             }
+        }
+        exportBytes(out, format == EXPORT_JSONL ? "}\n" : "\n", format == EXPORT_JSONL ? 2 : 1);
+    }
+}
 
-        } while (1);
-        // Current Location Input
-        printf("Enter your current location:\n");
-        for (int i = 0; i < numCities; i++)
+struct ExportJob
+{
+    const struct ExportDataset *dataset;
+    const struct ExportFilter *filter;
+    int format;
+    int inputFd;
+    int outputFd;
+    long long totalRecords;
+    long long nextChunk;   // Next chunk to claim, taken atomically
+    long long writeTurn;   // Chunk whose output goes next
+    long long exported;
+    bool failed;
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+};
+
+bool writeAll(int fd, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = write(fd, data, size);
+        if (n <= 0)
         {
-            printf("%d. %s\n", i + 1, indianCities[i]);
+            return false;
         }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
 
-        do
+void *exportWorker(void *arg)
+{
+    struct ExportJob *job = arg;
+    const struct ExportDataset *dataset = job->dataset;
+    char *records = malloc(SCAN_CHUNK_RECORDS * dataset->recordSize);
+    struct ExportBuffer out = {0};
+    if (records == NULL)
+    {
+        job->failed = true;
+        return NULL;
+    }
+
+    while (1)
+    {
+        long long chunk = __atomic_fetch_add(&job->nextChunk, 1, __ATOMIC_RELAXED);
+        long long first = chunk * SCAN_CHUNK_RECORDS;
+        if (first >= job->totalRecords)
         {
-            printf("Enter the number of your current location (1-%d), or 0 to pause: ", numCities);
-            if (scanf("%d", &currentChoice) != 1 || currentChoice < 0 || currentChoice > numCities)
-            {
-                printf("Error: Invalid choice. Please enter a number between 0 and %d.\n", numCities);
-                clearInputBuffer();
-                continue;
-            }
-            if (currentChoice == 0)
-            {
-                savePartialBooking(&partial);
-                printf("Booking paused. You can resume later.\n");
-                return;
-            }
             break;
-        } while (1);
-
-        strcpy(partial.booking.currentLocation, indianCities[currentChoice - 1]);
-        addRoute(partial.booking.currentLocation, ""); // Add route initialization
-        clearInputBuffer();
-
-        int choice;
-        printf("\n");
-        // Destination Input
-        printf("Select Destination:\n");
-        for (int i = 0; i < numCities; i++)
+        }
+        long long count = job->totalRecords - first;
+        if (count > SCAN_CHUNK_RECORDS)
         {
-            printf("%d. %s\n", i + 1, indianCities[i]);
+            count = SCAN_CHUNK_RECORDS;
         }
 
-        do
+        size_t wanted = count * dataset->recordSize, got = 0;
+        while (got < wanted)
         {
-            printf("Enter the number of your destination (1-%d), or 0 to pause: ", numCities);
-            if (scanf("%d", &choice) != 1 || choice < 0 || choice > numCities)
-            {
-                printf("Error: Invalid choice. Please enter a number between 0 and %d.\n", numCities);
-                clearInputBuffer();
-                continue;
-            }
-            if (choice == 0)
+            ssize_t n = pread(job->inputFd, records + got, wanted - got, recordOffset(first, dataset->recordSize) + got);
+            if (n <= 0)
             {
-                savePartialBooking(&partial);
-                printf("Booking paused. You can resume later.\n");
-                return;
+                break;
             }
-            break;
-        } while (1);
-        printf("\n");
-        // Check for same pickup and destination
-        if (currentChoice - 1 == choice - 1)
-        {
-            printf("Pickup point and destination cannot be the same.\n");
-            return;
+            got += n;
         }
 
-        strcpy(partial.booking.destination, indianCities[choice - 1]);
-
-        // Add the route for new booking
-        addRoute(partial.booking.currentLocation, partial.booking.destination);
-
-        clearInputBuffer();
-
-        int n;
-        printf("\n");
-        do
+        // Compact the kept rows to the front of the chunk
+        int kept = 0;
+        for (long long i = 0; i < (long long)(got / dataset->recordSize); i++)
         {
-            // Traveler Count Input
-            printf("Enter how many travelers: ");
-            if (scanf("%d", &n) != 1 || n <= 0)
+            char *record = records + i * dataset->recordSize;
+            if (!recordIntact(record, dataset->recordSize, dataset->checksumOffset) ||
+                (dataset->filtered && !exportFilterMatches(job->filter, (const struct Booking *)record)))
             {
-                printf("Invalid input. Please enter a valid number of travelers (greater than zero).\n");
-                clearInputBuffer();
+                continue;
             }
-            else
+            if (kept != i)
             {
-                break;
+                memcpy(records + kept * dataset->recordSize, record, dataset->recordSize);
             }
-        } while (1);
-        clearInputBuffer();
-
-        int categoryChoice;
-        printf("\n");
-        // Ticket Category Selection
-        printf("Select Ticket Category:\n");
-        for (int i = 0; i < sizeof(ticketCategories) / sizeof(ticketCategories[0]); i++)
+            kept++;
+        }
+        out.length = 0;
+        if (kept > 0)
         {
-            printf("%d. %s\n", i + 1, ticketCategories[i]);
+            encodeExportRows(dataset, job->format, records, kept, &out);
         }
-        printf("\n");
-        do
+
+        pthread_mutex_lock(&job->lock);
+        while (job->writeTurn != chunk)
         {
-            printf("Enter the number of your selected category (1-%ld): ", sizeof(ticketCategories) / sizeof(ticketCategories[0]));
-            if (scanf("%d", &categoryChoice) != 1 || categoryChoice < 1 || categoryChoice > sizeof(ticketCategories) / sizeof(ticketCategories[0]))
-            {
-                printf("Error: Invalid choice. Please enter a number between 1 and %ld.\n", sizeof(ticketCategories) / sizeof(ticketCategories[0]));
-                clearInputBuffer();
-                continue;
-            }else{
-                strcpy(partial.booking.category, ticketCategories[categoryChoice - 1]);
-            }
-            break;
-        } while (1);
-     
-        // Initialize booked seats to 0
-        for (int i = 0; i < MAX_SEATS; i++)
+            pthread_cond_wait(&job->turn, &job->lock);
+        }
+        pthread_mutex_unlock(&job->lock);
+        // Only the thread whose turn it is gets here, so the write needs no lock
+        if (!job->failed && !writeAll(job->outputFd, out.data, out.length))
         {
-            partial.booking.seats[i] = 0; // Initialize unbooked seats with 0
+            job->failed = true;
         }
+        pthread_mutex_lock(&job->lock);
+        job->exported += kept;
+        job->writeTurn++;
+        pthread_cond_broadcast(&job->turn);
+        pthread_mutex_unlock(&job->lock);
+    }
 
-        for (int i = 0; i < n; i++)
+    free(out.data);
+    free(records);
+    return NULL;
+}
+
+bool exportData(const char *datasetName, const char *formatName, const char *outputPath, const struct ExportFilter *filter)
+{
+    const struct ExportDataset *dataset = NULL;
+    for (int i = 0; i < (int)(sizeof(exportDatasets) / sizeof(exportDatasets[0])); i++)
+    {
+        if (strcmp(exportDatasets[i].name, datasetName) == 0)
         {
-            int seatNum;
-            displayAvailableSeats(partial.booking.currentLocation, partial.booking.destination); // Show available seats before booking
-            do
-            {
-                printf("Enter seat number for traveler %d: ", i + 1);
-                if (scanf("%d", &seatNum) != 1 || seatNum < 1 || seatNum > MAX_SEATS || !isSeatAvailableForRoute(partial.booking.currentLocation, partial.booking.destination, seatNum))
-                {
-                    printf("Error: Invalid or unavailable seat number. Please select an available seat (1-%d).\n", MAX_SEATS);
-                    clearInputBuffer();
-                    continue;
-                }
-                break;
-            } while (1);
-            partial.booking.seats[i] = seatNum;                                                   // Store the booked seat number
-            bookSeatRoute(partial.booking.currentLocation, partial.booking.destination, seatNum); // Mark seat as booked
+            dataset = &exportDatasets[i];
         }
+    }
+    int format = strcmp(formatName, "csv") == 0 ? EXPORT_CSV : strcmp(formatName, "jsonl") == 0 ? EXPORT_JSONL
+                                                          : strcmp(formatName, "columnar") == 0 ? EXPORT_COLUMNAR : -1;
+    if (dataset == NULL || format < 0)
+    {
+        fprintf(stderr, "Error: Unknown dataset or format. Use bookings, feedbacks or points and csv, jsonl or columnar.\n");
+        return false;
+    }
 
-        if (Transport_Choice == 1) { 
-            
-             if (partial.booking.returnTicket) {
-                partial.booking.price = (busPrices[currentChoice - 1][categoryChoice - 1]) * 2; 
-            } 
-            else {
-              partial.booking.price = busPrices[currentChoice - 1][categoryChoice - 1]; 
-            }
-            
-       } else { 
-            
-             if (partial.booking.returnTicket) {
-                 partial.booking.price = (ticketPrices[currentChoice - 1][categoryChoice - 1]) * 2;
-           } 
-             else {
-                partial.booking.price = ticketPrices[currentChoice - 1][categoryChoice - 1];
-           }
-        }
+    if (!dataset->filtered && (filter->modeID >= 0 || filter->currentCityID >= 0 ||
+                               filter->fromDay != -2147483647 - 1 || filter->toDay != 2147483647))
+    {
+        fprintf(stderr, "Error: Filters only apply to bookings.\n");
+        return false;
+    }
 
-        clearInputBuffer();
-        do
-        {
-            char promoChoice[4];
-            char enteredCode[20];
-            printf("Do you want to add Promo Code(yes or no) : ");
-            if (fgets(promoChoice, sizeof(promoChoice), stdin) == NULL)
-            {
-                printf("Error: Failed to read input. Please try again.\n");
-                continue;
-            }
+    struct ExportJob job = {.dataset = dataset, .filter = filter, .format = format, .inputFd = -1, .outputFd = STDOUT_FILENO};
+    if (strcmp(dataset->path, FILENAME) == 0)
+    {
+        prepareBookingsView();
+    }
+    job.inputFd = open(dataset->path, O_RDONLY);
+    struct stat st;
+    if (job.inputFd >= 0 && fstat(job.inputFd, &st) == 0 && dataHeaderCurrent(job.inputFd, dataset->path))
+    {
+        job.totalRecords = recordCount(st.st_size, dataset->recordSize);
+    }
+    if (outputPath != NULL && (job.outputFd = open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+        fprintf(stderr, "Error: Unable to write %s.\n", outputPath);
+        return false;
+    }
 
-            // Remove newline character that fgets adds
-            promoChoice[strcspn(promoChoice, "\n")] = '\0';
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
 
-            struct PromoCode promoCodes[] = {{"CLUBGAMMA", 20}, {"CHARUSAT", 15}, {"HECTOBERFEST", 10}};
-            int numCodes = sizeof(promoCodes) / sizeof(promoCodes[0]);
-            int promoApplied = 0;
-            if (strcmp(promoChoice, "yes") == 0)
-            {
-                printf("Enter promotional code: ");
-                scanf("%s", enteredCode);
-                for (int i = 0; i < numCodes; i++)
-                {
-                    if (strcmp(enteredCode, promoCodes[i].code) == 0)
-                    {
-                        int discountAmount = partial.booking.price * (promoCodes[i].discount / 100.0);
-                        partial.booking.price -= discountAmount;
-                        printf("Promotional code applied! Discount: %d%%\n", promoCodes[i].discount);
-                        printf("New price after discount: %d\n", partial.booking.price);
-                        promoApplied = 1;
-                        break;
-                    }
-                }
-                if (!promoApplied)
-                {
-                    printf("Invalid promotional code.\n");
-                    continue;
-                }
-                break;
-            }
-            else if (strcmp(promoChoice, "no") == 0)
-            {
-                break;
-            }
-            else
-            {
-                printf("Invalid input. Please enter 'yes' or 'no'.\n");
-            }
-        } while (1);
+    struct ExportBuffer header = {0};
+    if (format == EXPORT_COLUMNAR)
+    {
+        exportBytes(&header, "BKCOL1\0\0", 8);
+        exportLittleEndian(&header, dataset->columnCount, 4);
+        for (int c = 0; c < dataset->columnCount; c++)
+        {
+            exportLittleEndian(&header, dataset->columns[c].type, 1);
+            exportLittleEndian(&header, strlen(dataset->columns[c].name), 2);
+            exportBytes(&header, dataset->columns[c].name, strlen(dataset->columns[c].name));
+        }
+    }
+    else if (format == EXPORT_CSV)
+    {
+        for (int c = 0; c < dataset->columnCount; c++)
+        {
+            exportBytes(&header, c ? "," : "", c ? 1 : 0);
+            exportBytes(&header, dataset->columns[c].name, strlen(dataset->columns[c].name));
+        }
+        exportBytes(&header, "\n", 1);
+    }
+    job.failed = !writeAll(job.outputFd, header.data, header.length);
+    free(header.data);
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+    int threads = scanThreadCount(job.totalRecords);
+    pthread_t tids[MAX_SCAN_THREADS];
+    int started_threads = 0;
+    for (int i = 1; i < threads; i++)
+    {
+        if (pthread_create(&tids[started_threads], NULL, exportWorker, &job) == 0)
+        {
+            started_threads++;
+        }
+    }
+    exportWorker(&job);
+    for (int i = 0; i < started_threads; i++)
+    {
+        pthread_join(tids[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.turn);
 
-         
-        // Display summary before finalizing booking
-        printBookingSummary(&partial, n); // Improved summary display
+    if (format == EXPORT_COLUMNAR && !job.failed)
+    {
+        char end[4] = {0}; // Empty row group
+        job.failed = !writeAll(job.outputFd, end, sizeof(end));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    off_t written = lseek(job.outputFd, 0, SEEK_CUR);
+    if (job.inputFd >= 0)
+    {
+        close(job.inputFd);
+    }
+    if (outputPath != NULL)
+    {
+        close(job.outputFd);
+    }
 
-        char confirm[10];
+    double seconds = (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1e9;
+    fprintf(stderr, "Exported %lld %s record(s)", job.exported, dataset->name);
+    if (written > 0 && seconds > 0)
+    {
+        fprintf(stderr, ", %.1f MB at %.1f MB/s", written / 1e6, written / 1e6 / seconds);
+    }
+    fprintf(stderr, "\n");
+    if (job.failed)
+    {
+        fprintf(stderr, "Error: Export failed.\n");
+    }
+    return !job.failed;
+}
 
-        printf("\n");
-        do
+// Builds an export filter from the command-line values; NULL means no
+// restriction. route is FROM:TO using city names.
+bool parseExportFilter(const char *mode, const char *route, const char *since, const char *until, struct ExportFilter *filter)
+{
+    filter->modeID = -1;
+    filter->currentCityID = -1;
+    filter->destinationCityID = -1;
+    filter->fromDay = -2147483647 - 1;
+    filter->toDay = 2147483647;
+
+    if (mode != NULL && (filter->modeID = lookupName(CATALOG_MODE, mode)) < 0)
+    {
+        fprintf(stderr, "Error: Unknown mode %s.\n", mode);
+        return false;
+    }
+    if (route != NULL)
+    {
+        char from[MAX_DESTINATION_LENGTH];
+        const char *separator = strchr(route, ':');
+        if (separator == NULL || separator - route >= MAX_DESTINATION_LENGTH)
+        {
+            fprintf(stderr, "Error: Routes are given as FROM:TO.\n");
+            return false;
+        }
+        snprintf(from, sizeof(from), "%.*s", (int)(separator - route), route);
+        filter->currentCityID = lookupName(CATALOG_CITY, from);
+        filter->destinationCityID = lookupName(CATALOG_CITY, separator + 1);
+        if (filter->currentCityID < 0 || filter->destinationCityID < 0)
         {
-            printf("Do you want to confirm this booking? (yes/no): ");
-            if (fgets(confirm, sizeof(confirm), stdin) == NULL)
-            {
-                printf("Error: Failed to read input. Please try again.\n");
-                continue; // Retry prompt in case of error
-            }
+            fprintf(stderr, "Error: Unknown city in route %s.\n", route);
+            return false;
+        }
+    }
+    if ((since != NULL && !parseDate(since, &filter->fromDay)) || (until != NULL && !parseDate(until, &filter->toDay)))
+    {
+        fprintf(stderr, "Error: Dates are given as YYYY-MM-DD.\n");
+        return false;
+    }
+    return true;
+}
 
-            // Remove newline character that fgets adds
-            confirm[strcspn(confirm, "\n")] = '\0';
+// Conversion of data files written before the file header. A headerless
+// file's layout is recognised from its records: every layout the file may
+// hold is tried and the one most records check out under wins, by checksum
+// where the layout has one and by plausible field values where it does not.
+// Records are copied into the current layout and resealed; any that cannot
+// be converted are kept, byte for byte, in a .unconverted file next to it.
+//
+// bookings.dat layouts: 0 names cities, mode and category as text, 1 keeps
+// catalog IDs and a plain seat array instead, 2 adds the checksum, 3 adds the creation and travel dates and a version, 4 keeps
+// seats as runs. reedem_points.dat and feedbacks.dat: 1 without, 2 with the
+// checksum.
+#define LEGACY_SEATS 50 // Seat array of booking layouts 0 to 3
+
+enum RecordConversion
+{
+    RECORD_NOT_LAYOUT,  // Does not look like a record of the layout
+    RECORD_CONVERTED,
+    RECORD_KEPT_ASIDE   // Of the layout but not representable in the current one
+};
 
-            for (int i = 0; confirm[i]; i++)
-            {
-                confirm[i] = tolower(confirm[i]);
-            }
+struct LegacyLayout
+{
+    unsigned int layout;
+    size_t size;
+    long checksumOffset; // -1 for layouts from before checksums
+    int (*convert)(const void *record, void *converted);
+};
 
-            if (strcmp(confirm, "yes") == 0)
-            {
-                // Mark the seats as booked
-                for (int j = 0; j < n; j++)
-                {
-                    bookSeatRoute(partial.booking.currentLocation, partial.booking.destination, partial.booking.seats[j]);
-                }
+// The fields booking layouts 1 to 3 share, in their order.
+struct LegacyBookingFields
+{
+    int ticketID;
+    char name[MAX_NAME_LENGTH];
+    short currentCityID;
+    short destinationCityID;
+    int price;
+    unsigned char categoryID;
+    unsigned char modeID;
+    int seats[LEGACY_SEATS];
+    int bookedSeat;
+    bool returnTicket;
+    int numTravelers;
+};
 
-                int totalBookingPrice = partial.booking.price; 
+struct LegacyBooking
+{
+    struct LegacyBookingFields fields;
+    unsigned int checksum; // Layout 2 only
+};
 
-                 update_reedem_Points(partial.booking.name, partial.booking.price);
-                 int currentPoints = getPoints(partial.booking.name);
-                 printf("Your current Reedem points: %d\n", currentPoints);
+struct LegacyDatedBooking // Layout 3
+{
+    struct LegacyBookingFields fields;
+    long long createdAt;
+    long long travelDate;
+    unsigned int checksum;
+    unsigned int version;
+};
 
-                 int pointsToRedeem;
-                 printf("Do you want to redeem Rddem points? (Enter points to redeem, 0 to skip): ");
-                 scanf("%d", &pointsToRedeem);
-                 clearInputBuffer();
+// Layout 0, the original record. numTravelers and bookedSeat were only set
+// by Modify Booking, so the travellers are counted from the seats.
+struct LegacyNamedBooking
+{
+    int ticketID;
+    char name[MAX_NAME_LENGTH];
+    char currentLocation[MAX_NAME_LENGTH];
+    char destination[MAX_NAME_LENGTH];
+    int price;
+    char category[MAX_NAME_LENGTH];
+    int seats[LEGACY_SEATS];
+    int bookedSeat;
+    bool returnTicket;
+    char mode[MAX_NAME_LENGTH];
+    int numTravelers;
+};
 
-                 if (pointsToRedeem > currentPoints) {
-                 printf("Error: You cannot reedem more points than you have. Available points: %d\n", currentPoints);
-                 pointsToRedeem = 0; 
-               }
+_Static_assert(sizeof(struct LegacyNamedBooking) == 472 && sizeof(struct LegacyBooking) == 284 &&
+                   sizeof(struct LegacyDatedBooking) == 304 &&
+                   offsetof(struct LegacyDatedBooking, checksum) == 296,
+               "Legacy booking layouts must keep their on-disk sizes");
 
-                 if (pointsToRedeem > 0) {
-                      int redeemedPoints = RedeemPoints(partial.booking.name, pointsToRedeem);
-                           if (redeemedPoints > 0) {
-                                 partial.booking.price -= redeemedPoints * 100; 
-                                 printf("Reedem points redeemed successfully! New price: Rs. %d\n", partial.booking.price);
-                           } else {
-                                 printf("Insufficient Reedem points or error reedeming points.\n");
-                           }
-                }
-                
-                FILE *file = fopen(FILENAME, "ab");
-                if (file == NULL)
-                {
-                    printf("Error: Unable to open bookings file. Booking not saved.\n");
-                    return;
-                }
+struct LegacyUser
+{
+    char name[MAX_NAME_LENGTH];
+    int points;
+};
 
-                if (fwrite(&partial.booking, sizeof(struct Booking), 1, file) != 1)
-                {
-                    printf("Error: Failed to write booking data. Please try again.\n");
-                }
-                else
-                {
-                    generateReferenceNumber(bookingReference, partial.booking.ticketID);
-                    recordFeedback(partial.booking.ticketID, partial.booking.name);
-                    printf("\nBooking added successfully!\n");
+struct LegacyFeedback
+{
+    int ticketID;
+    char name[MAX_NAME_LENGTH];
+    int rating;
+    char comments[MAX_COMMENT_LENGTH];
+};
 
-                    const int width = 90;
-                    printf("\n");
+bool textTerminated(const char *text, size_t size)
+{
+    return memchr(text, '\0', size) != NULL;
+}
 
-                    // Receipt
-                    printCentered("+----------------------------------------------+", 50);
-                    printCentered("|                   Receipt                    |", 50);
-                    printCentered("+----------------------------------------------+", 50);
-                    printf(" | Ticket ID: %-33d |\n", partial.booking.ticketID);
-                    printf(" | Name: %-38s |\n", partial.booking.name);
-                    printf(" | Current Location: %-26s |\n", partial.booking.currentLocation);
-                    printf(" | Destination: %-31s |\n", partial.booking.destination);
-                    printf(" | Number of Travelers: %-23d |\n", n);
-                    printf(" | Category: %-34s |\n", partial.booking.category);
-                    printf("| Seats Booked: ");
-                    for (int j = 0; j < n; j++)
-                    {
-                        printf("%d ", partial.booking.seats[j]);
-                    }
-                    printf("%lu |\n", (width - strlen("| Seats Booked: ") - (n * 2) - 1), ""); // Calculate space to keep in line
-                    printf(" | Price: Rs. %-32d  |\n", partial.booking.price);
-                    printCentered("+----------------------------------------------+", 50);
-                }
-                fclose(file);
+// Fills booking from the fields layouts 1 to 3 share, without sealing it.
+int convertLegacyBookingFields(const struct LegacyBookingFields *old, struct Booking *booking)
+{
+    int numCategories = sizeof(ticketCategories) / sizeof(ticketCategories[0]);
+    if (!textTerminated(old->name, sizeof(old->name)) ||
+        old->currentCityID < 0 || old->currentCityID >= numCities ||
+        old->destinationCityID < 0 || old->destinationCityID >= numCities ||
+        (old->modeID != MODE_BUS && old->modeID != MODE_TRAIN) || old->categoryID >= numCategories ||
+        old->numTravelers < 1 || old->numTravelers > LEGACY_SEATS)
+    {
+        return RECORD_NOT_LAYOUT;
+    }
+    for (int i = 0; i < old->numTravelers; i++)
+    {
+        if (old->seats[i] < 1 || old->seats[i] > MAX_ROUTE_SEATS)
+        {
+            return RECORD_NOT_LAYOUT;
+        }
+    }
 
-                // Clear partial booking
-                partial.inProgress = false;
-                savePartialBooking(&partial);
-                remove(PROGRESS_FILENAME);
-                break;
-            }
-            else if (strcmp(confirm, "no") == 0)
-            {
+    memset(booking, 0, sizeof(*booking));
+    if (old->numTravelers > MAX_TRAVELERS || !setBookingSeats(booking, old->seats, old->numTravelers))
+    {
+        return RECORD_KEPT_ASIDE;
+    }
+    booking->ticketID = old->ticketID;
+    memcpy(booking->name, old->name, sizeof(booking->name));
+    booking->currentCityID = old->currentCityID;
+    booking->destinationCityID = old->destinationCityID;
+    booking->price = old->price;
+    booking->categoryID = old->categoryID;
+    booking->modeID = old->modeID;
+    booking->bookedSeat = old->bookedSeat;
+    booking->returnTicket = old->returnTicket;
+    booking->numTravelers = old->numTravelers;
+    return RECORD_CONVERTED;
+}
 
-                for (int j = 0; j < n; j++)
-                {
-                    freeSeatRoute(partial.booking.currentLocation, partial.booking.destination, partial.booking.seats[j]);
-                }
-                printf("Booking cancelled. You can make changes or start over.\n");
-                return;
-            }
-            else
-            {
-                printf("Invalid input. Please enter 'yes' or 'no'.\n");
-            }
+int convertLegacyBooking(const void *record, void *converted)
+{
+    const struct LegacyBooking *old = record;
+    int result = convertLegacyBookingFields(&old->fields, converted);
+    if (result == RECORD_CONVERTED)
+    {
+        sealBooking(converted); // No timestamps: they read as unknown
+    }
+    return result;
+}
 
-        } while (1);
+int convertLegacyDatedBooking(const void *record, void *converted)
+{
+    const struct LegacyDatedBooking *old = record;
+    struct Booking *booking = converted;
+    int result = convertLegacyBookingFields(&old->fields, booking);
+    if (result == RECORD_CONVERTED)
+    {
+        booking->createdAt = old->createdAt;
+        booking->travelDate = old->travelDate;
+        booking->version = old->version;
+        sealBooking(booking);
     }
+    return result;
 }
 
-int getPoints(const char* userName) {
-    struct User user;
-    FILE *file = fopen("reedem_points.dat", "rb");
-    if (file == NULL) {
-        file = fopen("reedem_points.dat", "wb");
-        if (file == NULL) {
-            printf("Error: Unable to create reedem points file.\n");
-            return 0;
-        }
-        fclose(file);
-        return 0;
+// Names are looked up in the catalogs, so initializeCatalogs() must have run.
+// A record naming anything outside them is not taken as layout 0.
+int convertLegacyNamedBooking(const void *record, void *converted)
+{
+    const struct LegacyNamedBooking *old = record;
+    if (!textTerminated(old->name, sizeof(old->name)) ||
+        !textTerminated(old->currentLocation, sizeof(old->currentLocation)) ||
+        !textTerminated(old->destination, sizeof(old->destination)) ||
+        !textTerminated(old->category, sizeof(old->category)) || !textTerminated(old->mode, sizeof(old->mode)))
+    {
+        return RECORD_NOT_LAYOUT;
+    }
+    int currentCityID = lookupName(CATALOG_CITY, old->currentLocation);
+    int destinationCityID = lookupName(CATALOG_CITY, old->destination);
+    int categoryID = lookupName(CATALOG_CATEGORY, old->category);
+    int modeID = lookupName(CATALOG_MODE, old->mode);
+    if (currentCityID < 0 || destinationCityID < 0 || categoryID < 0 || modeID < 0)
+    {
+        return RECORD_NOT_LAYOUT;
     }
 
-    while (fread(&user, sizeof(struct User), 1, file) == 1) {
-        if (strcmp(user.name, userName) == 0) {
-            fclose(file);
-            return user.points;
+    struct LegacyBookingFields fields;
+    memset(&fields, 0, sizeof(fields));
+    for (int i = 0; i < LEGACY_SEATS; i++)
+    {
+        if (old->seats[i] != 0) // Cancelled travellers leave zeros behind
+        {
+            fields.seats[fields.numTravelers++] = old->seats[i];
         }
     }
-
-    fclose(file);
-    return 0; 
+    fields.ticketID = old->ticketID;
+    memcpy(fields.name, old->name, sizeof(fields.name));
+    fields.currentCityID = currentCityID;
+    fields.destinationCityID = destinationCityID;
+    fields.price = old->price;
+    fields.categoryID = categoryID;
+    fields.modeID = modeID;
+    fields.bookedSeat = fields.numTravelers;
+    fields.returnTicket = old->returnTicket;
+    int result = convertLegacyBookingFields(&fields, converted);
+    if (result == RECORD_CONVERTED)
+    {
+        sealBooking(converted);
+    }
+    return result;
 }
 
-void update_reedem_Points(const char* userName, int bookingPrice) {
-    if (bookingPrice > 1800) { 
-        struct User user;
-        FILE *file = fopen("reedem_points.dat", "rb+");
-        if (file == NULL) {
-            file = fopen("reedem_points.dat", "wb+");
-            if (file == NULL) {
-                printf("Error: Unable to create Reedem points file.\n");
-                return;
-            }
-        }
+int convertBooking(const void *record, void *converted)
+{
+    memcpy(converted, record, sizeof(struct Booking));
+    sealBooking(converted);
+    return RECORD_CONVERTED;
+}
 
-        int userFound = 0; 
-        while (fread(&user, sizeof(struct User), 1, file) == 1) {
-            if (strcmp(user.name, userName) == 0) {
-                user.points += 10; 
-                fseek(file, -sizeof(struct User), SEEK_CUR); 
-                fwrite(&user, sizeof(struct User), 1, file); 
-                printf("Reedem points updated! New total: %d\n", user.points);
-                userFound = 1; 
-                break;
-            }
-        }
+int convertLegacyUser(const void *record, void *converted)
+{
+    const struct LegacyUser *old = record;
+    if (!textTerminated(old->name, sizeof(old->name)) || old->name[0] == '\0' || old->points < 0)
+    {
+        return RECORD_NOT_LAYOUT;
+    }
+    struct User *user = converted;
+    memset(user, 0, sizeof(*user));
+    memcpy(user->name, old->name, sizeof(user->name));
+    user->points = old->points;
+    sealUser(user);
+    return RECORD_CONVERTED;
+}
 
-        if (!userFound) {
-            // If user not found, create a new entry
-            strncpy(user.name, userName, MAX_NAME_LENGTH);
-            user.points = 10; // Start with 10 points for the first booking
-            fwrite(&user, sizeof(struct User), 1, file); // Add new user record
-            printf("New user created. Reedem points: %d\n", user.points);
-        }
+int convertUser(const void *record, void *converted)
+{
+    memcpy(converted, record, sizeof(struct User));
+    sealUser(converted);
+    return RECORD_CONVERTED;
+}
 
-        fclose(file);
-    } else {
-        printf("Booking price is not high enough to earn Reedem points.\n");
+int convertLegacyFeedback(const void *record, void *converted)
+{
+    const struct LegacyFeedback *old = record;
+    if (!textTerminated(old->name, sizeof(old->name)) || !textTerminated(old->comments, sizeof(old->comments)) ||
+        old->rating < 1 || old->rating > 5)
+    {
+        return RECORD_NOT_LAYOUT;
     }
+    struct Feedback *feedback = converted;
+    memset(feedback, 0, sizeof(*feedback));
+    feedback->ticketID = old->ticketID;
+    memcpy(feedback->name, old->name, sizeof(feedback->name));
+    feedback->rating = old->rating;
+    memcpy(feedback->comments, old->comments, sizeof(feedback->comments));
+    sealFeedback(feedback);
+    return RECORD_CONVERTED;
 }
 
-int RedeemPoints(const char* userName, int pointsToRedeem) {
-    struct User user;
-    FILE *file = fopen("reedem_points.dat", "rb+");
-    if (file == NULL) {
-        printf("Error: Unable to open reedem points file.\n");
-        return 0; 
+int convertFeedback(const void *record, void *converted)
+{
+    memcpy(converted, record, sizeof(struct Feedback));
+    sealFeedback(converted);
+    return RECORD_CONVERTED;
+}
+
+const struct LegacyLayout legacyBookingLayouts[] = {
+    {0, sizeof(struct LegacyNamedBooking), -1, convertLegacyNamedBooking},
+    {1, offsetof(struct LegacyBooking, checksum), -1, convertLegacyBooking},
+    {2, sizeof(struct LegacyBooking), offsetof(struct LegacyBooking, checksum), convertLegacyBooking},
+    {3, sizeof(struct LegacyDatedBooking), offsetof(struct LegacyDatedBooking, checksum), convertLegacyDatedBooking},
+    {BOOKINGS_LAYOUT, sizeof(struct Booking), offsetof(struct Booking, checksum), convertBooking},
+};
+
+const struct LegacyLayout legacyUserLayouts[] = {
+    {1, sizeof(struct LegacyUser), -1, convertLegacyUser},
+    {POINTS_LAYOUT, sizeof(struct User), offsetof(struct User, checksum), convertUser},
+};
+
+const struct LegacyLayout legacyFeedbackLayouts[] = {
+    {1, sizeof(struct LegacyFeedback), -1, convertLegacyFeedback},
+    {FEEDBACK_LAYOUT, sizeof(struct Feedback), offsetof(struct Feedback, checksum), convertFeedback},
+};
+
+// Converts one record of layout into converted, checking its checksum first
+// if the layout has one.
+int convertLegacyRecord(const struct LegacyLayout *layout, const unsigned char *record, void *converted)
+{
+    if (layout->checksumOffset >= 0 && !recordIntact(record, layout->size, layout->checksumOffset))
+    {
+        return RECORD_NOT_LAYOUT;
     }
+    return layout->convert(record, converted);
+}
 
-    while (fread(&user, sizeof(struct User), 1, file) == 1) {
-        if (strcmp(user.name, userName) == 0) {
-            if (user.points >= pointsToRedeem) {
-                user.points -= pointsToRedeem; 
-                fseek(file, -sizeof(struct User), SEEK_CUR); 
-                fwrite(&user, sizeof(struct User), 1, file);
-                fclose(file);
-                return pointsToRedeem; 
-            } else {
-                fclose(file);
-                return 0; // Not enough points
-            }
+// Brings path to its current layout. Missing files are created with just a
+// header. Returns false if the file holds a layout this build cannot read.
+bool migrateDataFile(const char *path, const struct LegacyLayout *layouts, int layoutCount)
+{
+    const struct DataFile *file = dataFileFor(path);
+    if (access(path, F_OK) != 0)
+    {
+        return createDataFile(path);
+    }
+    // Exclusive over the whole file, like a compaction, so no other process
+    // reads or appends while the file is converted
+    int fd = openLocked(path, O_RDWR, F_WRLCK, 0, 0);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        fprintf(stderr, "Error: Unable to open %s.\n", path);
+        return false;
+    }
+    struct DataFileHeader header;
+    if (pread(fd, &header, sizeof(header), 0) == sizeof(header) && header.magic == DATA_FILE_MAGIC)
+    {
+        close(fd);
+        if (header.layout != file->layout || header.recordSize != file->recordSize)
+        {
+            fprintf(stderr, "Error: %s holds layout %u records, which this version cannot read.\n", path, header.layout);
+            return false;
         }
+        return true;
     }
 
-    fclose(file);
-    return 0; 
-}
+    unsigned char *data = malloc(st.st_size > 0 ? st.st_size : 1);
+    unsigned char *converted = malloc(file->recordSize);
+    size_t length = 0;
+    while (data != NULL && length < (size_t)st.st_size)
+    {
+        ssize_t n = pread(fd, data + length, st.st_size - length, length);
+        if (n <= 0)
+        {
+            break;
+        }
+        length += n;
+    }
+    if (data == NULL || converted == NULL || length < (size_t)st.st_size)
+    {
+        free(data);
+        free(converted);
+        close(fd);
+        fprintf(stderr, "Error: Unable to read %s.\n", path);
+        return false;
+    }
 
-void displayPoints(const char* userName) {
-    struct User user;
-    FILE *file = fopen("reedem_points.dat", "rb");
-    if (file == NULL) {
-        printf("Error: Unable to open Reedem points file.\n");
-        return;
+    const struct LegacyLayout *best = NULL;
+    long bestMatches = 0;
+    for (int i = 0; i < layoutCount; i++)
+    {
+        long matches = 0;
+        for (size_t pos = 0; pos + layouts[i].size <= length; pos += layouts[i].size)
+        {
+            matches += convertLegacyRecord(&layouts[i], data + pos, converted) != RECORD_NOT_LAYOUT;
+        }
+        if (matches > 0 && matches >= bestMatches) // Newer layouts win ties
+        {
+            best = &layouts[i];
+            bestMatches = matches;
+        }
+    }
+    if (best == NULL && length > 0)
+    {
+        free(data);
+        free(converted);
+        close(fd);
+        fprintf(stderr, "Error: %s is in no layout this version knows; it was left alone.\n", path);
+        return false;
     }
 
-    while (fread(&user, sizeof(struct User), 1, file) == 1) {
-        if (strcmp(user.name, userName) == 0) {
-            printf("Your current Reedem points: %d\n", user.points);
-            fclose(file);
-            return;
+    char tempPath[256], asidePath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    snprintf(asidePath, sizeof(asidePath), "%s.unconverted", path);
+    FILE *out = fopen(tempPath, "wb");
+    FILE *aside = NULL;
+    bool written = out != NULL && writeDataHeader(out, path);
+    long convertedCount = 0, asideCount = 0;
+    size_t pos = 0;
+    for (; written && best != NULL && pos + best->size <= length; pos += best->size)
+    {
+        if (convertLegacyRecord(best, data + pos, converted) == RECORD_CONVERTED)
+        {
+            written = fwrite(converted, file->recordSize, 1, out) == 1;
+            convertedCount++;
+            continue;
         }
+        written = (aside != NULL || (aside = fopen(asidePath, "ab")) != NULL) && fwrite(data + pos, best->size, 1, aside) == 1;
+        asideCount++;
+    }
+    if (written && pos < length) // A torn tail
+    {
+        asideCount++;
+        written = (aside != NULL || (aside = fopen(asidePath, "ab")) != NULL) && fwrite(data + pos, length - pos, 1, aside) == 1;
+    }
+    written = (aside == NULL || fclose(aside) == 0) && written;
+    written = (out == NULL || fclose(out) == 0) && written;
+    free(data);
+    free(converted);
+
+    if (!written || rename(tempPath, path) != 0)
+    {
+        remove(tempPath);
+        close(fd);
+        fprintf(stderr, "Error: Unable to convert %s.\n", path);
+        return false;
+    }
+    ioBackend->fileReplaced(path);
+    close(fd); // Release the lock only once the converted file is in place
+    if (length > 0)
+    {
+        fprintf(stderr, "Converted %s from layout %u: %ld record(s).\n", path, best->layout, convertedCount);
+    }
+    if (asideCount > 0)
+    {
+        fprintf(stderr, "Warning: %ld record(s) of %s could not be converted and were kept in %s.\n", asideCount, path, asidePath);
     }
+    return true;
+}
 
-    fclose(file);
-    printf("No Reedem points found for this user.\n");
+// Runs before anything reads the data files.
+bool migrateDataFiles()
+{
+    return migrateDataFile(FILENAME, legacyBookingLayouts, sizeof(legacyBookingLayouts) / sizeof(legacyBookingLayouts[0])) &&
+           migrateDataFile(POINTS_FILENAME, legacyUserLayouts, sizeof(legacyUserLayouts) / sizeof(legacyUserLayouts[0])) &&
+           migrateDataFile(FEEDBACK_FILENAME, legacyFeedbackLayouts, sizeof(legacyFeedbackLayouts) / sizeof(legacyFeedbackLayouts[0]));
 }
 
-void displayBookings()
+// Booking stores from before LSM2 recorded no layout. Their entries embed a
+// layout 3 or layout 4 booking (the engine came after layout 2) and are
+// told apart by size: a run's entry size follows from its header, and a
+// log's from the layout its first entry checks out under.
+struct LsmOldManifest
 {
-    int Transport_Choice;
-    while(1){
-        printf("\nSelect mode of transport:\n");
-        printf("1. Bus\n");
-        printf("2. Train\n");
-        printf("Enter your choice: ");
+    unsigned int magic; // LSM_OLD_MAGIC
+    int runCount;
+    unsigned long long generation;
+    unsigned long long nextID;
+    unsigned long long walID;
+    struct LsmRunInfo runs[LSM_MAX_RUNS];
+};
 
-        if (scanf("%d", &Transport_Choice) != 1 || (Transport_Choice < 1 || Transport_Choice > 2)) {
-            printf("Invalid choice. Please choose 1 for Bus or 2 for Train.\n");
-            clearInputBuffer();
-            continue;
+struct LsmOldRunHeader
+{
+    unsigned int magic;
+    unsigned int bloomWords;
+    long long count;
+};
+
+// An old entry is the booking, the tombstone flag and the entry checksum.
+size_t lsmOldEntrySize(const struct LegacyLayout *layout)
+{
+    return layout->size + 2 * sizeof(int);
+}
+
+// The booking layout of old entries of entrySize bytes, or NULL.
+const struct LegacyLayout *lsmOldLayout(size_t entrySize)
+{
+    for (size_t i = 0; i < sizeof(legacyBookingLayouts) / sizeof(legacyBookingLayouts[0]); i++)
+    {
+        if (legacyBookingLayouts[i].layout >= 3 && lsmOldEntrySize(&legacyBookingLayouts[i]) == entrySize)
+        {
+            return &legacyBookingLayouts[i];
         }
-        clearInputBuffer();
-        printf("You selected: %s\n", Transport_Choice == 1 ? "Bus" : "Train");
-        break;
     }
-    struct Booking booking;
-    FILE *file = fopen(FILENAME, "rb");
+    return NULL;
+}
 
-    if (file == NULL)
+// Reads all of path. Returns NULL if it cannot be read; a missing file
+// reads as empty.
+unsigned char *readWholeFile(const char *path, size_t *length)
+{
+    *length = 0;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 && errno == ENOENT)
     {
-        printf("No bookings found or error opening file.\n");
-        return;
+        return malloc(1);
+    }
+    unsigned char *data = fd >= 0 && fstat(fd, &st) == 0 ? malloc(st.st_size > 0 ? st.st_size : 1) : NULL;
+    while (data != NULL && *length < (size_t)st.st_size)
+    {
+        ssize_t n = pread(fd, data + *length, st.st_size - *length, *length);
+        if (n <= 0)
+        {
+            free(data);
+            data = NULL;
+            break;
+        }
+        *length += n;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
     }
+    return data;
+}
 
-    // Adjusted header to include "Booked Seat"
-    printf("\n +----------------------------------------------------------------------------------------------------------+\n");
-    printf(" | %-10s %-20s %-20s %-20s %-10s %-6.5s %10s|\n", "Ticket ID", "Name", "Current Location", "Destination", "Booked Seat", "Price", "Mode");
-    printf(" +----------------------------------------------------------------------------------------------------------+\n");
+struct LsmUpgrade
+{
+    long converted;
+    long keptAside;
+    unsigned int layout; // Of the entries converted
+    FILE *aside;
+};
 
-    // Read and display each booking entry
-    while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+// Applies count old entries of layout, oldest first, to the memtable.
+// Entries that fail their checksum or cannot be converted are copied to
+// bookings.lsm/unconverted; in a log, the first bad entry ends it.
+bool lsmUpgradeEntries(struct LsmUpgrade *upgrade, const unsigned char *data, long long count,
+                       const struct LegacyLayout *layout, bool log)
+{
+    size_t size = lsmOldEntrySize(layout);
+    upgrade->layout = layout->layout;
+    for (long long i = 0; i < count; i++)
     {
-        int bookedCount = 0;
-
-        // Count how many seats were booked
-        for (int i = 0; i < MAX_SEATS; i++)
+        const unsigned char *old = data + i * size;
+        struct LsmEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        bool intact = recordIntact(old, size, size - sizeof(unsigned int));
+        memcpy(&entry.tombstone, old + layout->size, sizeof(int));
+        if (intact && entry.tombstone)
         {
-            if (booking.seats[i] != 0)
-            { // Count only non-zero seats
-                bookedCount++;
-            }
+            memcpy(&entry.booking.ticketID, old, sizeof(int)); // The ticket ID leads every layout
         }
-
-        // Display booking information
-        if(Transport_Choice==1){
-            if(strcmp(booking.mode , "Bus") == 0){
-            printf(" | %-10d %-20s %-20s %-20s %-10d Rs.%4d %10s |\n",
-               booking.ticketID, booking.name, booking.currentLocation,
-               booking.destination, bookedCount, booking.price ,booking.mode);
+        if (!intact || (!entry.tombstone && layout->convert(old, &entry.booking) != RECORD_CONVERTED))
+        {
+            size_t length = log && !intact ? (count - i) * size : size;
+            upgrade->keptAside++;
+            if ((upgrade->aside == NULL && (upgrade->aside = fopen(LSM_DIRECTORY "/unconverted", "ab")) == NULL) ||
+                fwrite(old, length, 1, upgrade->aside) != 1)
+            {
+                return false;
             }
-        }else{
-            if(strcmp(booking.mode , "Train") ==0){
-            printf(" | %-10d %-20s %-20s %-20s %-10d Rs.%4d %10s |\n",
-               booking.ticketID, booking.name, booking.currentLocation,
-               booking.destination, bookedCount, booking.price ,booking.mode);
+            if (log && !intact)
+            {
+                return true;
             }
+            continue;
         }
+        sealLsmEntry(&entry);
+        if (!lsmMemtablePut(&entry))
+        {
+            return false;
+        }
+        upgrade->converted++;
     }
-    printf(" +----------------------------------------------------------------------------------------------------------+\n");
-
-    // Check for any read errors
-    if (ferror(file))
-    {
-        printf("Error occurred while reading the file.\n");
-    }
-
-    fclose(file);
+    return true;
 }
 
-void searchBookings()
+// Converts an LSM1 store into one level-1 run of the current layout, keeping
+// the newest entry for each ticket. Run and log numbers carry on from the
+// old manifest, so the old files stay intact until the new manifest is in
+// place. Callers hold the operation lock.
+bool lsmUpgrade()
 {
-    int searchChoice;
-    printf("\nSearch by:\n");
-    printf("1. Ticket ID\n");
-    printf("2. Name\n");
-    printf("Enter your choice: ");
-    if (scanf("%d", &searchChoice) != 1)
+    struct LsmOldManifest old;
+    int fd = open(LSM_DIRECTORY "/manifest", O_RDONLY);
+    bool valid = fd >= 0 && pread(fd, &old, sizeof(old), 0) == sizeof(old) && old.magic == LSM_OLD_MAGIC &&
+                 old.runCount >= 0 && old.runCount <= LSM_MAX_RUNS;
+    if (fd >= 0)
     {
-        printf("Error: Invalid input. Please enter a valid number.\n");
-        clearInputBuffer();
-        return;
+        close(fd);
     }
-    clearInputBuffer();
-
-    struct Booking booking;
-    FILE *file = fopen(FILENAME, "rb");
-    if (file == NULL)
+    if (!valid)
     {
-        printf(" error opening file.\n");
-        return;
+        return false;
     }
 
-    bool found = false;
-    if (searchChoice == 1)
+    struct LsmUpgrade upgrade = {0, 0, 0, NULL};
+    char path[64];
+    bool converted = true;
+    for (int i = old.runCount - 1; converted && i >= 0; i--) // Oldest first
     {
-        int ticketID;
-        printf("Enter Ticket ID to search: ");
-        if (scanf("%d", &ticketID) != 1)
+        size_t length;
+        lsmFilePath(path, sizeof(path), "run", old.runs[i].id);
+        unsigned char *data = readWholeFile(path, &length);
+        const struct LsmOldRunHeader *header = (const struct LsmOldRunHeader *)data;
+        size_t start = sizeof(*header) + (length >= sizeof(*header) ? header->bloomWords * sizeof(unsigned long long) : 0);
+        bool readable = data != NULL && length >= start && header->magic == LSM_OLD_MAGIC && header->count >= 0;
+        const struct LegacyLayout *layout = NULL;
+        if (readable && header->count > 0 && (length - start) % header->count == 0)
         {
-            printf("Error: Invalid input.\n");
-            clearInputBuffer();
-            fclose(file);
-            return;
+            layout = lsmOldLayout((length - start) / header->count);
         }
-        clearInputBuffer();
-
-        while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+        if (readable && header->count == 0)
         {
-            if (booking.ticketID == ticketID)
-            {
-                printf("\nBooking Found:\n");
-                printf("Ticket ID: %d\n", booking.ticketID);
-                printf("Name: %s\n", booking.name);
-                printf("Destination: %s\n", booking.destination);
-                printf("Category: %s\n", booking.category);
-                printf("Price: Rs. %d\n", booking.price);
-                found = true;
-            }
+            // An empty run converts to nothing
+        }
+        else if (layout == NULL)
+        {
+            fprintf(stderr, "Error: Booking run %s is damaged or in no layout this version knows.\n", path);
+            converted = false;
         }
+        else
+        {
+            converted = lsmUpgradeEntries(&upgrade, data + start, header->count, layout, false);
+        }
+        free(data);
     }
-    else if (searchChoice == 2)
-    {
-        char name[MAX_NAME_LENGTH];
-        printf("Enter Name to search: ");
-        fgets(name, MAX_NAME_LENGTH, stdin);
-        name[strcspn(name, "\n")] = 0; // Remove newline
 
-        while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+    size_t length;
+    lsmFilePath(path, sizeof(path), "wal", old.walID);
+    unsigned char *data = converted ? readWholeFile(path, &length) : NULL;
+    const struct LegacyLayout *layout = NULL;
+    for (size_t i = 0; data != NULL && layout == NULL && i < sizeof(legacyBookingLayouts) / sizeof(legacyBookingLayouts[0]); i++)
+    {
+        size_t size = lsmOldEntrySize(&legacyBookingLayouts[i]);
+        if (legacyBookingLayouts[i].layout >= 3 && length >= size && recordIntact(data, size, size - sizeof(unsigned int)))
         {
-            if (strcasecmp(booking.name, name) == 0)
-            {
-                printf("\nBooking Found:\n");
-                printf("Ticket ID: %d\n", booking.ticketID);
-                printf("Name: %s\n", booking.name);
-                printf("Destination: %s\n", booking.destination);
-                printf("Category: %s", booking.category);
-                printf("Price: Rs. %d\n", booking.price);
-                found = true;
-            }
+            layout = &legacyBookingLayouts[i];
         }
     }
-    else
+    converted = data != NULL && (layout == NULL || lsmUpgradeEntries(&upgrade, data, length / lsmOldEntrySize(layout), layout, true));
+    if (converted && layout == NULL && length > 0)
     {
-        printf("Invalid choice.\n");
-        fclose(file);
-        return;
+        upgrade.keptAside++; // Not even the first entry checks out
+        converted = (upgrade.aside != NULL || (upgrade.aside = fopen(LSM_DIRECTORY "/unconverted", "ab")) != NULL) &&
+                    fwrite(data, length, 1, upgrade.aside) == 1;
     }
-
-    if (!found)
+    free(data);
+    converted = (upgrade.aside == NULL || fclose(upgrade.aside) == 0) && converted;
+
+    struct LsmManifest manifest;
+    memset(&manifest, 0, sizeof(manifest));
+    manifest.magic = LSM_MAGIC;
+    manifest.layout = BOOKINGS_LAYOUT;
+    manifest.generation = old.generation + 1;
+    manifest.nextID = old.nextID;
+    unsigned long long runID = manifest.nextID++;
+    char runPath[64];
+    lsmFilePath(runPath, sizeof(runPath), "run", runID);
+    struct LsmRunWriter writer;
+    struct LsmCursor memtable = {lsm.memtable, lsm.memtableOrder, lsm.memtableCount, 0};
+    if (converted && (converted = lsmBeginRun(&writer, runPath, lsm.memtableCount, true)))
     {
-        printf("No booking found with the given criteria.\n");
+        converted = lsmMerge(&memtable, 1, lsmRunWriterAdd, &writer);
+        converted = lsmFinishRun(&writer) && converted;
     }
-
-    fclose(file);
+    lsm.memtableCount = 0;
+    if (converted)
+    {
+        manifest.runs[0] = (struct LsmRunInfo){runID, 1, writer.count};
+        manifest.runCount = 1;
+        manifest.walID = manifest.nextID++;
+    }
+    if (!converted || !lsmWriteManifest(&manifest))
+    {
+        remove(runPath);
+        fprintf(stderr, "Error: Unable to convert %s; it was left alone.\n", LSM_DIRECTORY);
+        return false;
+    }
+    for (int i = 0; i < old.runCount; i++)
+    {
+        lsmFilePath(path, sizeof(path), "run", old.runs[i].id);
+        remove(path);
+    }
+    lsmFilePath(path, sizeof(path), "wal", old.walID);
+    remove(path);
+    if (upgrade.layout != 0)
+    {
+        fprintf(stderr, "Converted %s from layout %u: %ld entries.\n", LSM_DIRECTORY, upgrade.layout, upgrade.converted);
+    }
+    if (upgrade.keptAside > 0)
+    {
+        fprintf(stderr, "Warning: %ld entries of %s could not be converted and were kept in %s/unconverted.\n",
+                upgrade.keptAside, LSM_DIRECTORY, LSM_DIRECTORY);
+    }
+    return true;
 }
 
-// exit without save functionality
-void removeLastBooking()
+// Offline integrity check behind --verify. Each file is mapped and walked
+// record by record. After a damaged record the walk moves forward one byte
+// at a time until a record checks out again, so a torn write in the middle
+// does not throw off everything after it. With --repair the intact records
+// are written to a new file that replaces the old one. Only files whose
+// header names the current layout are checked; migrateDataFiles() has
+// converted older ones by then.
+struct VerifyResult
 {
-    struct Booking *bookings = NULL;
-    int count = 0;
-    FILE *file = fopen(FILENAME, "rb");
-    if (file == NULL)
+    long long intact;
+    long long damaged;
+    long long skippedBytes;
+};
+
+bool verifyRecordFile(const char *path, size_t size, size_t checksumOffset, bool repair, struct VerifyResult *result)
+{
+    memset(result, 0, sizeof(*result));
+    // A shared lock keeps writers out while the file is checked; a repair
+    // holds it exclusively until the cleaned file has replaced it.
+    int fd = openLocked(path, repair ? O_RDWR : O_RDONLY, repair ? F_WRLCK : F_RDLCK, 0, 0);
+    if (fd < 0)
     {
-        return;
+        return true; // Nothing stored yet
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    long long length = st.st_size;
+    if (!dataHeaderCurrent(fd, path))
+    {
+        printf("%s: not in the layout this version reads\n", path);
+        close(fd);
+        return false;
     }
+    const unsigned char *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    madvise((void *)data, length, MADV_SEQUENTIAL);
 
-    // Count the number of bookings and read them into an array
-    while (!feof(file))
+    FILE *out = NULL;
+    if (repair && ((out = fopen("verify.tmp", "wb")) == NULL || !writeDataHeader(out, path)))
     {
-        bookings = realloc(bookings, (count + 1) * sizeof(struct Booking));
-        if (fread(&bookings[count], sizeof(struct Booking), 1, file) == 1)
+        if (out != NULL)
         {
-            count++;
+            fclose(out);
         }
+        munmap((void *)data, length);
+        close(fd);
+        return false;
     }
-    fclose(file);
 
-    // If there are bookings, overwrite the file excluding the last booking
-    if (count > 1)
+    long long pos = DATA_HEADER_SIZE;
+    while (pos < length)
     {
-        file = fopen(FILENAME, "wb");
-        for (int i = 0; i < count - 1; i++)
+        if (pos + (long long)size <= length && recordIntact(data + pos, size, checksumOffset))
+        {
+            result->intact++;
+            if (out != NULL)
+            {
+                fwrite(data + pos, size, 1, out);
+            }
+            pos += size;
+            continue;
+        }
+
+        long long next = pos + 1;
+        while (next + (long long)size <= length && !recordIntact(data + next, size, checksumOffset))
         {
-            fwrite(&bookings[i], sizeof(struct Booking), 1, file);
+            next++;
         }
-        fclose(file);
+        if (next + (long long)size > length)
+        {
+            next = length;
+        }
+        printf("%s: damaged data at offset %lld (%lld bytes)\n", path, pos, next - pos);
+        result->damaged++;
+        result->skippedBytes += next - pos;
+        pos = next;
     }
-    else
+    munmap((void *)data, length);
+
+    bool success = true;
+    if (out != NULL)
     {
-        // If there was only one booking, just remove the file
-        remove(FILENAME);
+        bool written = fclose(out) == 0;
+        if (result->damaged == 0)
+        {
+            remove("verify.tmp");
+        }
+        else if (!written || rename("verify.tmp", path) != 0)
+        {
+            success = false;
+        }
+        else
+        {
+            ioBackend->fileReplaced(path);
+        }
     }
-
-    free(bookings); // Free the allocated array
+    close(fd); // Release the lock only once the repaired file is in place
+    return success;
 }
 
-void displayCities()
+// Returns true when every file is intact (or was repaired).
+bool verifyDataFiles(bool repair)
 {
-    printf("Available Cities:\n");
-    for (int i = 0; i < numCities; i++)
+    const char *paths[] = {FILENAME, POINTS_FILENAME, FEEDBACK_FILENAME};
+    const size_t sizes[] = {sizeof(struct Booking), sizeof(struct User), sizeof(struct Feedback)};
+    const size_t offsets[] = {offsetof(struct Booking, checksum), offsetof(struct User, checksum), offsetof(struct Feedback, checksum)};
+    bool clean = true;
+
+    printf("CRC32C: %s\n", crc32cHardware ? "SSE4.2" : "table");
+    for (int i = 0; i < 3; i++)
     {
-        printf("%d. %s\n", i + 1, indianCities[i]);
+        struct VerifyResult result;
+        struct timespec started, finished;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        if (!verifyRecordFile(paths[i], sizes[i], offsets[i], repair, &result))
+        {
+            printf("%-20s could not be %s\n", paths[i], repair ? "repaired" : "read");
+            clean = false;
+            continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        double seconds = (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1e9;
+        double megabytes = (result.intact * sizes[i] + result.skippedBytes) / 1e6;
+        printf("%-20s %lld intact, %lld damaged (%lld bytes)%s, %.1f MB/s\n", paths[i], result.intact, result.damaged,
+               result.skippedBytes, result.damaged > 0 && repair ? " removed" : "",
+               seconds > 0 ? megabytes / seconds : 0.0);
+        clean = clean && (result.damaged == 0 || repair);
     }
+    return clean;
 }
 
-bool cityExists(const char *cityName)
+// City table generator behind --generate-cities. Reads one
+// "City,train standard,train VIP,bus standard,bus VIP" line per city and
+// prints the city tables near the top of this file, with the seeds of a
+// minimal perfect hash over the names (hash and displace): names are split
+// into buckets by hash, and each bucket, largest first, gets the first seed
+// that sends all of its names to slots nobody took yet.
+struct GeneratedCity
 {
-    for (int i = 0; i < numCities; i++)
+    char name[MAX_DESTINATION_LENGTH];
+    int trainPrices[2];
+    int busPrices[2];
+    unsigned int hash;
+};
+
+int compareGeneratedCityHashes(const void *a, const void *b)
+{
+    unsigned int x = (*(struct GeneratedCity *const *)a)->hash, y = (*(struct GeneratedCity *const *)b)->hash;
+    return (x > y) - (x < y);
+}
+
+// Prints a list of values wrapped at 80 columns, as in the tables above.
+void printGeneratedList(FILE *out, const char *declaration, const char *const *items, int count)
+{
+    fprintf(out, "%s = {\n   ", declaration);
+    int column = 3;
+    for (int i = 0; i < count; i++)
     {
-        if (strcasecmp(indianCities[i], cityName) == 0)
+        int width = strlen(items[i]) + (i + 1 < count ? 1 : 2);
+        if (column + 1 + width > 80)
         {
-            return true;
+            fprintf(out, "\n   ");
+            column = 3;
         }
+        fprintf(out, " %s%s", items[i], i + 1 < count ? "," : "};\n");
+        column += 1 + width;
     }
-    return false;
 }
 
-int selectCity()
+bool generateCityTable(const char *path)
 {
-    int choice;
+    FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (in == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open %s.\n", path);
+        return false;
+    }
 
-    while (1)
+    struct GeneratedCity *cities = NULL;
+    int count = 0, capacity = 0, lineNumber = 0;
+    char line[256];
+    bool valid = true;
+    while (valid && fgets(line, sizeof(line), in) != NULL)
     {
-        printf("Please select a city (1-%d) or 0 to skip: ", numCities);
-        if (scanf("%d", &choice) != 1 || choice < 0 || choice > numCities)
+        lineNumber++;
+        if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#')
         {
-            printf("Error: Invalid input. Please enter a number between 0 and %d.\n", numCities);
-            clearInputBuffer();
+            continue;
         }
-        else
+        if (count == capacity)
         {
-            break; // Valid input received
+            capacity = capacity ? capacity * 2 : 64;
+            struct GeneratedCity *grown = realloc(cities, capacity * sizeof(struct GeneratedCity));
+            if (grown == NULL)
+            {
+                valid = false;
+                break;
+            }
+            cities = grown;
+        }
+        struct GeneratedCity *city = &cities[count];
+        if (sscanf(line, " %49[^,\"\\\n],%d,%d,%d,%d", city->name, &city->trainPrices[0], &city->trainPrices[1],
+                   &city->busPrices[0], &city->busPrices[1]) != 5)
+        {
+            fprintf(stderr, "Error: %s:%d: expected \"City,train standard,train VIP,bus standard,bus VIP\".\n", path, lineNumber);
+            valid = false;
+            break;
         }
+        city->hash = hashCatalogName(city->name);
+        count++;
     }
-
-    clearInputBuffer();
-    return choice;
-}
-
-void modifyBooking()
-{
-    int ticketID;
-    printf("Enter Ticket ID to modify: ");
-    if (scanf("%d", &ticketID) != 1)
+    if (in != stdin)
     {
-        printf("Error: Invalid input.\n");
-        clearInputBuffer();
-        return;
+        fclose(in);
     }
-    clearInputBuffer();
-
-    struct Booking booking;
-    FILE *file = fopen(FILENAME, "rb");
-    FILE *tempFile = fopen("temp.dat", "wb");
-    if (file == NULL || tempFile == NULL)
+    if (valid && (count == 0 || count > MAX_CATALOG_ENTRIES))
     {
-        printf("Error opening file.\n");
-        if (file)
-            fclose(file);
-        if (tempFile)
-            fclose(tempFile);
-        return;
+        fprintf(stderr, "Error: The catalog must have between 1 and %d cities.\n", MAX_CATALOG_ENTRIES);
+        valid = false;
     }
 
-    bool found = false;
-    while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+    // Names with the same hash can never be told apart by a seed
+    struct GeneratedCity **byHash = valid ? malloc(count * sizeof(struct GeneratedCity *)) : NULL;
+    valid = valid && byHash != NULL;
+    for (int i = 0; valid && i < count; i++)
+    {
+        byHash[i] = &cities[i];
+    }
+    if (valid)
+    {
+        qsort(byHash, count, sizeof(struct GeneratedCity *), compareGeneratedCityHashes);
+    }
+    for (int i = 1; valid && i < count; i++)
+    {
+        if (byHash[i]->hash == byHash[i - 1]->hash)
+        {
+            fprintf(stderr, "Error: \"%s\" %s \"%s\".\n", byHash[i]->name,
+                    strcasecmp(byHash[i]->name, byHash[i - 1]->name) == 0 ? "repeats" : "has the same hash as", byHash[i - 1]->name);
+            valid = false;
+        }
+    }
+    free(byHash);
+
+    int bucketCount = (count + 1) / 2;
+    unsigned int *seeds = valid ? calloc(bucketCount, sizeof(unsigned int)) : NULL;
+    short *slots = valid ? malloc(count * sizeof(short)) : NULL;
+    int *bucketSizes = valid ? calloc(bucketCount, sizeof(int)) : NULL;
+    int *bucketStarts = valid ? calloc(bucketCount + 1, sizeof(int)) : NULL;
+    int *members = valid ? malloc(count * sizeof(int)) : NULL;
+    int *order = valid ? malloc(bucketCount * sizeof(int)) : NULL;
+    unsigned long long *taken = valid ? calloc(count, sizeof(unsigned long long)) : NULL;
+    valid = valid && seeds != NULL && slots != NULL && bucketSizes != NULL && bucketStarts != NULL &&
+            members != NULL && order != NULL && taken != NULL;
+
+    if (valid)
     {
-        if (booking.ticketID == ticketID)
+        // Group the cities by bucket, then place the largest buckets first
+        for (int i = 0; i < count; i++)
+        {
+            bucketSizes[cities[i].hash % bucketCount]++;
+        }
+        for (int b = 0; b < bucketCount; b++)
+        {
+            bucketStarts[b + 1] = bucketStarts[b] + bucketSizes[b];
+        }
+        int *fill = calloc(bucketCount, sizeof(int));
+        valid = fill != NULL;
+        for (int i = 0; valid && i < count; i++)
+        {
+            int b = cities[i].hash % bucketCount;
+            members[bucketStarts[b] + fill[b]++] = i;
+        }
+        free(fill);
+        int ordered = 0;
+        for (int size = count; valid && size > 0; size--)
         {
-            found = true;
-            printf("Current Booking Details:\n");
-            printf("Name: %s\n", booking.name);
-            printf("Current Location: %s\n", booking.currentLocation);
-            printf("Destination: %s\n", booking.destination);
-            printf("Price: Rs. %d\n", booking.price);
-
-            // Modify the Name
-            printf("Enter new name (leave blank for no change): ");
-            char newName[MAX_NAME_LENGTH];
-            fgets(newName, MAX_NAME_LENGTH, stdin);
-            newName[strcspn(newName, "\n")] = 0;
-            if (strlen(newName) > 0)
+            for (int b = 0; b < bucketCount; b++)
             {
-                strncpy(booking.name, newName, MAX_NAME_LENGTH);
+                if (bucketSizes[b] == size)
+                {
+                    order[ordered++] = b;
+                }
             }
+        }
 
-            // Display Indian Cities and Modify Current Location
-            for (int i = 0; i < numCities; i++)
+        memset(slots, 0xff, count * sizeof(short));
+        unsigned long long attempt = 0; // taken[] holds the last attempt that reached each slot
+        for (int o = 0; valid && o < ordered; o++)
+        {
+            int b = order[o];
+            unsigned int seed = 0;
+            while (1)
             {
-                printf("%d. %s\n", i + 1, indianCities[i]);
+                bool fits = true;
+                attempt++;
+                for (int m = bucketStarts[b]; fits && m < bucketStarts[b + 1]; m++)
+                {
+                    unsigned int slot = mixCityHash(cities[members[m]].hash, seed) % count;
+                    fits = slots[slot] < 0 && taken[slot] != attempt;
+                    taken[slot] = attempt;
+                }
+                if (fits)
+                {
+                    break;
+                }
+                if (++seed == 1u << 24)
+                {
+                    fprintf(stderr, "Error: No perfect hash seed found.\n");
+                    valid = false;
+                    break;
+                }
             }
-            printf("current location : ");
-            int currentLocationChoice = selectCity();
-            if (currentLocationChoice > 0)
+            seeds[b] = seed;
+            for (int m = bucketStarts[b]; valid && m < bucketStarts[b + 1]; m++)
             {
-                strncpy(booking.currentLocation, indianCities[currentLocationChoice - 1], MAX_DESTINATION_LENGTH);
+                slots[mixCityHash(cities[members[m]].hash, seed) % count] = members[m];
             }
-            else if (currentLocationChoice == 0)
+        }
+    }
+
+    if (valid)
+    {
+        char **items = malloc(count * sizeof(char *));
+        valid = items != NULL;
+        for (int i = 0; valid && i < count; i++)
+        {
+            items[i] = malloc(MAX_DESTINATION_LENGTH + 16);
+            valid = items[i] != NULL;
+        }
+        if (valid)
+        {
+            printf("// Generated by `booking --generate-cities cities.csv`; edit cities.csv and\n");
+            printf("// regenerate instead of changing these tables. cities.csv has one \"City,\n");
+            printf("// train standard,train VIP,bus standard,bus VIP\" line per city, and the order\n");
+            printf("// of the lines gives the city IDs that bookings store, so new cities go at\n");
+            printf("// the end. cityHashSeeds and cityHashSlots form a minimal perfect hash over\n");
+            printf("// the names, see findCityID().\n");
+            for (int i = 0; i < count; i++)
             {
-                printf("No change to the current location.\n");
+                snprintf(items[i], MAX_DESTINATION_LENGTH + 16, "\"%s\"", cities[i].name);
             }
-
-            // Display Cities and Modify Destination Location
-            for (int i = 0; i < numCities; i++)
+            printGeneratedList(stdout, "const char *indianCities[]", (const char *const *)items, count);
+            printf("\nint ticketPrices[][2] = {\n");
+            for (int i = 0; i < count; i++)
             {
-                printf("%d. %s\n", i + 1, indianCities[i]);
+                printf("    {%d, %d}%s // %s\n", cities[i].trainPrices[0], cities[i].trainPrices[1], i + 1 < count ? "," : " ", cities[i].name);
             }
-
-            printf("destination location : ");
-            int newDestChoice = selectCity();
-            if (newDestChoice > 0)
+            printf("};\n\nint busPrices[][2] = {\n");
+            for (int i = 0; i < count; i++)
             {
-                strncpy(booking.destination, indianCities[newDestChoice - 1], MAX_DESTINATION_LENGTH);
+                printf("    {%d, %d}%s // %s\n", cities[i].busPrices[0], cities[i].busPrices[1], i + 1 < count ? "," : " ", cities[i].name);
             }
-            else if (newDestChoice == 0)
+            printf("};\n\n");
+            for (int b = 0; b < bucketCount; b++)
             {
-                printf("No change to the destination.\n");
+                snprintf(items[b], MAX_DESTINATION_LENGTH + 16, "%u", seeds[b]);
             }
+            printGeneratedList(stdout, "const unsigned int cityHashSeeds[]", (const char *const *)items, bucketCount);
+            for (int i = 0; i < count; i++)
+            {
+                snprintf(items[i], MAX_DESTINATION_LENGTH + 16, "%d", slots[i]);
+            }
+            printGeneratedList(stdout, "const short cityHashSlots[]", (const char *const *)items, count);
+        }
+        for (int i = 0; items != NULL && i < count; i++)
+        {
+            free(items[i]);
+        }
+        free(items);
+    }
 
-            // Modify Number of Travelers
-            int n;
-           do {
-             printf("Enter new number of travelers (or enter 0 to skip): ");
-               if (scanf("%d", &n) != 1) {
-                    printf("Invalid input. Please enter a valid number of travelers.\n");
-                    clearInputBuffer();
-              } 
-               else if (n < 0) {
-                    printf("Please enter a valid number greater than or equal to 0.\n");
-                    clearInputBuffer();
-              } 
-               else {
-                    break;
-             }
-          } while (1);
-            
-               clearInputBuffer();
-
-             if (n > 0) {
-                    booking.numTravelers = n;
-            } 
-             else if (n == 0) {
-                  printf("No change to the number of travelers.\n");
-             }
-            // Modify Ticket Category
-              int cateChoice;
-              printf("Select Ticket Category (enter 0 to skip):\n");
-            
-               for (int i = 0; i < sizeof(ticketCategories) / sizeof(ticketCategories[0]); i++) {
-                      printf("%d. %s\n", i + 1, ticketCategories[i]);
-                }
-
-               char categoryInput[10];
-               fgets(categoryInput, sizeof(categoryInput), stdin);
-            
-               if (sscanf(categoryInput, "%d", &cateChoice) == 1 && cateChoice != 0 &&
-                    cateChoice >= 1 && cateChoice <= sizeof(ticketCategories) / sizeof(ticketCategories[0])) 
-               {
-                     booking.category[0] = cateChoice - 1; 
-               } 
-               else 
-               {
-                     printf("No change to the category.\n");
-                }
-
-
-            // Modify Seats for Each Traveler
-printf("Select new seats for the travelers (enter 0 to skip):\n");
+    free(cities);
+    free(seeds);
+    free(slots);
+    free(bucketSizes);
+    free(bucketStarts);
+    free(members);
+    free(order);
+    free(taken);
+    return valid;
+}
 
+// Benchmarks behind --benchmark. Each runs against the data directory and
+// prints one table.
+//   scan times the report scan over bookings.dat at 1, 2, 4, ... worker
+//   threads up to the number of CPUs, best of BENCHMARK_RUNS runs each, and
+//   prints the speedup over one thread. With --records N a data directory
+//   without bookings is first filled with N synthetic ones.
+//   io books --records synthetic bookings (BENCHMARK_IO_BOOKINGS by default)
+//   through each storage I/O backend, each in its own io-NAME directory, and
+//   prints bookings per second and the system calls each booking made.
+#define BENCHMARK_RUNS 3
+#define BENCHMARK_IO_BOOKINGS 20000
+#define BENCHMARK_TRACED_BOOKINGS 1000 // Bookings run under ptrace to count system calls
+
+// Fills booking with the index-th synthetic booking, sealed.
+void syntheticBooking(long long index, struct Booking *booking)
+{
+    memset(booking, 0, sizeof(*booking));
+    booking->ticketID = (int)(index % 2000000000) + 1;
+    snprintf(booking->name, sizeof(booking->name), "Traveller %c%c", 'A' + (int)(index % 26), 'a' + (int)(index / 26 % 26));
+    booking->currentCityID = index % numCities;
+    booking->destinationCityID = (booking->currentCityID + 1 + index / numCities % (numCities - 1)) % numCities;
+    booking->modeID = index % 2 == 0 ? MODE_BUS : MODE_TRAIN;
+    booking->categoryID = index % 5 == 0; // One in five is VIP
+    booking->price = fareFor(booking->currentCityID, booking->modeID, booking->categoryID);
+    int seat = 1 + index % DEFAULT_ROUTE_SEATS;
+    setBookingSeats(booking, &seat, 1);
+    booking->bookedSeat = 1;
+    booking->numTravelers = 1;
+    booking->createdAt = 1700000000LL + index * 60;
+    booking->travelDate = (booking->createdAt / SECONDS_PER_DAY + index % 90) * SECONDS_PER_DAY;
+    sealBooking(booking);
+}
 
-for (int i = 0; i < booking.numTravelers; i++) {
-   
-    if (i < booking.bookedSeat && booking.seats[i] != 0) {
-        printf("Current seat for traveler %d: %d\n", i + 1, booking.seats[i]);
-    } else {
-        printf("Current seat for traveler %d: None\n", i + 1);
+// Writes count synthetic bookings to a bookings.dat that holds none yet.
+bool writeSyntheticBookings(long long count)
+{
+    struct stat st;
+    if (bookingEngine->logStructured || (stat(FILENAME, &st) == 0 && recordCount(st.st_size, sizeof(struct Booking)) > 0))
+    {
+        fprintf(stderr, "Error: --records needs a data directory without bookings.\n");
+        return false;
     }
+    FILE *file = createDataFile(FILENAME) ? fopen(FILENAME, "r+b") : NULL;
+    struct Booking *chunk = malloc(SCAN_CHUNK_RECORDS * sizeof(struct Booking));
+    bool written = file != NULL && chunk != NULL && fseeko(file, DATA_HEADER_SIZE, SEEK_SET) == 0;
+    for (long long first = 0; written && first < count; first += SCAN_CHUNK_RECORDS)
+    {
+        long long records = count - first < SCAN_CHUNK_RECORDS ? count - first : SCAN_CHUNK_RECORDS;
+        for (long long i = 0; i < records; i++)
+        {
+            syntheticBooking(first + i, &chunk[i]);
+        }
+        written = fwrite(chunk, sizeof(struct Booking), records, file) == (size_t)records;
+    }
+    free(chunk);
+    if (file != NULL)
+    {
+        written = fclose(file) == 0 && written;
+    }
+    if (!written)
+    {
+        fprintf(stderr, "Error: Unable to write synthetic bookings to %s.\n", FILENAME);
+    }
+    return written;
+}
 
-    int newSeatNum;
-    while (1) {
-        char seatInput[10];
-        printf("Select new seat number for traveler %d (or enter 0 to skip): ", i + 1);
-        fgets(seatInput, sizeof(seatInput), stdin);
-
+// Seconds one report scan over bookings.dat takes, best of BENCHMARK_RUNS.
+double timeReportScan(struct ReportTotals *totals)
+{
+    double best = -1;
+    for (int run = 0; run < BENCHMARK_RUNS; run++)
+    {
+        struct timespec started, finished;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        if (!collectReportTotals(totals))
+        {
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        double seconds = (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1e9;
+        if (best < 0 || seconds < best)
+        {
+            best = seconds;
+        }
+    }
+    return best;
+}
 
-        if (strcmp(seatInput, "0\n") == 0) {
+bool benchmarkScan(long long records)
+{
+    if (records > 0 && !writeSyntheticBookings(records))
+    {
+        return false;
+    }
+    struct ReportTotals *totals = malloc(sizeof(struct ReportTotals));
+    struct stat st;
+    if (totals == NULL || !collectReportTotals(totals) || stat(FILENAME, &st) != 0) // Also warms the page cache
+    {
+        fprintf(stderr, "Error: Unable to scan %s.\n", FILENAME);
+        free(totals);
+        return false;
+    }
 
-            if (i >= booking.bookedSeat || booking.seats[i] == 0) {
-                printf("Error: New travelers must have a seat assigned.\n");
-                continue;
-            }
-            printf("No change for traveler %d's seat.\n", i + 1);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int maxThreads = cpus < 1 ? 1 : cpus > MAX_SCAN_THREADS ? MAX_SCAN_THREADS : (int)cpus;
+    double megabytes = st.st_size / (1024.0 * 1024.0);
+    printf("Report scan over %lld bookings (%.1f MiB), %ld CPUs, best of %d runs\n",
+           recordCount(st.st_size, sizeof(struct Booking)), megabytes, cpus, BENCHMARK_RUNS);
+    printf("%8s %10s %10s %8s\n", "Threads", "Seconds", "MiB/s", "Speedup");
+    double single = 0;
+    for (int threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2)
+    {
+        scanThreadLimit = threads;
+        double seconds = timeReportScan(totals);
+        if (seconds < 0)
+        {
+            fprintf(stderr, "Error: Unable to scan %s.\n", FILENAME);
             break;
         }
-
-        if (sscanf(seatInput, "%d", &newSeatNum) == 1 && newSeatNum >= 1 && newSeatNum <= MAX_SEATS) {
-            booking.seats[i] = newSeatNum;
-            printf("Traveler %d's seat successfully changed to %d.\n", i + 1, newSeatNum);
+        if (threads == 1)
+        {
+            single = seconds;
+        }
+        printf("%8d %10.4f %10.1f %7.2fx\n", threads, seconds, seconds > 0 ? megabytes / seconds : 0, seconds > 0 ? single / seconds : 0);
+        if (threads == maxThreads)
+        {
             break;
-        } else {
-            printf("Error: Invalid seat number. Please enter a valid seat (1-%d).\n", MAX_SEATS);
         }
     }
+    scanThreadLimit = MAX_SCAN_THREADS;
+    free(totals);
+    return true;
 }
 
+// Books count synthetic bookings from index first on through the current
+// I/O backend. Each appends the booking and a feedback record and adds
+// points to the traveller's ledger entry, then flushes like addBooking().
+void bookSyntheticBookings(long long first, long long count)
+{
+    for (long long i = first; i < first + count; i++)
+    {
+        struct Booking booking;
+        syntheticBooking(i, &booking);
+        insertBooking(&booking);
+        adjustPoints(booking.name, 10, true);
+        struct Feedback feedback;
+        memset(&feedback, 0, sizeof(feedback));
+        feedback.ticketID = booking.ticketID;
+        memcpy(feedback.name, booking.name, sizeof(feedback.name));
+        feedback.rating = 1 + i % 5;
+        snprintf(feedback.comments, sizeof(feedback.comments), "Synthetic booking %lld", i);
+        sealFeedback(&feedback);
+        ioBackend->append(FEEDBACK_FILENAME, &feedback, sizeof(feedback));
+        flushIOBackend();
+    }
+}
 
-booking.bookedSeat = booking.numTravelers;
-
-
-            int currentLocationIndex = -1, destinationIndex = -1;
-            for (int i = 0; i < numCities; i++)
-            {
-                if (strcmp(booking.currentLocation, indianCities[i]) == 0)
-                {
-                    currentLocationIndex = i;
-                }
-                if (strcmp(booking.destination, indianCities[i]) == 0)
-                {
-                    destinationIndex = i;
-                }
-            }
-
-            if (currentLocationIndex != -1 && destinationIndex != -1)
-            {
-                booking.price = ticketPrices[currentLocationIndex][cateChoice - 1];
-            }
-            else
+// Runs bookSyntheticBookings() in a child process using backend in
+// directory. With traced set the child's system calls are counted through
+// ptrace(). Returns the seconds or system calls taken, or -1 if the child
+// could not run the backend.
+double runBookingWorkload(const char *directory, const struct IOBackend *backend, long long first, long long count, bool traced)
+{
+    int results[2];
+    if (pipe(results) != 0)
+    {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(results[0]);
+        double seconds = -1;
+        if (chdir(directory) == 0 && useIOBackend(backend))
+        {
+#ifdef __linux__
+            if (traced && (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0 || raise(SIGSTOP) != 0))
             {
-                printf("Error: Unable to find current location or destination in the cities list.\n");
-                fclose(file);
-                fclose(tempFile);
-                return;
+                _exit(1);
             }
-
-            // Write updated booking to temp file
-            fwrite(&booking, sizeof(struct Booking), 1, tempFile);
-            printf("Booking modified successfully!\n");
+#endif
+            struct timespec started, finished;
+            clock_gettime(CLOCK_MONOTONIC, &started);
+            bookSyntheticBookings(first, count);
+            clock_gettime(CLOCK_MONOTONIC, &finished);
+            seconds = (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1e9;
         }
-        else
+        _exit(write(results[1], &seconds, sizeof(seconds)) == sizeof(seconds) ? 0 : 1);
+    }
+    close(results[1]);
+    double result = child < 0 ? -1 : 0;
+    long long syscallStops = 0;
+#ifdef __linux__
+    int status;
+    if (child > 0 && traced && waitpid(child, &status, 0) == child && WIFSTOPPED(status))
+    {
+        // Every system call stops the child once on entry and once on exit
+        ptrace(PTRACE_SETOPTIONS, child, NULL, (void *)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL));
+        int signal = 0;
+        while (ptrace(PTRACE_SYSCALL, child, NULL, (void *)(long)signal) == 0 && waitpid(child, &status, 0) == child &&
+               WIFSTOPPED(status))
         {
-            // Write unchanged booking to temp file
-            fwrite(&booking, sizeof(struct Booking), 1, tempFile);
+            bool syscallStop = WSTOPSIG(status) == (SIGTRAP | 0x80);
+            syscallStops += syscallStop;
+            signal = syscallStop ? 0 : WSTOPSIG(status);
         }
     }
-
-    if (!found)
+#endif
+    double seconds;
+    if (read(results[0], &seconds, sizeof(seconds)) != sizeof(seconds) || seconds < 0)
     {
-        printf("Booking with Ticket ID %d not found.\n", ticketID);
+        result = -1;
     }
-
-    fclose(file);
-    fclose(tempFile);
-    remove(FILENAME);
-    rename("temp.dat", FILENAME); // Replace original file with updated file
+    else
+    {
+        result = traced ? syscallStops / 2.0 : seconds;
+    }
+    close(results[0]);
+    if (child > 0)
+    {
+        waitpid(child, NULL, 0);
+    }
+    return result;
 }
 
-void cancelBooking() {
-    int ticketID;
-    printf("Enter Ticket ID to cancel: ");
-    if (scanf("%d", &ticketID) != 1) {
-        printf("Error: Invalid input.\n");
-        clearInputBuffer();
-        return;
+bool benchmarkIO(long long records)
+{
+    if (records <= 0)
+    {
+        records = BENCHMARK_IO_BOOKINGS;
     }
-    clearInputBuffer();
-
-    struct Booking booking;
-    FILE *file = fopen(FILENAME, "rb");
-    FILE *tempFile = fopen("temp.dat", "wb");
-    
-    if (!file || !tempFile) {
-        perror("Error opening file");
-        if (file) fclose(file);
-        if (tempFile) fclose(tempFile);
-        return;
+    if (bookingEngine->logStructured)
+    {
+        fprintf(stderr, "Error: --benchmark io writes bookings.dat directly and needs the file engine.\n");
+        return false;
     }
-
-    bool found = false;
-    while (fread(&booking, sizeof(struct Booking), 1, file) == 1) {
-        if (booking.ticketID == ticketID) {
-            found = true;
-            printf("Booking with Ticket ID %d found. Cancel booking? (1: Yes, 0: No): ", ticketID);
-            int confirm;
-            if (scanf("%d", &confirm) != 1 || (confirm != 0 && confirm != 1)) {
-                printf("Invalid input. Please enter 1 for Yes or 0 for No.\n");
-                clearInputBuffer();
-                confirm = 0;  // Default to not canceling if input invalid
-            }
-            clearInputBuffer();
-            
-            if (confirm == 1) {
-                printf("Ticket ID %d canceled successfully!\n", ticketID);
-                continue; // Skip writing to temp file to "cancel" booking
-            }
+    long long traced = records < BENCHMARK_TRACED_BOOKINGS ? records : BENCHMARK_TRACED_BOOKINGS;
+    printf("Booking writes through each I/O backend: %lld bookings, system calls counted over %lld more\n", records, traced);
+    printf("%-8s %12s %18s\n", "Backend", "Bookings/s", "Syscalls/booking");
+    const struct IOBackend *backends[] = {&syncBackend, &batchedBackend, &ringBackend};
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+    {
+        // A fresh directory per backend, with the same traveller ledger size
+        char directory[64];
+        snprintf(directory, sizeof(directory), "io-%s", backends[i]->name);
+        if (mkdir(directory, 0755) != 0 || chdir(directory) != 0)
+        {
+            fprintf(stderr, "Error: Unable to create %s; --benchmark io needs a data directory without it.\n", directory);
+            return false;
+        }
+        bool created = migrateDataFiles();
+        if (chdir("..") != 0 || !created)
+        {
+            fprintf(stderr, "Error: Unable to create the data files in %s.\n", directory);
+            return false;
         }
-        fwrite(&booking, sizeof(struct Booking), 1, tempFile);  // Write unchanged or kept booking
-    }
 
-    if (!found) {
-        printf("Booking with Ticket ID %d not found.\n", ticketID);
+        double seconds = runBookingWorkload(directory, backends[i], 0, records, false);
+        if (seconds < 0)
+        {
+            printf("%-8s %12s %18s\n", backends[i]->name, "unavailable", "");
+            continue;
+        }
+        double syscalls = runBookingWorkload(directory, backends[i], records, traced, true);
+        char perBooking[32] = "n/a"; // Without ptrace
+        if (syscalls > 0)
+        {
+            snprintf(perBooking, sizeof(perBooking), "%.1f", syscalls / traced);
+        }
+        printf("%-8s %12.0f %18s\n", backends[i]->name, seconds > 0 ? records / seconds : 0, perBooking);
     }
-
-    fclose(file);
-    fclose(tempFile);
-
-    remove(FILENAME);
-    rename("temp.dat", FILENAME);  // Replace original file with updated file
+    return true;
 }
 
-
-void PopularDestinations()
+bool runBenchmark(const char *name, long long records)
 {
-    struct Booking booking;
-    FILE *file = fopen(FILENAME, "rb");
-
-    int destinationCounts[MAX_DESTINATION_LENGTH];
-
-    memset(destinationCounts, 0, sizeof(destinationCounts));
-
-    if (file == NULL)
+    if (strcmp(name, "scan") == 0)
     {
-        printf("Error opening bookings file.\n");
-        return;
+        return benchmarkScan(records);
     }
-
-    while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+    if (strcmp(name, "io") == 0)
     {
-        for (int i = 0; i < numCities; i++)
-        {
-            if (strcmp(booking.destination, indianCities[i]) == 0)
-            {
-                destinationCounts[i]++;
-                break;
-            }
-        }
+        return benchmarkIO(records);
     }
+    fprintf(stderr, "Error: Unknown benchmark %s; expected scan or io.\n", name);
+    return false;
+}
 
-    fclose(file);
+// Session recording and replay. --record copies every byte typed at the
+// console into a trace file; --replay feeds a trace back in as stdin with the
+// menu output discarded, then reports how long each menu command took, the
+// peak resident memory, and fingerprints the data files so runs can be
+// compared. A replay runs on a fixed clock and a copy of the data directory,
+// so replaying a trace twice from the same files gives the same fingerprints.
+struct CommandTiming
+{
+    long count;
+    double totalMs;
+    double maxMs;
+};
 
-    printf("\n+---------------------------------------------+\n");
-    printCentered("|            Popular Destinations             |", 45);
-    printf("+---------------------------------------------+\n");
+struct CommandLineOptions
+{
+    const char *recordPath;
+    const char *replayPath;
+    const char *dataDir;
+    const char *compareDir;
+    bool verbose;
+    bool verify;
+    bool repair;
+    bool resetSeats;
+    const char *exportFormat;
+    const char *exportDataset;
+    const char *exportOutput;
+    const char *exportMode;
+    const char *exportRoute;
+    const char *exportSince;
+    const char *exportUntil;
+    const char *generateCitiesPath;
+    const char *benchmark;
+    long long benchmarkRecords;
+};
 
-    for (int i = 0; i < numCities; i++)
+struct CommandLineOptions commandLine = {0};
+struct CommandTiming commandTimings[MAX_MENU_COMMANDS];
+int recordSourceFd = -1;
+int recordTraceFd = -1;
+int recordPipeFd = -1;
+
+void *recordInputThread(void *arg)
+{
+    (void)arg;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(recordSourceFd, buffer, sizeof(buffer))) > 0)
     {
-        if (destinationCounts[i] > 0)
+        // Trace first, so everything the program consumes is on disk
+        if (write(recordTraceFd, buffer, n) != n || write(recordPipeFd, buffer, n) != n)
         {
-            printf("| %-31s: %d bookings |\n", indianCities[i], destinationCounts[i]);
+            break;
         }
     }
-    printf("+---------------------------------------------+\n");
+    close(recordPipeFd);
+    return NULL;
 }
 
-void RevenueStatistics()
+bool startRecording(const char *path)
 {
-    struct Booking booking;
-    FILE *file = fopen(FILENAME, "rb");
-    int totalRevenue = 0;
-
-    if (file == NULL)
+    int fds[2];
+    recordTraceFd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (recordTraceFd < 0 || pipe(fds) != 0)
     {
-        printf("Error opening bookings file.\n");
-        return;
+        return false;
     }
-
-    while (fread(&booking, sizeof(struct Booking), 1, file) == 1)
+    recordSourceFd = dup(STDIN_FILENO);
+    recordPipeFd = fds[1];
+    if (recordSourceFd < 0 || dup2(fds[0], STDIN_FILENO) < 0)
     {
-        totalRevenue += booking.price;
+        return false;
     }
+    close(fds[0]);
 
-    fclose(file);
-    printf("\n+---------------------------------------------+\n");
-    printCentered("|            Revenue Statistics               |", 45);
-    printf("+---------------------------------------------+\n");
-    printf("| Total Revenue from Bookings: Rs. %-10d |\n", totalRevenue);
-    printf("+---------------------------------------------+\n");
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, recordInputThread, NULL) != 0)
+    {
+        return false;
+    }
+    pthread_detach(tid);
+    return true;
 }
 
-void generateReports()
+void recordCommandTiming(int commandIndex, const struct timespec *started)
 {
-    printf("\n+---------------------------------------------+\n");
-    printCentered("|           Reports and Analytics             |", 45);
-    printf("+---------------------------------------------+\n");
-
-    PopularDestinations();
-    RevenueStatistics();
-
-    printf("+---------------------------------------------+\n");
+    struct timespec finished;
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double ms = (finished.tv_sec - started->tv_sec) * 1000.0 + (finished.tv_nsec - started->tv_nsec) / 1e6;
+    struct CommandTiming *timing = &commandTimings[commandIndex];
+    timing->count++;
+    timing->totalMs += ms;
+    if (ms > timing->maxMs)
+    {
+        timing->maxMs = ms;
+    }
 }
 
-void FAQ()
+// FNV-1a over a whole file. Returns false if the file cannot be read.
+bool fingerprintFile(const char *path, unsigned long long *hash, long long *size)
 {
-    const char *questions[] = {
-        "1. How do I book a return ticket?",
-        "2. Are there any discounts available on ticket bookings?",
-        "3. Can I cancel or modify my booking?",
-        "4. How can I choose my preferred seat?",
-        "5. How do I check the status of my booking?"};
-
-    const char *answers[] = {
-        "When booking a ticket, select the 'Return Ticket' option by answering 'yes' when prompted. "
-        "The system will then allow you to book a round-trip ticket.",
-
-        "Yes, you can use a promo code if you have one.",
-
-        "Yes, you can cancel or modify your booking by logging into your account and navigating to "
-        "the 'My Bookings' section. Modifications are allowed up to 24 hours before the scheduled departure time.",
+    FILE *file = fopen(path, "rb");
+    *hash = 1469598103934665603ULL;
+    *size = 0;
+    if (file == NULL)
+    {
+        return false;
+    }
+    unsigned char buffer[1 << 16];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            *hash = (*hash ^ buffer[i]) * 1099511628211ULL;
+        }
+        *size += n;
+    }
+    fclose(file);
+    return true;
+}
 
-        "During the booking process, you will have an option to select your preferred seat if available. "
-        "Seat options vary based on the type of ticket and availability.",
+// Counts fixed-size records, after the header, that differ between path
+// and the same file in otherDir. Records present in only one of the files count as differences.
+long compareRecordFiles(const char *path, const char *otherDir, size_t recordSize)
+{
+    char otherPath[512];
+    snprintf(otherPath, sizeof(otherPath), "%s/%s", otherDir, path);
+    FILE *a = fopen(path, "rb");
+    FILE *b = fopen(otherPath, "rb");
+    if (a)
+        fseeko(a, DATA_HEADER_SIZE, SEEK_SET);
+    if (b)
+        fseeko(b, DATA_HEADER_SIZE, SEEK_SET);
+    long differences = 0;
+    char recordA[1024], recordB[1024];
+    while (1)
+    {
+        bool haveA = a != NULL && fread(recordA, recordSize, 1, a) == 1;
+        bool haveB = b != NULL && fread(recordB, recordSize, 1, b) == 1;
+        if (!haveA && !haveB)
+        {
+            break;
+        }
+        if (haveA != haveB || memcmp(recordA, recordB, recordSize) != 0)
+        {
+            differences++;
+        }
+    }
+    if (a)
+        fclose(a);
+    if (b)
+        fclose(b);
+    return differences;
+}
 
-        "To check the status of your booking, log into your account and go to the 'My Bookings' section. "
-        "You'll see the details and status of each ticket you've booked."};
+void printReplayReport()
+{
+    fflush(stdout);
+    fprintf(stderr, "\nReplay of %s, on a copy of the data directory\n", commandLine.replayPath);
+    fprintf(stderr, "+---------------------------+--------+------------+------------+\n");
+    fprintf(stderr, "| Command                   | Count  | Avg ms     | Max ms     |\n");
+    fprintf(stderr, "+---------------------------+--------+------------+------------+\n");
+    for (int i = 0; i < numMenuCommands; i++)
+    {
+        if (commandTimings[i].count > 0)
+        {
+            fprintf(stderr, "| %-25.25s | %-6ld | %-10.3f | %-10.3f |\n", menuCommands[i].label, commandTimings[i].count,
+                    commandTimings[i].totalMs / commandTimings[i].count, commandTimings[i].maxMs);
+        }
+    }
+    fprintf(stderr, "+---------------------------+--------+------------+------------+\n");
 
-    int choice;
-    do
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
     {
-        printf("\n+---------------------------------------------+\n");
-        printCentered("|           Frequently Asked Questions        |", 45);
-        printf("+---------------------------------------------+\n");
-        int numFAQs = sizeof(questions) / sizeof(questions[0]);
+        fprintf(stderr, "Peak RSS %ld KiB\n", usage.ru_maxrss);
+    }
 
-        printf("Frequently Asked Questions:\n");
-        for (int i = 0; i < numFAQs; i++)
+    const char *files[] = {FILENAME, POINTS_FILENAME};
+    const size_t recordSizes[] = {sizeof(struct Booking), sizeof(struct User)};
+    for (int i = 0; i < 2; i++)
+    {
+        unsigned long long hash;
+        long long size;
+        if (fingerprintFile(files[i], &hash, &size))
         {
-            printf("%s\n", questions[i]);
+            fprintf(stderr, "%-20s %10lld bytes  fnv64 %016llx\n", files[i], size, hash);
         }
+        else
+        {
+            fprintf(stderr, "%-20s missing\n", files[i]);
+        }
+        if (commandLine.compareDir != NULL)
+        {
+            fprintf(stderr, "%-20s %ld record(s) differ from %s\n", files[i],
+                    compareRecordFiles(files[i], commandLine.compareDir, recordSizes[i]), commandLine.compareDir);
+        }
+    }
+}
 
-        printf("\nEnter the number of the question you'd like more information about (0 to exit): ");
-        scanf("%d", &choice);
-
-        if (choice > 0 && choice <= numFAQs)
+bool parseArguments(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--record") == 0 && hasValue)
         {
-            printf("\nAnswer:\n%s\n", answers[choice - 1]);
+            commandLine.recordPath = argv[++i];
         }
-        else if (choice == 0)
+        else if (strcmp(argv[i], "--replay") == 0 && hasValue)
         {
-            printf("Exiting FAQ section.\n");
-            break;
+            commandLine.replayPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--data-dir") == 0 && hasValue)
+        {
+            commandLine.dataDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--compare") == 0 && hasValue)
+        {
+            commandLine.compareDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--verbose") == 0)
+        {
+            commandLine.verbose = true;
+        }
+        else if (strcmp(argv[i], "--verify") == 0)
+        {
+            commandLine.verify = true;
+        }
+        else if (strcmp(argv[i], "--repair") == 0)
+        {
+            commandLine.repair = true;
+        }
+        else if (strcmp(argv[i], "--reset-seats") == 0)
+        {
+            commandLine.resetSeats = true;
+        }
+        else if (strcmp(argv[i], "--export") == 0 && hasValue)
+        {
+            commandLine.exportFormat = argv[++i];
+        }
+        else if (strcmp(argv[i], "--dataset") == 0 && hasValue)
+        {
+            commandLine.exportDataset = argv[++i];
+        }
+        else if (strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            commandLine.exportOutput = argv[++i];
+        }
+        else if (strcmp(argv[i], "--mode") == 0 && hasValue)
+        {
+            commandLine.exportMode = argv[++i];
+        }
+        else if (strcmp(argv[i], "--route") == 0 && hasValue)
+        {
+            commandLine.exportRoute = argv[++i];
+        }
+        else if (strcmp(argv[i], "--since") == 0 && hasValue)
+        {
+            commandLine.exportSince = argv[++i];
+        }
+        else if (strcmp(argv[i], "--until") == 0 && hasValue)
+        {
+            commandLine.exportUntil = argv[++i];
+        }
+        else if (strcmp(argv[i], "--generate-cities") == 0 && hasValue)
+        {
+            commandLine.generateCitiesPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--benchmark") == 0 && hasValue)
+        {
+            commandLine.benchmark = argv[++i];
+        }
+        else if (strcmp(argv[i], "--records") == 0 && hasValue && atoll(argv[i + 1]) > 0)
+        {
+            commandLine.benchmarkRecords = atoll(argv[++i]);
         }
         else
         {
-            printf("Invalid choice. Please enter a number between 1 and %d.\n", numFAQs);
+            fprintf(stderr, "Usage: %s [--record TRACE] [--replay TRACE [--verbose] [--compare DIR]] [--verify [--repair]] [--reset-seats] [--data-dir DIR]\n", argv[0]);
+            fprintf(stderr, "       %s --export csv|jsonl|columnar [--dataset bookings|feedbacks|points] [--output FILE]\n", argv[0]);
+            fprintf(stderr, "          [--mode Bus|Train] [--route FROM:TO] [--since YYYY-MM-DD] [--until YYYY-MM-DD]\n");
+            fprintf(stderr, "       %s --generate-cities FILE|-\n", argv[0]);
+            fprintf(stderr, "       %s --benchmark scan|io [--records N] [--data-dir DIR]\n", argv[0]);
+            return false;
         }
-    } while (1);
+    }
+    return true;
 }
 
-void recordFeedback(int ticketID, const char* name) {
-    struct Feedback feedback;
-    feedback.ticketID = ticketID;
-    strncpy(feedback.name, name, MAX_NAME_LENGTH - 1);
-    feedback.name[MAX_NAME_LENGTH - 1] = '\0';  // Ensure null termination
+// A replay runs on a temporary copy of the data directory, so the trace
+// can be replayed again from the same files.
+char replayCopy[PATH_MAX];
+struct stat replayCopyStat; // To skip the copy when it is made inside the data directory
+char compareDir[PATH_MAX];
 
-    // Input and validate rating
-    printf("Rate your experience (1-5): ");
-    while (scanf("%d", &feedback.rating) != 1 || feedback.rating < 1 || feedback.rating > 5) {
-        printf("Invalid input. Please enter a number between 1 and 5.\n");
-        clearInputBuffer();  // Clear invalid input
-        printf("Rate your experience (1-5): ");
+bool copyFileContents(const char *from, const char *to)
+{
+    int in = open(from, O_RDONLY);
+    int out = in >= 0 ? open(to, O_WRONLY | O_CREAT | O_EXCL, 0644) : -1;
+    bool copied = out >= 0;
+    char buffer[1 << 16];
+    off_t offset = 0;
+    ssize_t n;
+    while (copied && (n = read(in, buffer, sizeof(buffer))) != 0)
+    {
+        if (n < 0)
+        {
+            copied = errno == EINTR;
+            continue;
+        }
+        copied = pwriteAll(out, buffer, n, offset);
+        offset += n;
     }
-    clearInputBuffer();  // Clear newline after valid input
-
-    // Input feedback comments
-    printf("Enter Your Feedback (max %d characters): ", MAX_COMMENT_LENGTH - 1);
-    fgets(feedback.comments, sizeof(feedback.comments), stdin);
-    feedback.comments[strcspn(feedback.comments, "\n")] = '\0'; // Remove newline
-
-    // Save feedback to file
-    FILE *file = fopen("feedbacks.dat", "ab");
-    if (file == NULL) {
-        perror("Error opening file");
-        return;
+    if (in >= 0)
+    {
+        close(in);
     }
-    if (fwrite(&feedback, sizeof(struct Feedback), 1, file) != 1) {
-        printf("Error writing feedback to file.\n");
-    } else {
-        printf("Thank you for your feedback!\n");
+    if (out >= 0 && close(out) != 0)
+    {
+        copied = false;
     }
-    fclose(file);
+    return copied;
 }
 
-void displayFeedbacks() {
-    struct Feedback feedback;
-    FILE *file = fopen("feedbacks.dat", "rb");
-
-    if (file == NULL) {
-        printf("+-----------------------------------------------+\n");
-        printf("| No feedbacks available.                        |\n");
-        printf("+-----------------------------------------------+\n");
-        return;
+// Copies one entry of the data directory, walked from ".", into replayCopy.
+int copyReplayEntry(const char *path, const struct stat *st, int type, struct FTW *walk)
+{
+    if (type == FTW_D && st->st_dev == replayCopyStat.st_dev && st->st_ino == replayCopyStat.st_ino)
+    {
+        return FTW_SKIP_SUBTREE;
     }
-
-    printf("\nFeedbacks:\n");
-    printf("+----------------------------------------------------------------------+\n");
-    printf("| Ticket ID | Name                | Rating |      Comments             |\n");
-    printf("+----------------------------------------------------------------------+\n");
-
-    while (fread(&feedback, sizeof(struct Feedback), 1, file) == 1) {
-        printf("| %-10d | %-18s | %-6d | %s\n",
-               feedback.ticketID, feedback.name, feedback.rating, feedback.comments);
+    if (walk->level == 0 || (type != FTW_D && type != FTW_F))
+    {
+        return FTW_CONTINUE; // The copy itself exists already; sockets and links are not data
     }
-    printf("+----------------------------------------------------------------------+\n");
-
-    fclose(file);
+    char target[PATH_MAX + 256];
+    snprintf(target, sizeof(target), "%s/%s", replayCopy, path + 2); // Past the leading "./"
+    return (type == FTW_D ? mkdir(target, 0755) == 0 : copyFileContents(path, target)) ? FTW_CONTINUE : FTW_STOP;
 }
 
-void displayCalendar() {
-    printf("\n +----------------------------------------------------------------------------------------------+\n");
-    printf(" | Date       | Current Location | Destination | Standard Price | VIP Price | Availability      |\n");
-    printf(" +----------------------------------------------------------------------------------------------+\n");
+int removeReplayEntry(const char *path, const struct stat *st, int type, struct FTW *walk)
+{
+    (void)st;
+    (void)type;
+    (void)walk;
+    return remove(path) == 0 ? 0 : -1;
+}
 
-    for (int i = 0; i < 30; i++) {
-        printf(" | %-10s | %-15s | %-11s | Rs. %-13d | Rs. %-8d | %-12s |\n",
-               tickets[i].date,
-               tickets[i].currentLocation,
-               tickets[i].destination,
-               tickets[i].standardPrice,
-               tickets[i].vipPrice,
-               tickets[i].available ? "Available" : "Sold Out");
+void removeReplayCopy()
+{
+    if (chdir("/") == 0)
+    {
+        nftw(replayCopy, removeReplayEntry, 16, FTW_DEPTH | FTW_PHYS);
     }
-
-    printf(" +----------------------------------------------------------------------------------------------+\n");
 }
 
-int main()
+// Copies the current directory to a new temporary one and moves there.
+bool startReplayCopy()
 {
-    system("color 78");
-
-    showMenu();
-    return 0;
+    const char *tmp = getenv("TMPDIR");
+    snprintf(replayCopy, sizeof(replayCopy), "%s/booking-replay-XXXXXX", tmp != NULL && tmp[0] != '\0' ? tmp : "/tmp");
+    if (mkdtemp(replayCopy) == NULL || stat(replayCopy, &replayCopyStat) != 0)
+    {
+        return false;
+    }
+    atexit(removeReplayCopy); // Registered before the report, so it runs after it
+    return nftw(".", copyReplayEntry, 16, FTW_PHYS | FTW_ACTIONRETVAL) == 0 && chdir(replayCopy) == 0;
 }
 
-void showMenu()
+// Applies the command line before any data file is opened.
+bool setupSession()
 {
-    printf("\n");
-    printCentered("\033[30m+-----------------------------------------------+", 120);
-    printCentered("\033[30m|           Ticket Booking System               |", 120);
-    printCentered("\033[30m+-----------------------------------------------+", 120);
-    printCentered("\033[30m| 1. Show Schedule                              |", 120);
-    printCentered("\033[30m| 2. Add/Resume Booking                         |", 120);
-    printCentered("\033[30m| 3. Display Bookings                           |", 120);
-    printCentered("\033[30m| 4. Save Progress and Exit                     |", 120);
-    printCentered("\033[30m| 5. Exit without Saving                        |", 120);
-    printCentered("\033[30m| 6. Search Bookings                            |", 120);
-    printCentered("\033[30m| 7. Modify Booking                             |", 120);
-    printCentered("\033[30m| 8. Cancel Booking                             |", 120);
-    printCentered("\033[30m| 9. View Report                                |", 120);
-    printCentered("\033[30m| 10. View Feed Backs                           |", 120);
-    printCentered("\033[30m| 11. Display FAQ.                              |", 120);
-    printCentered("\033[30m| 12. Exit.                                     |", 120);
-    printCentered("\033[30m| 13. Display Reedem Points                     |",120);
-    printCentered("\033[30m+-----------------------------------------------+", 120);
-    handleInput();
+    if (commandLine.replayPath != NULL && freopen(commandLine.replayPath, "r", stdin) == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open trace %s.\n", commandLine.replayPath);
+        return false;
+    }
+    // Resolved before the data directory becomes the working one
+    if (commandLine.compareDir != NULL)
+    {
+        if (realpath(commandLine.compareDir, compareDir) == NULL)
+        {
+            fprintf(stderr, "Error: Unable to use comparison directory %s.\n", commandLine.compareDir);
+            return false;
+        }
+        commandLine.compareDir = compareDir;
+    }
+    if (commandLine.dataDir != NULL && chdir(commandLine.dataDir) != 0)
+    {
+        fprintf(stderr, "Error: Unable to use data directory %s.\n", commandLine.dataDir);
+        return false;
+    }
+    if (commandLine.replayPath != NULL)
+    {
+        if (!startReplayCopy())
+        {
+            fprintf(stderr, "Error: Unable to copy the data directory to %s for the replay.\n", replayCopy);
+            return false;
+        }
+        replayClock = true;
+        if (!commandLine.verbose)
+        {
+            freopen("/dev/null", "w", stdout);
+        }
+        atexit(printReplayReport); // Registered before the I/O backend's flush, so it runs after it
+    }
+    if (commandLine.recordPath != NULL && !startRecording(commandLine.recordPath))
+    {
+        fprintf(stderr, "Error: Unable to record to %s.\n", commandLine.recordPath);
+        return false;
+    }
+    return true;
 }
 
 void handleInput()
 {
     int choice;
-    struct PartialBooking partial;
 
+    showMenu();
     while (1)
     {
         printf("Enter your choice: ");
-        if (scanf("%d", &choice) != 1)
+        int read = scanf("%d", &choice);
+        if (read == EOF)
+        {
+            return; // Input closed
+        }
+        if (read != 1)
         {
             printf("Invalid input. Please enter a number.\n");
             clearInputBuffer();
             continue;
         }
         clearInputBuffer();
-        switch (choice)
-        {
-        case 1:
-           Initilize_Calendar();
-           displayCalendar();
-           showMenu();
-           break;
-        case 2:
-            addBooking();
-            showMenu();
-          break;
-       case 3:
-            displayBookings();
-            showMenu();
-           break;
-        case 4:
-            if (partial.inProgress)
-            {
-                saveBookingProgress(&partial);
-                printf("Progress saved.\n");
-
-                int exitChoice;
-                do
-                {
-                    printf("Do you want to exit? (1: Yes, 0: No): ");
-                    if (scanf("%d", &exitChoice) != 1 || (exitChoice != 0 && exitChoice != 1))
-                    {
-                        printf("Invalid input. Please enter 1 for Yes or 0 for No.\n");
-                        clearInputBuffer();
-                        continue;
-                    }
-                    clearInputBuffer();
-                } while (exitChoice != 0 && exitChoice != 1);
-
-                if (exitChoice == 1)
-                {
-                    printf("Goodbye!\n");
-                    exit(0);
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else
-            {
-                printf("No booking in progress to save. Goodbye!\n");
-                exit(0);
-            }
-            showMenu();
-            break;
-        case 5:
-            printf("Exiting without saving.\n");
-            if (remove(PARTIAL_BOOKING_FILENAME) == 0)
-            {
-                printf("Unsaved progress cleared.\n");
-            }
-            else
-            {
-                printf("No unsaved progress to clear.\n");
-            }
-
-            int exitChoice;
-            do
-            {
-                printf("Do you want to exit? (1: Yes, 0: No): ");
-                if (scanf("%d", &exitChoice) != 1 || (exitChoice != 0 && exitChoice != 1))
-                {
-                    printf("Invalid input. Please enter 1 for Yes or 0 for No.\n");
-                    clearInputBuffer();
-                    continue;
-                }
-                clearInputBuffer();
-            } while (exitChoice != 0 && exitChoice != 1);
 
-            if (exitChoice == 1)
-            {
-                printf("Goodbye!\n");
-                exit(0);
-            }
-            else
-            {
-                // If the user chooses not to exit, continue with the program
-                continue;
-            }
-            break;
-        case 6:
-            searchBookings();
-            showMenu();
-            break;
-        case 7:
-            modifyBooking();
-            showMenu();
-            break;
-        case 8:
-            cancelBooking();
-            showMenu();
-            break;
-        case 9:
-            generateReports();
-            showMenu();
-            break;
-        case 10:
-            displayFeedbacks();
-            break;
-        case 11:
-            FAQ();
-            showMenu();
-            break;
-        case 12:
-            exit(0);
-            break;
-        case 13:
-            printf("Enter your name to view Reedem points: ");
-            char userName[MAX_NAME_LENGTH];
-            fgets(userName, MAX_NAME_LENGTH, stdin);
-            userName[strcspn(userName, "\n")] = 0; 
-            displayPoints(userName);
-            showMenu();
-        break;
-        default:
+        const struct MenuCommand *command = findMenuCommand(choice);
+        if (command == NULL)
+        {
             printf("Invalid choice. Please try again.\n");
+            continue;
         }
+        struct timespec started;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        command->run();
+        flushIOBackend(); // Also unlocks records that queued updates held
+        recordCommandTiming(command - menuCommands, &started);
+        showMenu();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (!parseArguments(argc, argv))
+    {
+        return 1;
+    }
+    if (commandLine.generateCitiesPath != NULL)
+    {
+        return generateCityTable(commandLine.generateCitiesPath) ? 0 : 1;
+    }
+    if (!setupSession())
+    {
+        return 1;
+    }
+    initializeChecksums();
+    initializeCatalogs(); // Layout 0 bookings are converted by name
+    if (!migrateDataFiles())
+    {
+        return 1;
+    }
+    if (commandLine.verify)
+    {
+        return verifyDataFiles(commandLine.repair) ? 0 : 1;
+    }
+    if (!selectBookingEngine())
+    {
+        return 1;
+    }
+    if (commandLine.benchmark != NULL)
+    {
+        return runBenchmark(commandLine.benchmark, commandLine.benchmarkRecords) ? 0 : 1;
+    }
+    if (commandLine.exportFormat != NULL)
+    {
+        struct ExportFilter filter;
+        const char *dataset = commandLine.exportDataset != NULL ? commandLine.exportDataset : "bookings";
+        return parseExportFilter(commandLine.exportMode, commandLine.exportRoute, commandLine.exportSince, commandLine.exportUntil, &filter) &&
+                       exportData(dataset, commandLine.exportFormat, commandLine.exportOutput, &filter)
+                   ? 0
+                   : 1;
+    }
+    if (commandLine.replayPath == NULL)
+    {
+        system("color 78");
+    }
+    selectIOBackend();
+    if (commandLine.resetSeats)
+    {
+        resetSharedSeatMap();
     }
+    seatMapPrivate = commandLine.replayPath != NULL;
+    initializeSeats();
+    buildJourneyTables();
+    loadWaitlist();
+
+    handleInput();
+    return 0;
 }
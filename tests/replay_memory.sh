@@ -0,0 +1,43 @@
+#!/bin/sh
+# Replays one million menu operations and checks that the menu loop runs in
+# constant memory: the peak RSS after the full run must match a short run of
+# the same trace. menu_cycle.trace is five operations (Show Schedule, FAQ,
+# View Report, Display Bookings and one invalid entry) and is repeated here.
+#
+# Usage: tests/replay_memory.sh [BOOKING_BINARY]
+set -eu
+
+BOOKING=${1:-./booking}
+TESTS=$(cd "$(dirname "$0")" && pwd)
+OPERATIONS=1000000
+OPERATIONS_PER_CYCLE=5
+SHORT_CYCLES=1000
+SLACK_KIB=256 # Allowance for allocator noise between the two runs
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Prints the peak RSS in KiB of replaying the cycle trace the given number of
+# times in a fresh data directory.
+peak_rss()
+{
+    mkdir "$WORK/data-$1"
+    yes "$(cat "$TESTS/menu_cycle.trace")" | head -n $(($(wc -l < "$TESTS/menu_cycle.trace") * $1)) > "$WORK/trace-$1"
+    "$BOOKING" --replay "$WORK/trace-$1" --data-dir "$WORK/data-$1" 2> "$WORK/report-$1"
+    sed -n 's/^Peak RSS \([0-9]*\) KiB$/\1/p' "$WORK/report-$1"
+}
+
+short=$(peak_rss $SHORT_CYCLES)
+long=$(peak_rss $((OPERATIONS / OPERATIONS_PER_CYCLE)))
+if [ -z "$short" ] || [ -z "$long" ]; then
+    echo "FAIL: replay report has no peak RSS" >&2
+    cat "$WORK"/report-* >&2
+    exit 1
+fi
+
+echo "peak RSS: $short KiB after $((SHORT_CYCLES * OPERATIONS_PER_CYCLE)) operations, $long KiB after $OPERATIONS"
+if [ "$long" -gt $((short + SLACK_KIB)) ]; then
+    echo "FAIL: memory grew by $((long - short)) KiB over the run" >&2
+    exit 1
+fi
+echo "PASS"
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Upgrades data files written by the original program, before catalog IDs
+# and the file header, and checks every booking comes through. The files in
+# baseline/ were made by booking two tickets with that version.
+#
+# Usage: tests/upgrade_baseline.sh [BOOKING_BINARY]
+set -eu
+
+BOOKING=${1:-./booking}
+TESTS=$(cd "$(dirname "$0")" && pwd)
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cp "$TESTS"/baseline/*.dat "$WORK"
+if ! "$BOOKING" --data-dir "$WORK" --export csv --output "$WORK/bookings.csv" 2> "$WORK/upgrade" ||
+    ! grep -q '^Converted bookings.dat from layout 0: 2 record(s)\.$' "$WORK/upgrade"; then
+    echo "FAIL: bookings.dat was not converted from layout 0" >&2
+    cat "$WORK/upgrade" >&2
+    exit 1
+fi
+
+cat > "$WORK/expected.csv" <<'CSV'
+339,Asha Rao,Mumbai,Delhi,Bus,VIP,2500,2,3 4,0
+339,Vikram,Bangalore,Mumbai,Bus,Standard,2400,1,7,1
+CSV
+tail -n +2 "$WORK/bookings.csv" | cut -d, -f1-10 > "$WORK/actual.csv"
+if ! cmp -s "$WORK/expected.csv" "$WORK/actual.csv"; then
+    echo "FAIL: converted bookings differ" >&2
+    diff "$WORK/expected.csv" "$WORK/actual.csv" >&2 || true
+    exit 1
+fi
+
+if ! "$BOOKING" --data-dir "$WORK" --verify > "$WORK/verify" 2>&1 || [ -e "$WORK/bookings.dat.unconverted" ]; then
+    echo "FAIL: converted files do not verify" >&2
+    cat "$WORK/verify" >&2
+    exit 1
+fi
+echo "PASS"